@@ -17,6 +17,7 @@ const Context = struct {
   target: std.zig.CrossTarget,
   artifacts: Artifacts,
   use_gles: u8,
+  headless: bool,
 
   fn addDeps(self: Context, s: *std.build.LibExeObjStep) !void {
     s.setBuildMode(self.mode);
@@ -46,6 +47,9 @@ const Context = struct {
     s.linkLibC();
     s.linkSystemLibrary("epoxy");
     s.linkSystemLibrary("freetype");
+    if (self.headless) {
+      s.linkSystemLibrary("EGL");
+    }
     if (self.target.isDarwin()) {
       s.addFrameworkDir("/System/Library/Frameworks");
       s.linkFramework("OpenGL");
@@ -90,6 +94,7 @@ pub fn build(b: *Builder) !void {
     .include_path = b.option([]const u8, "include_path", "include path for headers"),
     .artifacts = b.option(Artifacts, "artifacts", "`library`, `tests`, or `all`") orelse .all,
     .use_gles = b.option(u8, "gles", "`0`, `2` or `3`. use `0` (default) to link to normal OpenGL. ignored on Windows and macOS.") orelse 0,
+    .headless = b.option(bool, "headless", "link to libEGL for zargo.HeadlessContext") orelse false,
   };
 
   const lib = b.addStaticLibrary("zargo", "src/libzargo.zig");
@@ -102,6 +107,18 @@ pub fn build(b: *Builder) !void {
     lib.install();
   }
 
+  const baker = b.addExecutable("zargo-bake", "src/bake.zig");
+  try context.addDeps(baker);
+  baker.addPackage(.{
+    .name = "zargo",
+    .path = "src/zargo.zig",
+    .dependencies = &.{pkgs.zgl}
+  });
+
+  if (context.artifacts != .tests) {
+    baker.install();
+  }
+
   const exe = b.addExecutable("test", "tests/test.zig");
   try context.addDeps(exe);
   if (context.target.isWindows()) {
@@ -120,6 +137,28 @@ pub fn build(b: *Builder) !void {
     exe.install();
   }
 
+  // unit tests of parts that don't need an OpenGL context.
+  const unit_tests = b.addTest("src/zargo.zig");
+  try context.addDeps(unit_tests);
+  pkgs.addAllTo(unit_tests);
+  const test_step = b.step("test", "run the unit tests");
+  test_step.dependOn(&unit_tests.step);
+
+  // readback tests render with a HeadlessContext and therefore need EGL.
+  if (context.headless) {
+    const readback = b.addExecutable("readback", "tests/readback.zig");
+    try context.addDeps(readback);
+    readback.addPackage(.{
+      .name = "zargo",
+      .path = "src/zargo.zig",
+      .dependencies = &.{pkgs.zgl}
+    });
+    const run_readback = readback.run();
+    if (b.args) |args| run_readback.addArgs(args);
+    const readback_step = b.step("readback", "run the headless readback tests");
+    readback_step.dependOn(&run_readback.step);
+  }
+
   const cexe = b.addExecutable("ctest", null);
   try context.addDeps(cexe);
   cexe.addIncludeDir("include");
@@ -38,14 +38,74 @@ typedef struct {
   bool flipped, has_alpha;
 } zargo_Image;
 
+typedef struct {
+  zargo_Image image;
+  zargo_Rectangle area;
+  uint32_t left, bottom, right, top;
+} zargo_NinePatch;
+
+typedef struct {
+  zargo_NinePatch patch;
+  zargo_Rectangle dst_area;
+  uint8_t alpha;
+} zargo_NinePatchDraw;
+
 typedef struct {
   zargo_Engine e;
-  uint32_t previous_framebuffer, framebuffer;
+  uint32_t previous_framebuffer, framebuffer, stencil_buffer;
   zargo_Image target_image;
-  bool alpha;
+  bool alpha, pooled;
+  int32_t prev_x, prev_y;
   uint32_t prev_width, prev_height;
 } zargo_Canvas;
 
+typedef struct _zargo_Layer_impl *zargo_Layer;
+
+typedef struct _zargo_Font_impl *zargo_Font;
+
+typedef struct _zargo_Polyline_impl *zargo_Polyline;
+
+typedef struct _zargo_Path_impl *zargo_Path;
+
+typedef struct {
+  uint64_t allocations;
+  size_t live_blocks, bytes_in_use, reserved_bytes;
+} zargo_FreeTypeStats;
+
+typedef struct {
+  size_t start, end;
+  float advance;
+} zargo_TextLine;
+
+typedef struct {
+  const float (*points)[2];
+  size_t count;
+  uint8_t color[4];
+} zargo_Polygon;
+
+typedef struct {
+  float x, y, width, height;
+  float radius, border;
+  uint8_t color[4];
+} zargo_Shape;
+
+typedef struct {
+  float offset;
+  uint8_t color[4];
+} zargo_GradientStop;
+
+typedef struct {
+  int kind;
+  float start[2], end[2];
+  const zargo_GradientStop *stops;
+  size_t stop_count;
+} zargo_Gradient;
+
+typedef struct {
+  float x, y, width, height;
+  zargo_Gradient gradient;
+} zargo_GradientRect;
+
 enum {
   ZARGO_BACKEND_OGL_32,
   ZARGO_BACKEND_OGL_43,
@@ -53,6 +113,11 @@ enum {
   ZARGO_BACKEND_OGLES_31
 };
 
+enum {
+  ZARGO_FONT_MODE_BITMAP,
+  ZARGO_FONT_MODE_SDF
+};
+
 enum {
   ZARGO_HALIGN_LEFT,
   ZARGO_HALIGN_CENTER,
@@ -65,6 +130,16 @@ enum {
   ZARGO_VALIGN_BOTTOM
 };
 
+enum {
+  ZARGO_GRADIENT_LINEAR,
+  ZARGO_GRADIENT_RADIAL
+};
+
+enum {
+  ZARGO_FILL_NON_ZERO,
+  ZARGO_FILL_EVEN_ODD
+};
+
 ZARGO_DECLARE(zargo_Engine)
 zargo_engine_init(int backend, uint32_t window_width, uint32_t window_height, bool debug);
 
@@ -80,6 +155,12 @@ zargo_engine_clear(zargo_Engine e, uint8_t color[4]);
 ZARGO_DECLARE(void)
 zargo_engine_close(zargo_Engine e);
 
+ZARGO_DECLARE(void)
+zargo_engine_set_clip(zargo_Engine e, zargo_Rectangle *r);
+
+ZARGO_DECLARE(void)
+zargo_engine_read_pixels(zargo_Engine e, zargo_Rectangle *r, uint8_t *buffer);
+
 ZARGO_DECLARE(void)
 zargo_engine_fill_unit(zargo_Engine e, zargo_Transform *t, uint8_t color[4], bool copy_alpha);
 
@@ -98,6 +179,15 @@ zargo_engine_load_image(zargo_Engine e, zargo_Image *i, const char *path);
 ZARGO_DECLARE(void)
 zargo_engine_draw_image(zargo_Engine e, zargo_Image *i, zargo_Transform *dst_transform, zargo_Transform *src_transform, uint8_t alpha);
 
+ZARGO_DECLARE(bool)
+zargo_engine_blur_behind(zargo_Engine e, zargo_Rectangle *area, uint8_t iterations, float offset);
+
+ZARGO_DECLARE(bool)
+zargo_engine_push_opacity_group(zargo_Engine e, uint8_t alpha, zargo_Rectangle *bounds);
+
+ZARGO_DECLARE(void)
+zargo_engine_pop_opacity_group(zargo_Engine e);
+
 ZARGO_DECLARE(void)
 zargo_transform_identity(zargo_Transform *t);
 
@@ -155,6 +245,143 @@ zargo_canvas_finish(zargo_Canvas *c, zargo_Image *out);
 ZARGO_DECLARE(void)
 zargo_canvas_close(zargo_Canvas *c);
 
+ZARGO_DECLARE(zargo_Layer)
+zargo_layer_create(zargo_Engine e, uint32_t width, uint32_t height, bool with_alpha);
+
+ZARGO_DECLARE(void)
+zargo_layer_invalidate(zargo_Layer l, zargo_Rectangle *r);
+
+ZARGO_DECLARE(bool)
+zargo_layer_begin_update(zargo_Layer l, zargo_Rectangle *region);
+
+ZARGO_DECLARE(bool)
+zargo_layer_is_dirty(zargo_Layer l);
+
+ZARGO_DECLARE(void)
+zargo_layer_end_update(zargo_Layer l);
+
+ZARGO_DECLARE(void)
+zargo_layer_draw(zargo_Layer l, zargo_Rectangle *dst_area, uint8_t alpha);
+
+ZARGO_DECLARE(void)
+zargo_layer_free(zargo_Layer l);
+
+ZARGO_DECLARE(zargo_Font)
+zargo_engine_load_font(zargo_Engine e, const char *path);
+
+ZARGO_DECLARE(void)
+zargo_font_free(zargo_Font f);
+
+ZARGO_DECLARE(bool)
+zargo_font_load_baked_atlas(zargo_Font f, const char *path);
+
+ZARGO_DECLARE(void)
+zargo_font_set_mode(zargo_Font f, int mode);
+
+ZARGO_DECLARE(void)
+zargo_engine_draw_text(zargo_Engine e, zargo_Font f, const char *text, float x, float y, uint16_t size, uint8_t color[4]);
+
+ZARGO_DECLARE(void)
+zargo_engine_text_bounds(zargo_Engine e, zargo_Font f, const char *text, uint16_t size, zargo_Rectangle *bounds);
+
+ZARGO_DECLARE(bool)
+zargo_engine_start_glyph_workers(zargo_Engine e, unsigned int num_workers);
+
+ZARGO_DECLARE(void)
+zargo_engine_stop_glyph_workers(zargo_Engine e);
+
+ZARGO_DECLARE(void)
+zargo_engine_fill_polygon(zargo_Engine e, const float (*points)[2], size_t count, uint8_t color[4]);
+
+ZARGO_DECLARE(void)
+zargo_engine_fill_polygons(zargo_Engine e, const zargo_Polygon *polygons, size_t count);
+
+ZARGO_DECLARE(zargo_Polyline)
+zargo_engine_create_polyline(zargo_Engine e, const float (*points)[2], size_t count);
+
+ZARGO_DECLARE(bool)
+zargo_engine_update_polyline(zargo_Engine e, zargo_Polyline l, const float (*points)[2], size_t count);
+
+ZARGO_DECLARE(void)
+zargo_polyline_free(zargo_Polyline l);
+
+ZARGO_DECLARE(void)
+zargo_engine_draw_polyline(zargo_Engine e, zargo_Polyline l, float width, uint8_t color[4]);
+
+ZARGO_DECLARE(void)
+zargo_engine_stroke_polyline(zargo_Engine e, const float (*points)[2], size_t count, float width, uint8_t color[4]);
+
+ZARGO_DECLARE(void)
+zargo_engine_fill_circle(zargo_Engine e, float x, float y, float radius, uint8_t color[4]);
+
+ZARGO_DECLARE(void)
+zargo_engine_stroke_circle(zargo_Engine e, float x, float y, float radius, float width, uint8_t color[4]);
+
+ZARGO_DECLARE(void)
+zargo_engine_fill_rounded_rect(zargo_Engine e, zargo_Rectangle *r, float radius, uint8_t color[4]);
+
+ZARGO_DECLARE(void)
+zargo_engine_stroke_rounded_rect(zargo_Engine e, zargo_Rectangle *r, float radius, float width, uint8_t color[4]);
+
+ZARGO_DECLARE(void)
+zargo_engine_draw_shapes(zargo_Engine e, const zargo_Shape *shapes, size_t count);
+
+ZARGO_DECLARE(void)
+zargo_engine_fill_gradient_rect(zargo_Engine e, zargo_Rectangle *r, zargo_Gradient *g);
+
+ZARGO_DECLARE(void)
+zargo_engine_fill_gradients(zargo_Engine e, const zargo_GradientRect *rects, size_t count);
+
+ZARGO_DECLARE(void)
+zargo_engine_draw_nine_patch(zargo_Engine e, zargo_NinePatch *p, zargo_Rectangle *dst_area, uint8_t alpha);
+
+ZARGO_DECLARE(void)
+zargo_engine_draw_nine_patches(zargo_Engine e, const zargo_NinePatchDraw *draws, size_t count);
+
+ZARGO_DECLARE(zargo_Path)
+zargo_path_new(void);
+
+ZARGO_DECLARE(void)
+zargo_path_free(zargo_Path p);
+
+ZARGO_DECLARE(bool)
+zargo_path_move_to(zargo_Path p, float x, float y);
+
+ZARGO_DECLARE(bool)
+zargo_path_line_to(zargo_Path p, float x, float y);
+
+ZARGO_DECLARE(bool)
+zargo_path_quad_to(zargo_Path p, float cx, float cy, float x, float y);
+
+ZARGO_DECLARE(bool)
+zargo_path_cubic_to(zargo_Path p, float c1x, float c1y, float c2x, float c2y, float x, float y);
+
+ZARGO_DECLARE(bool)
+zargo_path_close(zargo_Path p);
+
+ZARGO_DECLARE(void)
+zargo_engine_fill_path(zargo_Engine e, zargo_Path p, zargo_Transform *t, int rule, uint8_t color[4]);
+
+ZARGO_DECLARE(void)
+zargo_engine_stroke_path(zargo_Engine e, zargo_Path p, zargo_Transform *t, float width, uint8_t color[4]);
+
+/* must be called once per frame when drawing text, the glyph atlas uses
+   frames to tell which glyphs are still in use. */
+ZARGO_DECLARE(void)
+zargo_engine_end_frame(zargo_Engine e);
+
+ZARGO_DECLARE(void)
+zargo_engine_freetype_stats(zargo_Engine e, zargo_FreeTypeStats *stats);
+
+ZARGO_DECLARE(bool)
+zargo_font_measure(zargo_Font f, const char *text, uint16_t size, float *advance, zargo_Rectangle *bounds);
+
+ZARGO_DECLARE(bool)
+zargo_font_break_lines(zargo_Font f, const char *text, uint16_t size, float max_width, zargo_TextLine **lines, size_t *count);
+
+ZARGO_DECLARE(void)
+zargo_text_lines_free(zargo_TextLine *lines, size_t count);
+
 #ifdef __cplusplus
 }
 #endif
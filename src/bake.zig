@@ -0,0 +1,89 @@
+//! zargo-bake rasterizes glyphs of a font into a pre-baked atlas file, which
+//! is loaded at runtime with Font.loadBakedAtlas (zargo_font_load_baked_atlas).
+
+const std = @import("std");
+
+const zargo = @import("zargo");
+
+const usage =
+  \\usage: zargo-bake [options] <font> <output>
+  \\
+  \\options:
+  \\  -s <sizes>      comma-separated pixel sizes (default: 16)
+  \\  -r <ranges>     comma-separated hexadecimal code point ranges like
+  \\                  20-7e or single code points (default: 20-7e)
+  \\  -p <page size>  width and height of the atlas page. must match the
+  \\                  page size of the glyph atlas at runtime (default: 1024)
+  \\
+;
+
+fn fail(comptime fmt: []const u8, args: anytype) u8 {
+  std.log.err(fmt, args);
+  std.io.getStdErr().writeAll(usage) catch {};
+  return 1;
+}
+
+fn parseSizes(allocator: std.mem.Allocator, arg: []const u8) ![]u16 {
+  var ret = std.ArrayList(u16).init(allocator);
+  errdefer ret.deinit();
+  var items = std.mem.split(u8, arg, ",");
+  while (items.next()) |item| try ret.append(try std.fmt.parseInt(u16, item, 10));
+  return ret.toOwnedSlice();
+}
+
+fn parseRanges(allocator: std.mem.Allocator, arg: []const u8) ![]zargo.BakedAtlas.Range {
+  var ret = std.ArrayList(zargo.BakedAtlas.Range).init(allocator);
+  errdefer ret.deinit();
+  var items = std.mem.split(u8, arg, ",");
+  while (items.next()) |item| {
+    const sep = std.mem.indexOfScalar(u8, item, '-');
+    const first = try std.fmt.parseInt(u21, if (sep) |i| item[0..i] else item, 16);
+    const last = if (sep) |i| try std.fmt.parseInt(u21, item[i + 1..], 16) else first;
+    if (last < first) return error.InvalidRange;
+    try ret.append(.{.first = first, .last = last});
+  }
+  return ret.toOwnedSlice();
+}
+
+pub fn main() !u8 {
+  var arena = std.heap.ArenaAllocator.init(std.heap.page_allocator);
+  defer arena.deinit();
+  const allocator = arena.allocator();
+
+  const args = try std.process.argsAlloc(allocator);
+  var sizes: []const u16 = &[_]u16{16};
+  var ranges: []const zargo.BakedAtlas.Range = &[_]zargo.BakedAtlas.Range{.{.first = 0x20, .last = 0x7e}};
+  var page_size: u16 = zargo.BakedAtlas.default_page_size;
+  var paths: [2][:0]const u8 = undefined;
+  var path_count: usize = 0;
+  var i: usize = 1;
+  while (i < args.len) : (i += 1) {
+    const arg = args[i];
+    if (arg.len > 1 and arg[0] == '-') {
+      if (i + 1 == args.len) return fail("missing value for {s}", .{arg});
+      i += 1;
+      if (std.mem.eql(u8, arg, "-s")) {
+        sizes = parseSizes(allocator, args[i]) catch return fail("invalid sizes: {s}", .{args[i]});
+      } else if (std.mem.eql(u8, arg, "-r")) {
+        ranges = parseRanges(allocator, args[i]) catch return fail("invalid ranges: {s}", .{args[i]});
+      } else if (std.mem.eql(u8, arg, "-p")) {
+        page_size = std.fmt.parseInt(u16, args[i], 10) catch return fail("invalid page size: {s}", .{args[i]});
+      } else return fail("unknown option: {s}", .{arg});
+    } else {
+      if (path_count == paths.len) return fail("too many arguments", .{});
+      paths[path_count] = arg;
+      path_count += 1;
+    }
+  }
+  if (path_count != paths.len) return fail("missing arguments", .{});
+
+  const file = try std.fs.cwd().createFile(paths[1], .{});
+  defer file.close();
+  var buffered = std.io.bufferedWriter(file.writer());
+  zargo.BakedAtlas.bake(allocator, paths[0], sizes, ranges, page_size, buffered.writer()) catch |err| {
+    std.log.err("unable to bake {s}: {s}", .{paths[0], @errorName(err)});
+    return 1;
+  };
+  try buffered.flush();
+  return 0;
+}
@@ -0,0 +1,183 @@
+const std = @import("std");
+const gl = @import("zgl");
+const zargo = @import("zargo.zig");
+
+// raw bindings for renderbuffers, which zgl does not wrap.
+const epoxy = @cImport({
+  @cInclude("epoxy/gl.h");
+});
+
+const egl = @cImport({
+  @cInclude("EGL/egl.h");
+  @cInclude("EGL/eglext.h");
+});
+
+pub const HeadlessError = error {
+  NoSurfacelessPlatform,
+  InitializationFailed,
+  NoConfig,
+  ApiUnavailable,
+  ContextCreationFailed,
+  MakeCurrentFailed,
+  IncompleteFramebuffer,
+};
+
+/// HeadlessContext creates an OpenGL context without any display, using EGL
+/// on Mesa's surfaceless platform (EGL_MESA_platform_surfaceless).
+/// This lets you use the Engine on servers without a window system, e.g. with
+/// Mesa's llvmpipe software renderer.
+///
+/// Since a surfaceless context has no default framebuffer, the context
+/// provides an offscreen target with the given size, which is bound after
+/// creation and takes the role of the window. Initialize the Engine with the
+/// same size and read the result back with Engine.readPixels.
+///
+/// You need to link against libEGL to use this; give -Dheadless=true when
+/// building with zig build.
+pub const HeadlessContext = struct {
+  display: egl.EGLDisplay,
+  context: egl.EGLContext,
+  framebuffer: gl.Framebuffer,
+  texture: gl.Texture,
+  stencil_buffer: c_uint,
+  width: u32,
+  height: u32,
+
+  fn hasExtension(list: [*c]const u8, name: []const u8) bool {
+    if (list == null) return false;
+    var iter = std.mem.tokenize(u8, std.mem.span(list), " ");
+    while (iter.next()) |ext| {
+      if (std.mem.eql(u8, ext, name)) return true;
+    }
+    return false;
+  }
+
+  /// create creates a context matching the given backend, makes it current
+  /// on the calling thread and binds an offscreen target of the given size.
+  pub fn create(backend: zargo.Backend, width: u32, height: u32) !HeadlessContext {
+    if (!hasExtension(egl.eglQueryString(null, egl.EGL_EXTENSIONS), "EGL_MESA_platform_surfaceless")) {
+      return HeadlessError.NoSurfacelessPlatform;
+    }
+    const getPlatformDisplay = @ptrCast(egl.PFNEGLGETPLATFORMDISPLAYEXTPROC,
+        egl.eglGetProcAddress("eglGetPlatformDisplayEXT")) orelse return HeadlessError.NoSurfacelessPlatform;
+    const display = getPlatformDisplay(egl.EGL_PLATFORM_SURFACELESS_MESA, null, null);
+    if (display == null) return HeadlessError.NoSurfacelessPlatform;
+    var major: egl.EGLint = undefined;
+    var minor: egl.EGLint = undefined;
+    if (egl.eglInitialize(display, &major, &minor) != egl.EGL_TRUE) {
+      return HeadlessError.InitializationFailed;
+    }
+
+    const desktop = backend == .ogl_32 or backend == .ogl_43;
+    if (egl.eglBindAPI(@as(egl.EGLenum, if (desktop) egl.EGL_OPENGL_API else egl.EGL_OPENGL_ES_API)) != egl.EGL_TRUE) {
+      return HeadlessError.ApiUnavailable;
+    }
+    const config_attribs = [_]egl.EGLint{
+      egl.EGL_SURFACE_TYPE, egl.EGL_PBUFFER_BIT,
+      egl.EGL_RENDERABLE_TYPE, @as(egl.EGLint, switch (backend) {
+        .ogl_32, .ogl_43 => egl.EGL_OPENGL_BIT,
+        .ogles_20 => egl.EGL_OPENGL_ES2_BIT,
+        .ogles_31 => egl.EGL_OPENGL_ES3_BIT_KHR,
+      }),
+      egl.EGL_RED_SIZE, 8, egl.EGL_GREEN_SIZE, 8, egl.EGL_BLUE_SIZE, 8,
+      egl.EGL_ALPHA_SIZE, 8,
+      egl.EGL_NONE,
+    };
+    var config: egl.EGLConfig = undefined;
+    var num_configs: egl.EGLint = 0;
+    if (egl.eglChooseConfig(display, &config_attribs, &config, 1, &num_configs) != egl.EGL_TRUE or num_configs == 0) {
+      return HeadlessError.NoConfig;
+    }
+    const context_attribs = switch (backend) {
+      .ogl_32 => [_]egl.EGLint{
+        egl.EGL_CONTEXT_MAJOR_VERSION, 3, egl.EGL_CONTEXT_MINOR_VERSION, 2,
+        egl.EGL_CONTEXT_OPENGL_PROFILE_MASK, egl.EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        egl.EGL_NONE,
+      },
+      .ogl_43 => [_]egl.EGLint{
+        egl.EGL_CONTEXT_MAJOR_VERSION, 4, egl.EGL_CONTEXT_MINOR_VERSION, 3,
+        egl.EGL_CONTEXT_OPENGL_PROFILE_MASK, egl.EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        egl.EGL_NONE,
+      },
+      .ogles_20 => [_]egl.EGLint{
+        egl.EGL_CONTEXT_MAJOR_VERSION, 2, egl.EGL_CONTEXT_MINOR_VERSION, 0,
+        egl.EGL_NONE, egl.EGL_NONE, egl.EGL_NONE,
+      },
+      .ogles_31 => [_]egl.EGLint{
+        egl.EGL_CONTEXT_MAJOR_VERSION, 3, egl.EGL_CONTEXT_MINOR_VERSION, 1,
+        egl.EGL_NONE, egl.EGL_NONE, egl.EGL_NONE,
+      },
+    };
+    const context = egl.eglCreateContext(display, config, null, &context_attribs);
+    if (context == null) return HeadlessError.ContextCreationFailed;
+    errdefer _ = egl.eglDestroyContext(display, context);
+    if (egl.eglMakeCurrent(display, null, null, context) != egl.EGL_TRUE) {
+      return HeadlessError.MakeCurrentFailed;
+    }
+
+    var ret = HeadlessContext{
+      .display = display,
+      .context = context,
+      .framebuffer = gl.Framebuffer.gen(),
+      .texture = gl.genTexture(),
+      .stencil_buffer = undefined,
+      .width = width,
+      .height = height,
+    };
+    epoxy.glGenRenderbuffers(1, &ret.stencil_buffer);
+    errdefer {
+      ret.framebuffer.delete();
+      ret.texture.delete();
+      epoxy.glDeleteRenderbuffers(1, &ret.stencil_buffer);
+    }
+    gl.bindTexture(ret.texture, .@"2d");
+    gl.texParameter(.@"2d", .mag_filter, .nearest);
+    gl.texParameter(.@"2d", .min_filter, .nearest);
+    gl.textureImage2D(.@"2d", 0, .rgba, width, height, .rgba, .unsigned_byte, null);
+    ret.framebuffer.texture2D(.buffer, .color0, .@"2d", ret.texture, 0);
+    // a stencil buffer, like windows usually have, for filling paths.
+    epoxy.glBindRenderbuffer(epoxy.GL_RENDERBUFFER, ret.stencil_buffer);
+    if (backend == .ogles_20) {
+      epoxy.glRenderbufferStorage(epoxy.GL_RENDERBUFFER, epoxy.GL_STENCIL_INDEX8,
+          @intCast(c_int, width), @intCast(c_int, height));
+      epoxy.glFramebufferRenderbuffer(epoxy.GL_FRAMEBUFFER, epoxy.GL_STENCIL_ATTACHMENT,
+          epoxy.GL_RENDERBUFFER, ret.stencil_buffer);
+    } else {
+      epoxy.glRenderbufferStorage(epoxy.GL_RENDERBUFFER, epoxy.GL_DEPTH24_STENCIL8,
+          @intCast(c_int, width), @intCast(c_int, height));
+      epoxy.glFramebufferRenderbuffer(epoxy.GL_FRAMEBUFFER, epoxy.GL_DEPTH_STENCIL_ATTACHMENT,
+          epoxy.GL_RENDERBUFFER, ret.stencil_buffer);
+    }
+    epoxy.glBindRenderbuffer(epoxy.GL_RENDERBUFFER, 0);
+    if (desktop) {
+      gl.drawBuffers(&[_]gl.FramebufferAttachment{.color0});
+    }
+    if (gl.Framebuffer.checkStatus(.buffer) != .complete) {
+      return HeadlessError.IncompleteFramebuffer;
+    }
+    return ret;
+  }
+
+  /// makeCurrent makes the context current on the calling thread and binds
+  /// its offscreen target. A context can only be current on one thread at a
+  /// time.
+  pub fn makeCurrent(ctx: *HeadlessContext) !void {
+    if (egl.eglMakeCurrent(ctx.display, null, null, ctx.context) != egl.EGL_TRUE) {
+      return HeadlessError.MakeCurrentFailed;
+    }
+    ctx.framebuffer.bind(.buffer);
+  }
+
+  /// destroy destroys the context, which must be current on the calling
+  /// thread. Close any Engine using it beforehand.
+  /// The EGL display is not terminated since it is shared by all contexts of
+  /// the process.
+  pub fn destroy(ctx: *HeadlessContext) void {
+    ctx.framebuffer.delete();
+    ctx.texture.delete();
+    epoxy.glDeleteRenderbuffers(1, &ctx.stencil_buffer);
+    _ = egl.eglMakeCurrent(ctx.display, null, null, null);
+    _ = egl.eglDestroyContext(ctx.display, ctx.context);
+    _ = egl.eglReleaseThread();
+  }
+};
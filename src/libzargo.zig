@@ -33,6 +33,18 @@ export fn zargo_engine_close(e: ?*zargo.Engine) void {
   } else unreachable;
 }
 
+export fn zargo_engine_set_clip(e: ?*zargo.Engine, r: ?*zargo.CRectangle) void {
+  if (e) |engine| {
+    zargo.CEngineInterface.setClip(engine, if (r) |v| v.* else null);
+  } else unreachable;
+}
+
+export fn zargo_engine_read_pixels(e: ?*zargo.Engine, r: ?*zargo.CRectangle, buffer: [*]u8) void {
+  if (e != null and r != null) {
+    zargo.CEngineInterface.readPixels(e.?, r.?.*, buffer[0..4 * @as(usize, r.?.width) * @as(usize, r.?.height)]);
+  } else unreachable;
+}
+
 export fn zargo_engine_fill_unit(e: ?*zargo.Engine, t: ?*zargo.Transform, color: *[4]u8, copy_alpha: bool) void {
   if (e != null and t != null) {
     e.?.fillUnit(t.?.*, color.*, copy_alpha);
@@ -77,6 +89,29 @@ export fn zargo_engine_draw_image(e: ?*zargo.Engine, i: ?*zargo.CImage, dst_tran
   } else unreachable;
 }
 
+export fn zargo_engine_blur_behind(e: ?*zargo.Engine, area: ?*zargo.CRectangle, iterations: u8, offset: f32) bool {
+  if (e) |engine| {
+    if (iterations == 0 or iterations > zargo.max_blur_iterations) return false;
+    const r = if (area) |v| zargo.Rectangle.from(v.*) else engine.area();
+    engine.blurBehind(r, @intCast(u4, iterations), offset) catch return false;
+    return true;
+  } else unreachable;
+}
+
+export fn zargo_engine_push_opacity_group(e: ?*zargo.Engine, alpha: u8, bounds: ?*zargo.CRectangle) bool {
+  if (e) |engine| {
+    const r = if (bounds) |v| zargo.Rectangle.from(v.*) else engine.area();
+    engine.pushOpacityGroup(alpha, r) catch return false;
+    return true;
+  } else unreachable;
+}
+
+export fn zargo_engine_pop_opacity_group(e: ?*zargo.Engine) void {
+  if (e) |engine| {
+    engine.popOpacityGroup();
+  } else unreachable;
+}
+
 export fn zargo_transform_identity(t: ?*zargo.Transform) void {
   if (t) |transform| {
     transform.* = zargo.Transform.identity();
@@ -183,6 +218,9 @@ export fn zargo_canvas_create(out: ?*zargo.CCanvas, e: ?*zargo.Engine, width: u3
       .framebuffer = .invalid,
       .target_image = zargo.Image.empty(),
       .alpha = false,
+      .pooled = false,
+      .prev_x = 0,
+      .prev_y = 0,
       .prev_width = 0,
       .prev_height = 0,
     };
@@ -205,4 +243,319 @@ export fn zargo_canvas_close(c: ?*zargo.CCanvas) void {
   if (c) |canvas| {
     canvas.close();
   } else unreachable;
+}
+
+export fn zargo_layer_create(e: ?*zargo.Engine, width: u32, height: u32, with_alpha: bool) ?*zargo.Layer {
+  if (e) |engine| {
+    var l = std.heap.c_allocator.create(zargo.Layer) catch return null;
+    l.* = zargo.Layer.create(engine, @intCast(u31, width), @intCast(u31, height), with_alpha) catch {
+      std.heap.c_allocator.destroy(l);
+      return null;
+    };
+    return l;
+  } else unreachable;
+}
+
+export fn zargo_layer_invalidate(l: ?*zargo.Layer, r: ?*zargo.CRectangle) void {
+  if (l) |layer| {
+    if (r) |v| layer.invalidate(zargo.Rectangle.from(v.*)) else layer.invalidateAll();
+  } else unreachable;
+}
+
+export fn zargo_layer_begin_update(l: ?*zargo.Layer, region: ?*zargo.CRectangle) bool {
+  if (l) |layer| {
+    const res = (layer.beginUpdate() catch |err| {
+      std.log.scoped(.zargo).err("unable to update layer: {s}", .{@errorName(err)});
+      return false;
+    }) orelse return false;
+    if (region) |v| v.* = zargo.CRectangle.from(res);
+    return true;
+  } else unreachable;
+}
+
+export fn zargo_layer_is_dirty(l: ?*zargo.Layer) bool {
+  if (l) |layer| {
+    return layer.isDirty();
+  } else unreachable;
+}
+
+export fn zargo_layer_end_update(l: ?*zargo.Layer) void {
+  if (l) |layer| {
+    layer.endUpdate();
+  } else unreachable;
+}
+
+export fn zargo_layer_draw(l: ?*zargo.Layer, dst_area: ?*zargo.CRectangle, alpha: u8) void {
+  if (l) |layer| {
+    const dst = if (dst_area) |v| zargo.Rectangle.from(v.*) else layer.area();
+    layer.draw(dst, alpha);
+  } else unreachable;
+}
+
+export fn zargo_layer_free(l: ?*zargo.Layer) void {
+  if (l) |layer| {
+    layer.free();
+    std.heap.c_allocator.destroy(layer);
+  } else unreachable;
+}
+
+export fn zargo_engine_load_font(e: ?*zargo.Engine, path: [*:0]const u8) ?*zargo.Font {
+  if (e) |engine| {
+    var f = std.heap.c_allocator.create(zargo.Font) catch return null;
+    f.* = engine.loadFont(std.mem.span(path)) catch {
+      std.heap.c_allocator.destroy(f);
+      return null;
+    };
+    return f;
+  } else unreachable;
+}
+
+export fn zargo_font_free(f: ?*zargo.Font) void {
+  if (f) |font| {
+    font.free();
+    std.heap.c_allocator.destroy(font);
+  } else unreachable;
+}
+
+export fn zargo_font_load_baked_atlas(f: ?*zargo.Font, path: [*:0]const u8) bool {
+  if (f) |font| {
+    font.loadBakedAtlas(std.mem.span(path)) catch return false;
+    return true;
+  } else unreachable;
+}
+
+export fn zargo_font_set_mode(f: ?*zargo.Font, mode: zargo.Font.Mode) void {
+  if (f) |font| {
+    font.mode = mode;
+  } else unreachable;
+}
+
+export fn zargo_engine_draw_text(e: ?*zargo.Engine, f: ?*zargo.Font, text: [*:0]const u8, x: f32, y: f32, size: u16, color: *[4]u8) void {
+  if (e != null and f != null) {
+    e.?.drawText(f.?, std.mem.span(text), x, y, size, color.*);
+  } else unreachable;
+}
+
+export fn zargo_engine_text_bounds(e: ?*zargo.Engine, f: ?*zargo.Font, text: [*:0]const u8, size: u16, bounds: ?*zargo.CRectangle) void {
+  if (e != null and f != null and bounds != null) {
+    bounds.?.* = zargo.CRectangle.from(e.?.textBounds(f.?, std.mem.span(text), size));
+  } else unreachable;
+}
+
+export fn zargo_engine_start_glyph_workers(e: ?*zargo.Engine, num_workers: c_uint) bool {
+  if (e) |engine| {
+    engine.startGlyphWorkers(num_workers) catch return false;
+    return true;
+  } else unreachable;
+}
+
+export fn zargo_engine_stop_glyph_workers(e: ?*zargo.Engine) void {
+  if (e) |engine| {
+    engine.stopGlyphWorkers();
+  } else unreachable;
+}
+
+export fn zargo_engine_fill_polygon(e: ?*zargo.Engine, points: [*]const [2]f32, count: usize, color: *[4]u8) void {
+  if (e) |engine| {
+    engine.fillPolygon(points[0..count], color.*);
+  } else unreachable;
+}
+
+export fn zargo_engine_fill_polygons(e: ?*zargo.Engine, polygons: [*]const zargo.Polygon, count: usize) void {
+  if (e) |engine| {
+    engine.fillPolygons(polygons[0..count]);
+  } else unreachable;
+}
+
+export fn zargo_engine_create_polyline(e: ?*zargo.Engine, points: [*]const [2]f32, count: usize) ?*zargo.Polyline {
+  if (e) |engine| {
+    var l = std.heap.c_allocator.create(zargo.Polyline) catch return null;
+    l.* = engine.createPolyline(points[0..count]) catch {
+      std.heap.c_allocator.destroy(l);
+      return null;
+    };
+    return l;
+  } else unreachable;
+}
+
+export fn zargo_engine_update_polyline(e: ?*zargo.Engine, l: ?*zargo.Polyline, points: [*]const [2]f32, count: usize) bool {
+  if (e != null and l != null) {
+    e.?.updatePolyline(l.?, points[0..count]) catch return false;
+    return true;
+  } else unreachable;
+}
+
+export fn zargo_polyline_free(l: ?*zargo.Polyline) void {
+  if (l) |line| {
+    line.free();
+    std.heap.c_allocator.destroy(line);
+  } else unreachable;
+}
+
+export fn zargo_engine_draw_polyline(e: ?*zargo.Engine, l: ?*zargo.Polyline, width: f32, color: *[4]u8) void {
+  if (e != null and l != null) {
+    e.?.drawPolyline(l.?.*, width, color.*);
+  } else unreachable;
+}
+
+export fn zargo_engine_stroke_polyline(e: ?*zargo.Engine, points: [*]const [2]f32, count: usize, width: f32, color: *[4]u8) void {
+  if (e) |engine| {
+    engine.strokePolyline(points[0..count], width, color.*);
+  } else unreachable;
+}
+
+export fn zargo_engine_fill_circle(e: ?*zargo.Engine, x: f32, y: f32, radius: f32, color: *[4]u8) void {
+  if (e) |engine| {
+    engine.fillCircle(.{x, y}, radius, color.*);
+  } else unreachable;
+}
+
+export fn zargo_engine_stroke_circle(e: ?*zargo.Engine, x: f32, y: f32, radius: f32, width: f32, color: *[4]u8) void {
+  if (e) |engine| {
+    engine.strokeCircle(.{x, y}, radius, width, color.*);
+  } else unreachable;
+}
+
+export fn zargo_engine_fill_rounded_rect(e: ?*zargo.Engine, r: ?*zargo.CRectangle, radius: f32, color: *[4]u8) void {
+  if (e != null and r != null) {
+    e.?.fillRoundedRect(zargo.Rectangle.from(r.?.*), radius, color.*);
+  } else unreachable;
+}
+
+export fn zargo_engine_stroke_rounded_rect(e: ?*zargo.Engine, r: ?*zargo.CRectangle, radius: f32, width: f32, color: *[4]u8) void {
+  if (e != null and r != null) {
+    e.?.strokeRoundedRect(zargo.Rectangle.from(r.?.*), radius, width, color.*);
+  } else unreachable;
+}
+
+export fn zargo_engine_draw_shapes(e: ?*zargo.Engine, shapes: [*]const zargo.Shape, count: usize) void {
+  if (e) |engine| {
+    engine.drawShapes(shapes[0..count]);
+  } else unreachable;
+}
+
+export fn zargo_engine_fill_gradient_rect(e: ?*zargo.Engine, r: ?*zargo.CRectangle, g: ?*zargo.Gradient) void {
+  if (e != null and r != null and g != null) {
+    e.?.fillGradientRect(zargo.Rectangle.from(r.?.*), g.?.*);
+  } else unreachable;
+}
+
+export fn zargo_engine_fill_gradients(e: ?*zargo.Engine, rects: [*]const zargo.GradientRect, count: usize) void {
+  if (e) |engine| {
+    engine.fillGradients(rects[0..count]);
+  } else unreachable;
+}
+
+export fn zargo_engine_draw_nine_patch(e: ?*zargo.Engine, p: ?*zargo.CNinePatch, dst_area: ?*zargo.CRectangle, alpha: u8) void {
+  if (e != null and p != null and dst_area != null) {
+    zargo.NinePatch.from(p.?.*).draw(e.?, zargo.Rectangle.from(dst_area.?.*), alpha);
+  } else unreachable;
+}
+
+export fn zargo_engine_draw_nine_patches(e: ?*zargo.Engine, draws: [*]const zargo.CNinePatchDraw, count: usize) void {
+  if (e) |engine| {
+    // converted in chunks to avoid allocating.
+    var buffer: [64]zargo.NinePatchDraw = undefined;
+    var i: usize = 0;
+    while (i < count) {
+      const n = std.math.min(count - i, buffer.len);
+      for (buffer[0..n]) |*d, j| d.* = zargo.NinePatchDraw.from(draws[i + j]);
+      engine.drawNinePatches(buffer[0..n]);
+      i += n;
+    }
+  } else unreachable;
+}
+
+export fn zargo_path_new() ?*zargo.Path {
+  var p = std.heap.c_allocator.create(zargo.Path) catch return null;
+  p.* = zargo.Path.init(std.heap.c_allocator);
+  return p;
+}
+
+export fn zargo_path_free(p: ?*zargo.Path) void {
+  if (p) |path| {
+    path.deinit();
+    std.heap.c_allocator.destroy(path);
+  } else unreachable;
+}
+
+export fn zargo_path_move_to(p: ?*zargo.Path, x: f32, y: f32) bool {
+  if (p) |path| {
+    path.moveTo(x, y) catch return false;
+    return true;
+  } else unreachable;
+}
+
+export fn zargo_path_line_to(p: ?*zargo.Path, x: f32, y: f32) bool {
+  if (p) |path| {
+    path.lineTo(x, y) catch return false;
+    return true;
+  } else unreachable;
+}
+
+export fn zargo_path_quad_to(p: ?*zargo.Path, cx: f32, cy: f32, x: f32, y: f32) bool {
+  if (p) |path| {
+    path.quadTo(cx, cy, x, y) catch return false;
+    return true;
+  } else unreachable;
+}
+
+export fn zargo_path_cubic_to(p: ?*zargo.Path, c1x: f32, c1y: f32, c2x: f32, c2y: f32, x: f32, y: f32) bool {
+  if (p) |path| {
+    path.cubicTo(c1x, c1y, c2x, c2y, x, y) catch return false;
+    return true;
+  } else unreachable;
+}
+
+export fn zargo_path_close(p: ?*zargo.Path) bool {
+  if (p) |path| {
+    path.close() catch return false;
+    return true;
+  } else unreachable;
+}
+
+export fn zargo_engine_fill_path(e: ?*zargo.Engine, p: ?*zargo.Path, t: ?*zargo.Transform, rule: zargo.FillRule, color: *[4]u8) void {
+  if (e != null and p != null and t != null) {
+    e.?.fillPath(p.?, t.?.*, rule, color.*);
+  } else unreachable;
+}
+
+export fn zargo_engine_stroke_path(e: ?*zargo.Engine, p: ?*zargo.Path, t: ?*zargo.Transform, width: f32, color: *[4]u8) void {
+  if (e != null and p != null and t != null) {
+    e.?.strokePath(p.?, t.?.*, width, color.*);
+  } else unreachable;
+}
+
+export fn zargo_engine_end_frame(e: ?*zargo.Engine) void {
+  if (e) |engine| {
+    engine.endFrame();
+  } else unreachable;
+}
+
+export fn zargo_engine_freetype_stats(e: ?*zargo.Engine, stats: ?*zargo.FreeTypeStats) void {
+  if (e != null and stats != null) {
+    stats.?.* = e.?.freeTypeStats();
+  } else unreachable;
+}
+
+export fn zargo_font_measure(f: ?*zargo.Font, text: [*:0]const u8, size: u16, advance: ?*f32, bounds: ?*zargo.CRectangle) bool {
+  if (f) |font| {
+    const extents = font.measure(std.mem.span(text), size) catch return false;
+    if (advance) |v| v.* = extents.advance;
+    if (bounds) |v| v.* = zargo.CRectangle.from(extents.bounds);
+    return true;
+  } else unreachable;
+}
+
+export fn zargo_font_break_lines(f: ?*zargo.Font, text: [*:0]const u8, size: u16, max_width: f32, lines: ?*[*]zargo.Font.Line, count: ?*usize) bool {
+  if (f != null and lines != null and count != null) {
+    const ret = f.?.breakLines(std.heap.c_allocator, std.mem.span(text), size, max_width) catch return false;
+    lines.?.* = ret.ptr;
+    count.?.* = ret.len;
+    return true;
+  } else unreachable;
+}
+
+export fn zargo_text_lines_free(lines: [*]zargo.Font.Line, count: usize) void {
+  std.heap.c_allocator.free(lines[0..count]);
 }
\ No newline at end of file
@@ -0,0 +1,283 @@
+const std = @import("std");
+const zargo = @import("zargo.zig");
+
+const Atomic = std.atomic.Atomic;
+const Futex = std.Thread.Futex;
+
+/// Job is a unit of work for a RenderPool.
+/// Embed it into your own struct and use @fieldParentPtr in the callbacks to
+/// access your data.
+pub const Job = struct {
+  /// size of the image the job renders.
+  width: u31,
+  height: u31,
+  /// render draws the job's scene. It is called on a worker thread while a
+  /// canvas with the job's size is active on the worker's engine.
+  render: fn (job: *Job, worker: *Worker) void,
+  /// finished receives the rendered image as RGBA pixels with rows ordered
+  /// bottom-up. It is called on the worker thread, pixels are only valid
+  /// during the call. If the job could not be rendered, e.g. because no
+  /// render target could be allocated, finished is called with empty pixels
+  /// and render is not called.
+  finished: fn (job: *Job, pixels: []const u8) void,
+};
+
+/// Worker is the per-thread state of a RenderPool: an OpenGL context and an
+/// Engine that are only used by one thread.
+pub const Worker = struct {
+  pool: *RenderPool,
+  thread: std.Thread,
+  context: zargo.HeadlessContext,
+  e: zargo.Engine,
+  images: std.StringHashMapUnmanaged(zargo.Image),
+  pixels: std.ArrayListUnmanaged(u8),
+
+  /// image returns the image at the given path as texture of this worker's
+  /// engine. The file is decoded only once for all workers if the pool has
+  /// an ImageCache, and uploaded only once per worker.
+  /// Returns an empty image on failure.
+  pub fn image(w: *Worker, path: [:0]const u8) zargo.Image {
+    if (w.images.get(path)) |value| return value;
+    const ret = if (w.pool.image_cache) |cache|
+      (if (cache.get(path)) |d| w.e.uploadImage(d) else zargo.Image.empty())
+    else w.e.loadImage(path);
+    if (ret.isEmpty()) return ret;
+    const key = w.pool.allocator.dupe(u8, path) catch return ret;
+    w.images.put(w.pool.allocator, key, ret) catch w.pool.allocator.free(key);
+    return ret;
+  }
+
+  fn run(w: *Worker) void {
+    w.setup() catch |err| {
+      std.log.scoped(.zargo).err("unable to initialize render worker: {s}", .{@errorName(err)});
+      w.pool.failed.store(true, .Release);
+      _ = w.pool.ready.fetchAdd(1, .Release);
+      Futex.wake(&w.pool.ready, 1);
+      return;
+    };
+    _ = w.pool.ready.fetchAdd(1, .Release);
+    Futex.wake(&w.pool.ready, 1);
+    defer w.teardown();
+
+    while (true) {
+      const epoch = w.pool.epoch.load(.Acquire);
+      if (w.pool.queue.pop()) |job| {
+        // wakes submit() waiting for a free queue slot.
+        _ = w.pool.freed.fetchAdd(1, .Release);
+        Futex.wake(&w.pool.freed, 1);
+        w.process(job);
+        _ = w.pool.outstanding.fetchSub(1, .AcqRel);
+        Futex.wake(&w.pool.outstanding, std.math.maxInt(u32));
+        continue;
+      }
+      if (w.pool.stopping.load(.Acquire)) break;
+      Futex.wait(&w.pool.epoch, epoch, null) catch unreachable;
+    }
+  }
+
+  fn setup(w: *Worker) !void {
+    w.images = .{};
+    w.pixels = .{};
+    w.context = try zargo.HeadlessContext.create(w.pool.backend, 1, 1);
+    errdefer w.context.destroy();
+    try w.e.init(w.pool.allocator, w.pool.backend, 1, 1, false);
+  }
+
+  fn teardown(w: *Worker) void {
+    var iter = w.images.iterator();
+    while (iter.next()) |entry| {
+      w.pool.allocator.free(entry.key_ptr.*);
+      entry.value_ptr.free();
+    }
+    w.images.deinit(w.pool.allocator);
+    w.pixels.deinit(w.pool.allocator);
+    w.e.close();
+    w.context.destroy();
+  }
+
+  fn process(w: *Worker, job: *Job) void {
+    const pixels = w.renderJob(job) catch |err| {
+      std.log.scoped(.zargo).err("unable to render job: {s}", .{@errorName(err)});
+      job.finished(job, &[_]u8{});
+      return;
+    };
+    job.finished(job, pixels);
+  }
+
+  /// renderJob renders the given job and returns its pixels.
+  fn renderJob(w: *Worker, job: *Job) ![]const u8 {
+    const size = 4 * @as(usize, job.width) * @as(usize, job.height);
+    try w.pixels.resize(w.pool.allocator, size);
+    var target = try w.e.acquireTarget(job.width, job.height, true);
+    defer w.e.releaseTarget(target);
+    var canvas = try zargo.Canvas.createOn(&w.e, target.framebuffer, target.image);
+    w.e.clear([_]u8{0, 0, 0, 0});
+    job.render(job, w);
+    w.e.readPixels(target.image.area(), w.pixels.items);
+    _ = canvas.finish() catch unreachable;
+    return w.pixels.items;
+  }
+};
+
+/// JobQueue is a bounded lock-free multi-producer multi-consumer queue
+/// (after Dmitry Vyukov's design). Each slot carries a sequence number telling
+/// producers and consumers whether it is ready for them.
+const JobQueue = struct {
+  const Slot = struct {
+    seq: Atomic(usize),
+    job: *Job,
+  };
+
+  slots: []Slot,
+  head: Atomic(usize),
+  tail: Atomic(usize),
+
+  fn init(allocator: std.mem.Allocator, capacity: usize) !JobQueue {
+    std.debug.assert(std.math.isPowerOfTwo(capacity));
+    const slots = try allocator.alloc(Slot, capacity);
+    for (slots) |*slot, i| slot.seq = Atomic(usize).init(i);
+    return JobQueue{.slots = slots, .head = Atomic(usize).init(0), .tail = Atomic(usize).init(0)};
+  }
+
+  fn push(q: *JobQueue, job: *Job) bool {
+    var pos = q.tail.load(.Monotonic);
+    while (true) {
+      const slot = &q.slots[pos & (q.slots.len - 1)];
+      const diff = @bitCast(isize, slot.seq.load(.Acquire) -% pos);
+      if (diff == 0) {
+        pos = q.tail.tryCompareAndSwap(pos, pos + 1, .Monotonic, .Monotonic) orelse {
+          slot.job = job;
+          slot.seq.store(pos + 1, .Release);
+          return true;
+        };
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = q.tail.load(.Monotonic);
+      }
+    }
+  }
+
+  fn pop(q: *JobQueue) ?*Job {
+    var pos = q.head.load(.Monotonic);
+    while (true) {
+      const slot = &q.slots[pos & (q.slots.len - 1)];
+      const diff = @bitCast(isize, slot.seq.load(.Acquire) -% (pos + 1));
+      if (diff == 0) {
+        pos = q.head.tryCompareAndSwap(pos, pos + 1, .Monotonic, .Monotonic) orelse {
+          const job = slot.job;
+          slot.seq.store(pos + q.slots.len, .Release);
+          return job;
+        };
+      } else if (diff < 0) {
+        return null;
+      } else {
+        pos = q.head.load(.Monotonic);
+      }
+    }
+  }
+};
+
+/// RenderPool renders jobs in parallel on a number of worker threads.
+/// Each worker has its own headless OpenGL context and Engine, so throughput
+/// scales with the number of cores on llvmpipe or with a GPU that can process
+/// multiple contexts concurrently.
+///
+/// FreeType libraries are not thread-safe and therefore each engine keeps its
+/// own. Decoded images can be shared between the workers with an ImageCache.
+///
+/// The allocator given to init is used from all worker threads and must be
+/// thread-safe.
+pub const RenderPool = struct {
+  allocator: std.mem.Allocator,
+  backend: zargo.Backend,
+  image_cache: ?*zargo.ImageCache,
+  workers: []Worker,
+  queue: JobQueue,
+  /// incremented whenever a job is submitted, workers sleep on it.
+  epoch: Atomic(u32),
+  /// number of submitted jobs that have not yet been processed.
+  outstanding: Atomic(u32),
+  /// incremented whenever a worker takes a job from the queue, submit sleeps
+  /// on it while the queue is full.
+  freed: Atomic(u32),
+  ready: Atomic(u32),
+  failed: Atomic(bool),
+  stopping: Atomic(bool),
+
+  /// init starts num_workers worker threads, each creating an OpenGL context
+  /// for the given backend. Returns an error if any worker fails to
+  /// initialize. pool must not be moved after init.
+  pub fn init(pool: *RenderPool, allocator: std.mem.Allocator, backend: zargo.Backend,
+              num_workers: usize, image_cache: ?*zargo.ImageCache) !void {
+    pool.* = .{
+      .allocator = allocator,
+      .backend = backend,
+      .image_cache = image_cache,
+      .workers = try allocator.alloc(Worker, num_workers),
+      .queue = undefined,
+      .epoch = Atomic(u32).init(0),
+      .outstanding = Atomic(u32).init(0),
+      .freed = Atomic(u32).init(0),
+      .ready = Atomic(u32).init(0),
+      .failed = Atomic(bool).init(false),
+      .stopping = Atomic(bool).init(false),
+    };
+    errdefer allocator.free(pool.workers);
+    pool.queue = try JobQueue.init(allocator, 256);
+    errdefer allocator.free(pool.queue.slots);
+
+    var started: usize = 0;
+    errdefer pool.stop(started);
+    for (pool.workers) |*w| {
+      w.pool = pool;
+      w.thread = try std.Thread.spawn(.{}, Worker.run, .{w});
+      started += 1;
+    }
+    while (true) {
+      const ready = pool.ready.load(.Acquire);
+      if (ready == num_workers) break;
+      Futex.wait(&pool.ready, ready, null) catch unreachable;
+    }
+    if (pool.failed.load(.Acquire)) return error.WorkerInitializationFailed;
+  }
+
+  /// submit queues the given job. If the queue is full, submit blocks until
+  /// a worker has finished a job. job must stay valid until it has finished.
+  pub fn submit(pool: *RenderPool, job: *Job) void {
+    _ = pool.outstanding.fetchAdd(1, .AcqRel);
+    while (true) {
+      // loaded before pushing so that a slot freed after a failed push
+      // changes the value and wait() returns immediately.
+      const freed = pool.freed.load(.Acquire);
+      if (pool.queue.push(job)) break;
+      Futex.wait(&pool.freed, freed, null) catch unreachable;
+    }
+    _ = pool.epoch.fetchAdd(1, .Release);
+    Futex.wake(&pool.epoch, 1);
+  }
+
+  /// wait blocks until all submitted jobs have finished.
+  pub fn wait(pool: *RenderPool) void {
+    while (true) {
+      const outstanding = pool.outstanding.load(.Acquire);
+      if (outstanding == 0) return;
+      Futex.wait(&pool.outstanding, outstanding, null) catch unreachable;
+    }
+  }
+
+  fn stop(pool: *RenderPool, num_started: usize) void {
+    pool.stopping.store(true, .Release);
+    _ = pool.epoch.fetchAdd(1, .Release);
+    Futex.wake(&pool.epoch, std.math.maxInt(u32));
+    for (pool.workers[0..num_started]) |*w| w.thread.join();
+  }
+
+  /// deinit waits for all submitted jobs, then stops the workers.
+  pub fn deinit(pool: *RenderPool) void {
+    pool.wait();
+    pool.stop(pool.workers.len);
+    pool.allocator.free(pool.queue.slots);
+    pool.allocator.free(pool.workers);
+  }
+};
@@ -1,4 +1,8 @@
 const std = @import("std");
+const builtin = @import("builtin");
+
+const Atomic = std.atomic.Atomic;
+const Futex = std.Thread.Futex;
 
 //////////////////////////////////////////////////////////////////////////////
 // Transforms
@@ -98,6 +102,26 @@ fn RectangleImpl(comptime Self: type) type {
       return ret;
     }
 
+    /// intersect returns the area covered by both rectangles, or null if they
+    /// do not overlap.
+    pub fn intersect(r: Self, o: Self) ?Self {
+      const x1 = std.math.max(r.x, o.x);
+      const y1 = std.math.max(r.y, o.y);
+      const x2 = std.math.min(r.x + @intCast(i32, r.width), o.x + @intCast(i32, o.width));
+      const y2 = std.math.min(r.y + @intCast(i32, r.height), o.y + @intCast(i32, o.height));
+      if (x2 <= x1 or y2 <= y1) return null;
+      return Self{.x = x1, .y = y1, .width = @intCast(u31, x2 - x1), .height = @intCast(u31, y2 - y1)};
+    }
+
+    /// unite returns the smallest rectangle containing both rectangles.
+    pub fn unite(r: Self, o: Self) Self {
+      const x1 = std.math.min(r.x, o.x);
+      const y1 = std.math.min(r.y, o.y);
+      const x2 = std.math.max(r.x + @intCast(i32, r.width), o.x + @intCast(i32, o.width));
+      const y2 = std.math.max(r.y + @intCast(i32, r.height), o.y + @intCast(i32, o.height));
+      return Self{.x = x1, .y = y1, .width = @intCast(u31, x2 - x1), .height = @intCast(u31, y2 - y1)};
+    }
+
     /// HAlign describse horizontal alignment.
     pub const HAlign = enum(c_int) {
       left, center, right
@@ -203,6 +227,13 @@ pub const Image = struct {
 
   usingnamespace ImageImpl(@This(), Rectangle);
 
+  pub fn from(i: CImage) Image {
+    return .{
+      .id = i.id, .width = @intCast(u31, i.width), .height = @intCast(u31, i.height),
+      .flipped = i.flipped, .has_alpha = i.has_alpha,
+    };
+  }
+
   /// draw draws the given image with the given engine.
   /// dst_area is the rectangle to draw into.
   /// src_area is the rectangle to draw from – give i.area() to draw the whole
@@ -248,11 +279,166 @@ pub const CImage = extern struct {
   }
 };
 
+/// NinePatch is an area of an image, e.g. of an atlas, that is split into
+/// nine parts by insets from its edges. When drawn into a larger area, the
+/// corners keep their size, the edges are stretched along the sides, and the
+/// center is stretched in both directions. If the target is smaller than
+/// the insets, they shrink proportionally.
+///
+/// As with drawing an image area, texels next to area may be sampled at its
+/// edges, so areas in an atlas should be padded.
+pub const NinePatch = struct {
+  image: Image,
+  /// the area of the image holding the patch.
+  area: Rectangle,
+  left: u31,
+  bottom: u31,
+  right: u31,
+  top: u31,
+
+  pub fn from(p: CNinePatch) NinePatch {
+    return .{
+      .image = Image.from(p.image), .area = Rectangle.from(p.area),
+      .left = @intCast(u31, p.left), .bottom = @intCast(u31, p.bottom),
+      .right = @intCast(u31, p.right), .top = @intCast(u31, p.top),
+    };
+  }
+
+  /// draw draws the patch into dst_area, see Engine.drawNinePatches.
+  pub fn draw(p: NinePatch, e: *Engine, dst_area: Rectangle, alpha: u8) void {
+    e.drawNinePatches(&[_]NinePatchDraw{.{.patch = p, .dst_area = dst_area, .alpha = alpha}});
+  }
+};
+
+pub const CNinePatch = extern struct {
+  image: CImage,
+  area: CRectangle,
+  left: u32,
+  bottom: u32,
+  right: u32,
+  top: u32,
+};
+
+/// NinePatchDraw is a nine-patch drawn into dst_area by
+/// Engine.drawNinePatches. alpha is applied like in Image.draw.
+pub const NinePatchDraw = struct {
+  patch: NinePatch,
+  dst_area: Rectangle,
+  alpha: u8,
+
+  pub fn from(d: CNinePatchDraw) NinePatchDraw {
+    return .{.patch = NinePatch.from(d.patch), .dst_area = Rectangle.from(d.dst_area), .alpha = d.alpha};
+  }
+};
+
+pub const CNinePatchDraw = extern struct {
+  patch: CNinePatch,
+  dst_area: CRectangle,
+  alpha: u8,
+};
+
+/// NinePatchProc draws the parts of nine-patches as textured triangles with
+/// the text vertex shader and the img fragment shader.
+const NinePatchProc = struct {
+  p: gl.Program,
+  transform: u32,
+  position: u32,
+  tex_coord: u32,
+  texture: u32,
+  alpha: u32,
+
+  fn init(vs_src: []const u8, fs_src: []const u8) !NinePatchProc {
+    const p = try linkProgram(vs_src, fs_src);
+    errdefer gl.deleteProgram(p);
+    return NinePatchProc{
+      .p = p,
+      .transform = try getUniformLocation(p, "u_transform"),
+      .position = try getAttribLocation(p, "a_position"),
+      .tex_coord = try getAttribLocation(p, "a_texCoord"),
+      .texture = try getUniformLocation(p, "s_texture"),
+      .alpha = try getUniformLocation(p, "u_alpha"),
+    };
+  }
+};
+
+/// DecodedImage is an image file decoded into CPU memory.
+/// It can be uploaded into a texture with Engine.uploadImage.
+pub const DecodedImage = struct {
+  width: u31,
+  height: u31,
+  num_colors: u8,
+  pixels: [*]const u8,
+};
+
+/// ImageCache decodes image files once and keeps their pixels in CPU memory.
+/// It is thread-safe and can be shared by multiple engines, e.g. the workers
+/// of a RenderPool. Textures are not shared, each engine uploads the decoded
+/// pixels into its own texture.
+pub const ImageCache = struct {
+  allocator: std.mem.Allocator,
+  mutex: std.Thread.Mutex,
+  entries: std.StringHashMapUnmanaged(DecodedImage),
+
+  pub fn init(allocator: std.mem.Allocator) ImageCache {
+    return .{.allocator = allocator, .mutex = .{}, .entries = .{}};
+  }
+
+  /// get returns the decoded image at the given path, decoding it if it has
+  /// not been requested before. Returns null if decoding fails.
+  /// The returned pixels stay valid until the cache is deinitialized.
+  pub fn get(cache: *ImageCache, path: [:0]const u8) ?DecodedImage {
+    cache.mutex.lock();
+    if (cache.entries.get(path)) |value| {
+      cache.mutex.unlock();
+      return value;
+    }
+    cache.mutex.unlock();
+
+    var x: c_int = undefined;
+    var y: c_int = undefined;
+    var n: c_int = undefined;
+    const pixels = c.stbi_load(path, &x, &y, &n, 0);
+    if (pixels == null) return null;
+    const decoded = DecodedImage{
+      .width = @intCast(u31, x), .height = @intCast(u31, y),
+      .num_colors = @intCast(u8, n), .pixels = pixels,
+    };
+
+    cache.mutex.lock();
+    defer cache.mutex.unlock();
+    // another thread may have decoded the same image in the meantime.
+    if (cache.entries.get(path)) |value| {
+      c.stbi_image_free(pixels);
+      return value;
+    }
+    const key = cache.allocator.dupe(u8, path) catch {
+      c.stbi_image_free(pixels);
+      return null;
+    };
+    cache.entries.put(cache.allocator, key, decoded) catch {
+      cache.allocator.free(key);
+      c.stbi_image_free(pixels);
+      return null;
+    };
+    return decoded;
+  }
+
+  pub fn deinit(cache: *ImageCache) void {
+    var iter = cache.entries.iterator();
+    while (iter.next()) |entry| {
+      cache.allocator.free(entry.key_ptr.*);
+      c.stbi_image_free(@intToPtr(*anyopaque, @ptrToInt(entry.value_ptr.pixels)));
+    }
+    cache.entries.deinit(cache.allocator);
+  }
+};
+
 //////////////////////////////////////////////////////////////////////////////
 // Canvas
 
 pub const CanvasError = error {
-  AlreadyClosed
+  AlreadyClosed,
+  IncompleteFramebuffer,
 };
 
 fn CanvasImpl(comptime Self: type, comptime ImgImpl: type, comptime RectImpl: type, comptime EngImpl: type) type {
@@ -261,34 +447,78 @@ fn CanvasImpl(comptime Self: type, comptime ImgImpl: type, comptime RectImpl: ty
     fn reinstatePreviousFb(canvas: *Self) void {
       canvas.e.canvas_count -= 1;
       canvas.previous_framebuffer.bind(.buffer);
-      canvas.framebuffer.delete();
+      if (!canvas.pooled) {
+        canvas.framebuffer.delete();
+        epoxy.glDeleteRenderbuffers(1, &canvas.stencil_buffer);
+      }
       canvas.framebuffer = .invalid;
       if (canvas.e.canvas_count == 0) {
-        canvas.e.target_framebuffer = .{.width = canvas.e.window.width, .height = canvas.e.window.height};
+        EngImpl.setTarget(canvas.e, 0, 0, canvas.e.window.width, canvas.e.window.height);
       } else {
-        canvas.e.target_framebuffer = .{.width = canvas.prev_width, .height = canvas.prev_height};
+        EngImpl.setTarget(canvas.e, canvas.prev_x, canvas.prev_y, canvas.prev_width, canvas.prev_height);
       }
-      gl.viewport(0, 0, canvas.e.target_framebuffer.width, canvas.e.target_framebuffer.height);
+      EngImpl.popClip(canvas.e);
     }
 
     pub fn create(e: *Engine, width: len_type, height: len_type, with_alpha: bool) !Self {
+      try EngImpl.pushClip(e);
       var ret = Self{
         .e = e,
         .previous_framebuffer = @intToEnum(gl.Framebuffer, @intCast(std.meta.Tag(gl.Framebuffer), gl.getInteger(.draw_framebuffer_binding))),
         .framebuffer = gl.Framebuffer.gen(),
+        .stencil_buffer = undefined,
         .target_image = EngImpl.genTexture(e, width, height, if (with_alpha) 3 else 4, true, null),
         .alpha = with_alpha,
+        .pooled = false,
+        .prev_x = e.target_framebuffer.x,
+        .prev_y = e.target_framebuffer.y,
         .prev_width = e.target_framebuffer.width,
         .prev_height = e.target_framebuffer.height,
       };
       ret.framebuffer.texture2D(.buffer, .color0, .@"2d", ret.target_image.id, 0);
+      ret.stencil_buffer = EngImpl.attachStencil(e, width, height);
       if (e.backend == .ogl_32 or e.backend == .ogl_43) {
         gl.drawBuffers(&[_]gl.FramebufferAttachment{.color0});
       }
-      if (gl.Framebuffer.checkStatus(.buffer) != .complete) unreachable;
+      if (gl.Framebuffer.checkStatus(.buffer) != .complete) {
+        // e.g. because the requested size exceeds the maximum texture size.
+        ret.previous_framebuffer.bind(.buffer);
+        ret.framebuffer.delete();
+        epoxy.glDeleteRenderbuffers(1, &ret.stencil_buffer);
+        ret.target_image.free();
+        EngImpl.popClip(e);
+        return CanvasError.IncompleteFramebuffer;
+      }
       gl.clearColor(0, 0, 0, 0);
-      gl.clear(.{.color = true});
+      gl.clear(.{.color = true, .stencil = true});
+      e.canvas_count += 1;
+      EngImpl.setTarget(e, 0, 0, width, height);
+      return ret;
+    }
+
+    /// createOn directs drawing onto an existing framebuffer which renders into
+    /// the given image, typically a RenderTarget acquired from the engine.
+    /// Unlike create, the current content of the image is kept.
+    /// finish() and close() will not free the framebuffer nor the image, they
+    /// stay owned by the caller.
+    pub fn createOn(e: *Engine, framebuffer: gl.Framebuffer, image: ImgImpl) !Self {
+      try EngImpl.pushClip(e);
+      const ret = Self{
+        .e = e,
+        .previous_framebuffer = @intToEnum(gl.Framebuffer, @intCast(std.meta.Tag(gl.Framebuffer), gl.getInteger(.draw_framebuffer_binding))),
+        .framebuffer = framebuffer,
+        .stencil_buffer = 0,
+        .target_image = image,
+        .alpha = image.has_alpha,
+        .pooled = true,
+        .prev_x = e.target_framebuffer.x,
+        .prev_y = e.target_framebuffer.y,
+        .prev_width = e.target_framebuffer.width,
+        .prev_height = e.target_framebuffer.height,
+      };
+      framebuffer.bind(.buffer);
       e.canvas_count += 1;
+      EngImpl.setTarget(e, 0, 0, image.width, image.height);
       return ret;
     }
 
@@ -314,7 +544,9 @@ fn CanvasImpl(comptime Self: type, comptime ImgImpl: type, comptime RectImpl: ty
     pub fn close(canvas: *Self) void {
       if (canvas.framebuffer != .invalid) {
         reinstatePreviousFb(canvas);
-        canvas.target_image.free();
+        if (!canvas.pooled) {
+          canvas.target_image.free();
+        }
       }
     }
   };
@@ -330,12 +562,20 @@ fn CanvasImpl(comptime Self: type, comptime ImgImpl: type, comptime RectImpl: ty
 /// Canvases do stack, so it is safe to create a Canvas while another Canvas is
 /// active. If you take down or frame the new Canvas, the previous canvas will
 /// be active again.
+/// While a canvas is active, the coordinate system spans from (0,0) to
+/// (width, height) of the canvas.
 pub const Canvas = struct {
   e: *Engine,
   previous_framebuffer: gl.Framebuffer,
   framebuffer: gl.Framebuffer,
+  /// stencil buffer of a created canvas, 0 for canvases created on a
+  /// render target.
+  stencil_buffer: c_uint,
   target_image: Image,
   alpha: bool,
+  pooled: bool,
+  prev_x: i32,
+  prev_y: i32,
   prev_width: u32,
   prev_height: u32,
 
@@ -346,14 +586,147 @@ pub const CCanvas = extern struct {
   e: *Engine,
   previous_framebuffer: gl.Framebuffer,
   framebuffer: gl.Framebuffer,
+  stencil_buffer: c_uint,
   target_image: CImage,
   alpha: bool,
+  pooled: bool,
+  prev_x: i32,
+  prev_y: i32,
   prev_width: u32,
   prev_height: u32,
 
   usingnamespace CanvasImpl(@This(), CImage, CRectangle, CEngineInterface);
 };
 
+//////////////////////////////////////////////////////////////////////////////
+// Render targets
+
+/// RenderTarget is an image together with the framebuffer rendering into it.
+/// Render targets are pooled by the engine, see Engine.acquireTarget.
+/// Use Canvas.createOn to draw onto a render target.
+pub const RenderTarget = struct {
+  framebuffer: gl.Framebuffer,
+  stencil_buffer: c_uint,
+  image: Image,
+
+  fn free(t: *RenderTarget) void {
+    t.framebuffer.delete();
+    epoxy.glDeleteRenderbuffers(1, &t.stencil_buffer);
+    t.image.free();
+  }
+};
+
+/// maximum number of unused render targets the engine keeps around.
+const max_pooled_targets = 8;
+
+/// OpacityGroup is the state of a group started with
+/// Engine.pushOpacityGroup.
+const OpacityGroup = struct {
+  alpha: u8,
+  bounds: Rectangle,
+  /// the first draw of the group, deferred until it is clear whether an
+  /// offscreen pass is needed.
+  pending: ?DrawCommand,
+  /// set if drawing offscreen failed, the group is then drawn directly.
+  direct: bool,
+  /// target and canvas of the offscreen pass, once started.
+  target: ?RenderTarget,
+  canvas: Canvas,
+};
+
+//////////////////////////////////////////////////////////////////////////////
+// Layers
+
+/// A Layer caches rendered content in a pooled render target.
+/// Drawing a layer is a single textured quad. Its content is only rendered
+/// again when the layer has been invalidated, and then only the invalidated
+/// region is re-rendered.
+///
+/// Typical usage:
+///
+///   if (try layer.beginUpdate()) |region| {
+///     defer layer.endUpdate();
+///     // draw content intersecting region, in layer coordinates
+///   }
+///   layer.draw(dst_area, 255);
+pub const Layer = struct {
+  e: *Engine,
+  target: RenderTarget,
+  /// region that needs to be re-rendered, in layer coordinates.
+  dirty: ?Rectangle,
+  canvas: ?Canvas,
+
+  /// create acquires a render target of the given size from the engine's pool.
+  /// The new layer is completely dirty.
+  pub fn create(e: *Engine, width: u31, height: u31, with_alpha: bool) !Layer {
+    const t = try e.acquireTarget(width, height, with_alpha);
+    return Layer{.e = e, .target = t, .dirty = t.image.area(), .canvas = null};
+  }
+
+  /// area returns a rectangle with lower left corner at (0,0) that has the
+  /// layer's width and height.
+  pub fn area(l: *const Layer) Rectangle {
+    return l.target.image.area();
+  }
+
+  /// invalidate marks the given region, in layer coordinates, as needing to be
+  /// re-rendered. Multiple invalidated regions are merged into their bounding
+  /// rectangle.
+  pub fn invalidate(l: *Layer, r: Rectangle) void {
+    const clipped = r.intersect(l.area()) orelse return;
+    l.dirty = if (l.dirty) |d| d.unite(clipped) else clipped;
+  }
+
+  /// invalidateAll marks the whole layer as needing to be re-rendered.
+  pub fn invalidateAll(l: *Layer) void {
+    l.dirty = l.area();
+  }
+
+  pub fn isDirty(l: *const Layer) bool {
+    return l.dirty != null;
+  }
+
+  /// beginUpdate returns null if the layer is clean. Otherwise, it directs
+  /// drawing onto the layer, clears the dirty region and restricts drawing to
+  /// it. The dirty region is returned so that the caller can skip content
+  /// not intersecting it. endUpdate must be called after drawing.
+  /// Returns an error if drawing onto the layer fails; the layer then stays
+  /// dirty.
+  pub fn beginUpdate(l: *Layer) !?Rectangle {
+    std.debug.assert(l.canvas == null);
+    const region = l.dirty orelse return null;
+    l.canvas = try Canvas.createOn(l.e, l.target.framebuffer, l.target.image);
+    l.e.setClip(region);
+    gl.clearColor(0, 0, 0, 0);
+    gl.clear(.{.color = true});
+    return region;
+  }
+
+  /// endUpdate finishes an update begun with beginUpdate and marks the layer
+  /// as clean.
+  pub fn endUpdate(l: *Layer) void {
+    if (l.canvas) |*canvas| {
+      _ = canvas.finish() catch unreachable;
+      l.canvas = null;
+      l.dirty = null;
+    }
+  }
+
+  /// draw draws the cached content of the layer into dst_area.
+  /// alpha is applied like in Image.draw.
+  pub fn draw(l: *Layer, dst_area: Rectangle, alpha: u8) void {
+    std.debug.assert(l.canvas == null);
+    l.target.image.drawAll(l.e, dst_area, alpha);
+  }
+
+  /// free returns the layer's render target to the engine's pool.
+  pub fn free(l: *Layer) void {
+    l.endUpdate();
+    l.e.releaseTarget(l.target);
+    l.target.image = Image.empty();
+  }
+};
+
 //////////////////////////////////////////////////////////////////////////////
 // Text rendering
 
@@ -362,684 +735,5431 @@ const ft = @cImport({
   @cInclude("freetype/freetype.h");
   @cInclude("freetype/ftmodapi.h");
   @cInclude("freetype/fterrors.h");
+  @cInclude("freetype/ftoutln.h");
 });
 
-const FreeTypeMemImpl = struct {
-  fn userAllocator(memory: ft.FT_Memory) std.mem.Allocator {
-    return @ptrCast(*std.mem.Allocator, @alignCast(@alignOf(*std.mem.Allocator), memory.*.user)).*;
+/// FreeTypeStats describe the memory FreeType uses.
+pub const FreeTypeStats = extern struct {
+  /// number of allocations FreeType has made so far.
+  allocations: u64 = 0,
+  /// number of blocks currently in use.
+  live_blocks: usize = 0,
+  /// bytes currently in use. Small blocks count with their size class.
+  bytes_in_use: usize = 0,
+  /// bytes taken from the engine's allocator, including unused slab space.
+  reserved_bytes: usize = 0,
+
+  fn add(s: *FreeTypeStats, other: FreeTypeStats) void {
+    s.allocations += other.allocations;
+    s.live_blocks += other.live_blocks;
+    s.bytes_in_use += other.bytes_in_use;
+    s.reserved_bytes += other.reserved_bytes;
   }
+};
 
-  fn allocFunc(memory: ft.FT_Memory, size: c_long) callconv(.C) ?*anyopaque {
-    const slice = userAllocator(memory).allocAdvanced(u8, @alignOf(usize), @intCast(usize, size) + @sizeOf(usize), .at_least) catch return null;
-    const p = @ptrCast([*]usize, slice.ptr);
-    p.* = @intCast(usize, size);
-    return @ptrCast(*anyopaque, p+1);
+/// FreeTypeHeap serves the memory requests of a FreeType library. FreeType
+/// makes lots of small allocations while loading glyphs. Those are served from
+/// slabs of equally sized blocks with one free list per size class, so that
+/// they don't hit the general-purpose allocator. Slabs are aligned to their
+/// size so that the size class of a block is found from its address, without
+/// a header. Larger requests go to the allocator, their sizes are kept in a
+/// map.
+///
+/// A heap is only used by the thread owning its library, except for its
+/// stats, which other threads read with readStats. Slabs are kept until the
+/// heap is deinitialized.
+const FreeTypeHeap = struct {
+  const size_classes = [_]u16{16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048};
+  const slab_size = 16 * 1024;
+  /// alignment of large blocks, like malloc would give.
+  const large_align = 16;
+
+  const FreeBlock = struct {
+    next: ?*FreeBlock,
+  };
+
+  allocator: std.mem.Allocator,
+  memory: ft.FT_MemoryRec_,
+  free_lists: [size_classes.len]?*FreeBlock,
+  /// size class of each slab, keyed by its address.
+  slabs: std.AutoHashMapUnmanaged(usize, u8),
+  /// size of each large block, keyed by its address.
+  large: std.AutoHashMapUnmanaged(usize, usize),
+  /// guards stats, which are updated by alloc and free.
+  stats_mutex: std.Thread.Mutex,
+  stats: FreeTypeStats,
+
+  /// init initializes the heap. h must not be moved afterwards since memory
+  /// refers to it.
+  fn init(h: *FreeTypeHeap, allocator: std.mem.Allocator) void {
+    h.* = .{
+      .allocator = allocator,
+      .memory = .{
+        .user = @ptrCast(*anyopaque, h),
+        .alloc = allocFunc,
+        .free = freeFunc,
+        .realloc = reallocFunc,
+      },
+      .free_lists = [_]?*FreeBlock{null} ** size_classes.len,
+      .slabs = .{},
+      .large = .{},
+      .stats_mutex = .{},
+      .stats = .{},
+    };
   }
 
-  fn freeFunc(memory: ft.FT_Memory, block: ?*anyopaque) callconv(.C) void {
-    const p = @ptrCast([*]usize, @alignCast(@alignOf(usize), block orelse return)) - 1;
-    const slice: []u8 = @ptrCast([*]u8, p)[0..p[0] + @sizeOf(usize)];
-    userAllocator(memory).free(slice);
+  /// deinit frees all memory. Must be called after the library using the
+  /// heap has been closed.
+  fn deinit(h: *FreeTypeHeap) void {
+    var slabs = h.slabs.keyIterator();
+    while (slabs.next()) |addr| {
+      h.allocator.free(@intToPtr([*]align(slab_size) u8, addr.*)[0..slab_size]);
+    }
+    var large = h.large.iterator();
+    while (large.next()) |entry| {
+      h.allocator.free(@intToPtr([*]align(large_align) u8, entry.key_ptr.*)[0..entry.value_ptr.*]);
+    }
+    h.slabs.deinit(h.allocator);
+    h.large.deinit(h.allocator);
   }
 
-  fn reallocFunc(memory: ft.FT_Memory, cur_size: c_long, new_size: c_long, block: ?*anyopaque) callconv(.C) ?*anyopaque {
-    _ = cur_size;
-    const p = @ptrCast([*]usize, @alignCast(@alignOf(usize), block orelse return null)) - 1;
-    const slice = @ptrCast([*]u8, p)[0..p[0] + @sizeOf(usize)];
-    const ret_slice = userAllocator(memory).realloc(slice, @intCast(usize, new_size) + @sizeOf(usize)) catch return null;
-    const rp = @ptrCast([*]usize, ret_slice.ptr);
-    rp.* = @intCast(usize, new_size);
-    return @ptrCast(*anyopaque, rp+1);
+  fn classIndex(size: usize) ?u8 {
+    for (size_classes) |class_size, i| {
+      if (size <= class_size) return @intCast(u8, i);
+    }
+    return null;
   }
-};
 
-pub const Font = extern struct {
+  /// slabClass returns the size class of the slab containing the given
+  /// block, or null if it is a large block.
+  fn slabClass(h: *FreeTypeHeap, block: [*]u8) ?u8 {
+    return h.slabs.get(@ptrToInt(block) & ~@as(usize, slab_size - 1));
+  }
 
-};
+  /// grow adds a slab for the given size class and returns its blocks as
+  /// free list.
+  fn grow(h: *FreeTypeHeap, class: u8) ?*FreeBlock {
+    const slab = h.allocator.allocAdvanced(u8, slab_size, slab_size, .exact) catch return null;
+    h.slabs.put(h.allocator, @ptrToInt(slab.ptr), class) catch {
+      h.allocator.free(slab);
+      return null;
+    };
+    h.stats.reserved_bytes += slab_size;
+    const block_size = size_classes[class];
+    var head: ?*FreeBlock = null;
+    var i: usize = slab_size / block_size;
+    while (i > 0) {
+      i -= 1;
+      const block = @ptrCast(*FreeBlock, @alignCast(@alignOf(FreeBlock), slab.ptr + i * block_size));
+      block.next = head;
+      head = block;
+    }
+    return head;
+  }
 
-//////////////////////////////////////////////////////////////////////////////
-// Engine
+  /// readStats returns a consistent snapshot of the heap's stats. May be
+  /// called from any thread.
+  fn readStats(h: *FreeTypeHeap) FreeTypeStats {
+    h.stats_mutex.lock();
+    defer h.stats_mutex.unlock();
+    return h.stats;
+  }
 
-const gl = @import("zgl");
+  fn alloc(h: *FreeTypeHeap, size: usize) ?[*]u8 {
+    h.stats_mutex.lock();
+    defer h.stats_mutex.unlock();
+    const ret = if (classIndex(size)) |class| blk: {
+      const block = h.free_lists[class] orelse (h.grow(class) orelse return null);
+      h.free_lists[class] = block.next;
+      h.stats.bytes_in_use += size_classes[class];
+      break :blk @ptrCast([*]u8, block);
+    } else blk: {
+      const slice = h.allocator.allocAdvanced(u8, large_align, size, .exact) catch return null;
+      h.large.put(h.allocator, @ptrToInt(slice.ptr), size) catch {
+        h.allocator.free(slice);
+        return null;
+      };
+      h.stats.bytes_in_use += size;
+      h.stats.reserved_bytes += size;
+      break :blk slice.ptr;
+    };
+    h.stats.allocations += 1;
+    h.stats.live_blocks += 1;
+    return ret;
+  }
 
-const c = @cImport({
-  @cInclude("stb_image.h");
-});
+  fn free(h: *FreeTypeHeap, block: [*]u8) void {
+    h.stats_mutex.lock();
+    defer h.stats_mutex.unlock();
+    h.stats.live_blocks -= 1;
+    if (h.slabClass(block)) |class| {
+      const b = @ptrCast(*FreeBlock, @alignCast(@alignOf(FreeBlock), block));
+      b.next = h.free_lists[class];
+      h.free_lists[class] = b;
+      h.stats.bytes_in_use -= size_classes[class];
+    } else {
+      const size = h.large.fetchRemove(@ptrToInt(block)).?.value;
+      h.allocator.free(@alignCast(large_align, block)[0..size]);
+      h.stats.bytes_in_use -= size;
+      h.stats.reserved_bytes -= size;
+    }
+  }
 
-const ShaderError = error {
-  CompilationFailed,
-  LinkingFailed,
-  AttributeProblem
-};
+  fn realloc(h: *FreeTypeHeap, block: [*]u8, new_size: usize) ?[*]u8 {
+    const cur_size = if (h.slabClass(block)) |class| size_classes[class] else h.large.get(@ptrToInt(block)).?;
+    // large blocks are never smaller than the largest size class.
+    if (classIndex(new_size)) |class| {
+      if (size_classes[class] == cur_size) return block;
+    }
+    const ret = h.alloc(new_size) orelse return null;
+    const len = std.math.min(cur_size, new_size);
+    std.mem.copy(u8, ret[0..len], block[0..len]);
+    h.free(block);
+    return ret;
+  }
 
-const EngineError = error {
-  NoDebugAvailable,
-  FreeTypeError,
-};
+  fn fromMemory(memory: ft.FT_Memory) *FreeTypeHeap {
+    return @ptrCast(*FreeTypeHeap, @alignCast(@alignOf(FreeTypeHeap), memory.*.user));
+  }
 
-fn loadShader(src: []const u8, t: gl.ShaderType) !gl.Shader {
-  var shader = gl.createShader(t);
-  gl.shaderSource(shader, 1, &[_][]const u8{src});
-  errdefer gl.deleteShader(shader);
-  gl.compileShader(shader);
-  var compiled = gl.getShader(shader, gl.ShaderParameter.compile_status);
-  if (compiled == 1) {
-    return shader;
+  fn allocFunc(memory: ft.FT_Memory, size: c_long) callconv(.C) ?*anyopaque {
+    return @ptrCast(?*anyopaque, fromMemory(memory).alloc(@intCast(usize, size)));
   }
-  var log = try gl.getShaderInfoLog(shader, std.heap.c_allocator);
-  defer std.heap.c_allocator.free(log);
-  std.log.scoped(.zargo).err("error compiling shader: {s} –– shader source:\n{s}\n-- end shader source", .{log, src});
-  return ShaderError.CompilationFailed;
-}
 
-fn linkProgram(vs_src: []const u8, fs_src: []const u8) !gl.Program {
-  var vertex_shader = try loadShader(vs_src, gl.ShaderType.vertex);
-  errdefer gl.deleteShader(vertex_shader);
-  var fragment_shader = try loadShader(fs_src, gl.ShaderType.fragment);
-  errdefer gl.deleteShader(fragment_shader);
-  var program = gl.createProgram();
-  errdefer gl.deleteProgram(program);
-  gl.attachShader(program, vertex_shader);
-  gl.attachShader(program, fragment_shader);
-  gl.linkProgram(program);
-  var linked = gl.getProgram(program, gl.ProgramParameter.link_status);
-  if (linked == 1) {
-    return program;
+  fn freeFunc(memory: ft.FT_Memory, block: ?*anyopaque) callconv(.C) void {
+    fromMemory(memory).free(@ptrCast([*]u8, block orelse return));
   }
-  var log = try gl.getProgramInfoLog(program, std.heap.c_allocator);
-  defer std.heap.c_allocator.free(log);
-  std.log.scoped(.zargo).err("error compiling shader: {s}", .{log});
-  return ShaderError.LinkingFailed;
-}
 
-fn getUniformLocation(p: gl.Program, name: [:0]const u8) !u32 {
-  if (gl.getUniformLocation(p, name)) |value| {
-    return value;
+  fn reallocFunc(memory: ft.FT_Memory, cur_size: c_long, new_size: c_long, block: ?*anyopaque) callconv(.C) ?*anyopaque {
+    // the heap knows the size of each block.
+    _ = cur_size;
+    const p = @ptrCast([*]u8, block orelse return null);
+    return @ptrCast(?*anyopaque, fromMemory(memory).realloc(p, @intCast(usize, new_size)));
   }
-  std.log.scoped(.zargo).err("unable to get attribute '{s}' location\n", .{name});
-  return ShaderError.AttributeProblem;
+};
+
+test "FreeTypeHeap reuses blocks of a size class and tracks large blocks" {
+  var h: FreeTypeHeap = undefined;
+  h.init(std.testing.allocator);
+  defer h.deinit();
+
+  // requests of the same size class get the block freed last.
+  const small = h.alloc(20) orelse return error.OutOfMemory;
+  h.free(small);
+  const reused = h.alloc(30) orelse return error.OutOfMemory;
+  try std.testing.expectEqual(small, reused);
+  var stats = h.readStats();
+  try std.testing.expectEqual(@as(u64, 2), stats.allocations);
+  try std.testing.expectEqual(@as(usize, 1), stats.live_blocks);
+  try std.testing.expectEqual(@as(usize, 32), stats.bytes_in_use);
+  try std.testing.expectEqual(@as(usize, FreeTypeHeap.slab_size), stats.reserved_bytes);
+
+  // larger requests go to the allocator and keep their exact size.
+  const large = h.alloc(5000) orelse return error.OutOfMemory;
+  std.mem.set(u8, large[0..5000], 42);
+  const grown = h.realloc(large, 6000) orelse return error.OutOfMemory;
+  for (grown[0..5000]) |v| try std.testing.expectEqual(@as(u8, 42), v);
+  stats = h.readStats();
+  try std.testing.expectEqual(@as(usize, 2), stats.live_blocks);
+  try std.testing.expectEqual(@as(usize, 32 + 6000), stats.bytes_in_use);
+  try std.testing.expectEqual(@as(usize, FreeTypeHeap.slab_size + 6000), stats.reserved_bytes);
+
+  h.free(grown);
+  h.free(reused);
+  stats = h.readStats();
+  try std.testing.expectEqual(@as(usize, 0), stats.live_blocks);
+  try std.testing.expectEqual(@as(usize, 0), stats.bytes_in_use);
+  try std.testing.expectEqual(@as(usize, FreeTypeHeap.slab_size), stats.reserved_bytes);
 }
 
-fn getAttribLocation(p: gl.Program, name: [:0]const u8) !u32 {
-  if (gl.getAttribLocation(p, name)) |value| {
-    return value;
+/// freeTypeError logs the given FreeType error and returns
+/// EngineError.FreeTypeError.
+fn freeTypeError(what: []const u8, res: ft.FT_Error) EngineError {
+  if (@hasDecl(ft, "FT_Error_String")) {
+    const msg = std.mem.span(ft.FT_Error_String(res));
+    std.log.scoped(.zargo).err("FreeType {s} error: {s}", .{what, msg});
+  } else {
+    // FT_Error_String not supported in Raspberry Pi FreeType version.
+    std.log.scoped(.zargo).err("FreeType {s} error", .{what});
   }
-  std.log.scoped(.zargo).err("unable to get attribute '{s}' location\n", .{name});
-  return ShaderError.AttributeProblem;
+  return EngineError.FreeTypeError;
 }
 
-fn setUniformColor(id: u32, color: [4]u8) void {
-  gl.uniform4f(id, @intToFloat(f32, color[0]) / 255.0,
-      @intToFloat(f32, color[1]) / 255.0, @intToFloat(f32, color[2]) / 255.0,
-      @intToFloat(f32, color[3]) / 255.0);
+/// size of the glyph atlas pages, limited by the maximum texture size.
+const glyph_atlas_size = 1024;
+/// maximum number of pages the glyph atlas grows to.
+const max_glyph_pages = 4;
+/// glyphs used within this many frames are kept when their page is repacked.
+const warm_glyph_frames = 60;
+
+/// Glyph is a glyph rasterized into the glyph atlas.
+const Glyph = struct {
+  /// atlas page holding the glyph's bitmap.
+  page: u8,
+  /// position and size of the glyph's bitmap on its page.
+  x: u16,
+  y: u16,
+  width: u16,
+  height: u16,
+  /// offset of the bitmap's upper left corner from the pen position.
+  left: i16,
+  top: i16,
+  /// horizontal advance in pixels.
+  advance: f32,
+  /// frame in which the glyph has last been used.
+  last_used: u32,
+};
+
+/// maximum number of shelves on a glyph atlas page. Shelves are at least
+/// three pixels high (one pixel plus padding), so this is never the limiting
+/// factor.
+const max_glyph_shelves = glyph_atlas_size / 2;
+
+/// number of horizontal subpixel positions bitmap glyphs are rasterized at,
+/// so that moving text doesn't jitter.
+const subpixel_phases = 4;
+/// maximum number of subpixel variants of glyphs in the atlas.
+const max_subpixel_variants = 2048;
+/// maximum number of areas of evicted variants kept for reuse.
+const max_recycled_areas = 256;
+
+const SubpixelPosition = struct {
+  /// whole pixel position.
+  origin: f32,
+  phase: u8,
+};
+
+/// subpixelPosition splits the given pen position into a whole pixel position
+/// and the subpixel phase closest to the remainder.
+fn subpixelPosition(pen: f32) SubpixelPosition {
+  const q = @round(pen * subpixel_phases);
+  const origin = @floor(q / subpixel_phases);
+  return .{.origin = origin, .phase = @floatToInt(u8, q - origin * subpixel_phases)};
 }
 
-/// Backend defines the possible backends the engine can use. These are
-/// currently OpenGL 3.2, OpenGL 4.3, OpenGL ES 2.0, and OpenGL ES 3.1.
-/// The differences relevant to the engine are:
+/// GlyphAtlas holds the rasterized glyphs of all fonts of an engine in
+/// single-channel textures, called pages. Glyphs are packed into shelves, i.e.
+/// rows as high as the first glyph placed into them. Each glyph is surrounded
+/// by one pixel of transparent padding so that linear filtering never picks up
+/// neighbors.
 ///
-///  * OpenGL 4.3 will enable you to turn on debug output and is the only
-///    backend with this capability.
-///  * OpenGL 3.2 is the only backend available on macOS.
-///  * OpenGL ES 2.0 is widely supported on mobile devices but does not let you
-///    use MSAA when drawing to a canvas.
-///  * OpenGL ES 3.1 is supported on a small number on recent devices and does
-///    let you use MSAA when drawing to a canvas.
+/// Space is reserved lock-free so that glyph workers can place the glyphs
+/// they rasterize concurrently. Everything else, including uploading and the
+/// glyphs map, is only touched by the render thread.
 ///
-/// Other OpenGL versions are not supported as backends because they don't bring
-/// any relevant functionality.
-pub const Backend = enum(c_int) {
-  ogl_32, ogl_43, ogles_20, ogles_31
-};
+/// When all pages are full, a page is added until there are max_glyph_pages.
+/// After that, the least recently used page is repacked, keeping only the
+/// glyphs used in recent frames. At most one page is repacked per frame;
+/// if more room is needed, the least recently used page is cleared instead.
+/// Cleared glyphs are rasterized again when they are used the next time.
+const GlyphAtlas = struct {
+  const Key = struct {
+    font: u32,
+    index: u32,
+    size: u16,
+    /// horizontal subpixel position in 1/subpixel_phases pixels.
+    phase: u8,
+  };
 
-const ShaderKind = enum {
-  vertex, fragment
-};
+  const Position = struct {
+    page: u8,
+    x: u16,
+    y: u16,
+  };
 
-const Shaders = struct {
-  rect_vertex: []const u8,
-  rect_fragment: []const u8,
-  img_vertex: []const u8,
-  img_fragment: []const u8,
-  blend_vertex: []const u8,
-  blend_fragment: []const u8,
-};
+  const Area = struct {
+    page: u8,
+    x: u16,
+    y: u16,
+    width: u16,
+    height: u16,
+  };
 
-fn genShaders(comptime backend: Backend) Shaders {
-  const builder = struct {
-    fn versionDef() []const u8 {
-      return switch (backend) {
-        .ogl_32, .ogl_43 => "#version 150\n",
-        .ogles_20, .ogles_31 => "#version 100\n",
+  const VariantList = std.TailQueue(Key);
+
+  const Shelf = struct {
+    y: u16,
+    /// 0 while the shelf is being opened. y is valid once this is set.
+    height: Atomic(u16),
+    /// horizontal position of the next glyph.
+    x: Atomic(u16),
+  };
+
+  /// Page is a texture of the atlas.
+  const Page = struct {
+    image: Image,
+    /// copy of the texture's content, used for repacking.
+    pixels: []u8,
+    shelves: [max_glyph_shelves]Shelf,
+    /// upper end of the last opened shelf in the lower 16 bits, number of
+    /// shelves opened so far in the upper 16 bits. Both are updated together
+    /// so that rows are only taken if a shelf is left to put them into.
+    extent: Atomic(u32),
+    /// frame in which a glyph on the page has last been used.
+    last_used: u32,
+
+    fn empty() Page {
+      return .{
+        .image = Image.empty(),
+        .pixels = &[_]u8{},
+        .shelves = [_]Shelf{.{.y = 0, .height = Atomic(u16).init(0), .x = Atomic(u16).init(0)}} ** max_glyph_shelves,
+        .extent = Atomic(u32).init(0),
+        .last_used = 0,
       };
     }
 
-    fn attr(comptime def: []const u8) []const u8 {
-      return switch (backend) {
-        .ogl_32, .ogl_43 => "in ",
-        .ogles_20, .ogles_31 => "attribute ",
-      } ++ def ++ ";\n";
+    /// reserve returns the position of a free area with the given size, or
+    /// null if the page is full. May be called from multiple threads.
+    fn reserve(p: *Page, width: u16, height: u16) ?[2]u16 {
+      const size = @intCast(u16, p.image.width);
+      if (width > size or height > size) return null;
+      var extent = p.extent.load(.Monotonic);
+      var fallback: ?*Shelf = null;
+      for (p.shelves[0..extent >> 16]) |*shelf| {
+        const shelf_height = shelf.height.load(.Acquire);
+        if (shelf_height < height) continue;
+        // don't waste shelves on glyphs much smaller than them if possible.
+        if (shelf_height <= height + height / 2) {
+          if (claim(shelf, size, width)) |x| return [2]u16{x, shelf.y};
+        } else if (fallback == null) fallback = shelf;
+      }
+      while (true) {
+        const top = extent & 0xffff;
+        const index = extent >> 16;
+        if (index == max_glyph_shelves or size - top < height) break;
+        extent = p.extent.tryCompareAndSwap(extent, extent + (1 << 16) + height, .Monotonic, .Monotonic) orelse {
+          const shelf = &p.shelves[index];
+          shelf.y = @intCast(u16, top);
+          shelf.x.store(width, .Monotonic);
+          shelf.height.store(height, .Release);
+          return [2]u16{0, shelf.y};
+        };
+      }
+      if (fallback) |shelf| {
+        if (claim(shelf, size, width)) |x| return [2]u16{x, shelf.y};
+      }
+      return null;
     }
 
-    fn uniform(comptime def: []const u8) []const u8 {
-      return "uniform " ++ def ++ ";\n";
+    /// claim advances the shelf's x by width and returns its previous value,
+    /// or null if the shelf doesn't have enough space left.
+    fn claim(shelf: *Shelf, size: u16, width: u16) ?u16 {
+      var x = shelf.x.load(.Monotonic);
+      while (size - x >= width) {
+        x = shelf.x.tryCompareAndSwap(x, x + width, .Monotonic, .Monotonic) orelse return x;
+      }
+      return null;
     }
 
-    fn varyOut(comptime def: []const u8) []const u8 {
-      return switch (backend) {
-        .ogl_32, .ogl_43 => "out ",
-        .ogles_20, .ogles_31 => "varying ",
-      } ++ def ++ ";\n";
+    /// clear removes all shelves. Must not be called while glyph workers are
+    /// reserving space.
+    fn clear(p: *Page) void {
+      const count = p.extent.load(.Monotonic) >> 16;
+      for (p.shelves[0..count]) |*shelf| shelf.height.store(0, .Monotonic);
+      p.extent.store(0, .Monotonic);
     }
 
-    fn varyIn(comptime def: []const u8) []const u8 {
-      return switch (backend) {
-        .ogl_32, .ogl_43 => "in ",
-        .ogles_20, .ogles_31 => "varying "
-      } ++ def ++ ";\n";
+    /// copyRect copies a rectangle of the given width and height between the
+    /// page's pixels at (x, y) and the tightly packed bitmap. If to_page is
+    /// false, the copy goes from the page into the bitmap.
+    fn copyRect(p: *Page, bitmap: []u8, x: usize, y: usize, width: usize, height: usize, to_page: bool) void {
+      const stride = @intCast(usize, p.image.width);
+      var row: usize = 0;
+      while (row < height) : (row += 1) {
+        const on_page = p.pixels[(y + row) * stride + x..][0..width];
+        const in_bitmap = bitmap[row * width..][0..width];
+        if (to_page) std.mem.copy(u8, on_page, in_bitmap) else std.mem.copy(u8, in_bitmap, on_page);
+      }
     }
+  };
 
-    fn fragColorDef() []const u8 {
-      return switch (backend) {
-        .ogl_32, .ogl_43 => "out vec4 fragColor;\n",
-        .ogles_20, .ogles_31 => "",
-      };
-    }
+  pages: [max_glyph_pages]Page,
+  /// only modified by the render thread while no glyph workers are running.
+  page_count: u8,
+  glyphs: std.AutoHashMapUnmanaged(Key, Glyph),
+  /// subpixel variants, i.e. glyphs with a phase other than 0, ordered from
+  /// least to most recently used.
+  variants: VariantList,
+  variant_nodes: std.AutoHashMapUnmanaged(Key, *VariantList.Node),
+  /// areas of evicted variants, reused for new variants.
+  recycled: std.ArrayListUnmanaged(Area),
+  /// areas of variants evicted since text has last been drawn. Batched quads
+  /// may still sample them, so they are only recycled by releaseEvicted.
+  evicted: std.ArrayListUnmanaged(Area),
+  /// padded bitmap of the glyph being uploaded.
+  scratch: std.ArrayListUnmanaged(u8),
+  /// current frame, advanced by Engine.endFrame.
+  frame: u32,
+  /// frame in which a page has last been repacked.
+  repacked_frame: u32,
 
-    fn fragColor() []const u8 {
-      return switch (backend) {
-        .ogl_32, .ogl_43 => "fragColor",
-        .ogles_20, .ogles_31 => "gl_FragColor",
-      };
-    }
+  fn empty() GlyphAtlas {
+    var ret = GlyphAtlas{
+      .pages = undefined,
+      .page_count = 0,
+      .glyphs = .{},
+      .variants = .{},
+      .variant_nodes = .{},
+      .recycled = .{},
+      .evicted = .{},
+      .scratch = .{},
+      .frame = 0,
+      .repacked_frame = std.math.maxInt(u32),
+    };
+    for (ret.pages) |*p| p.* = Page.empty();
+    return ret;
+  }
 
-    fn texture(comptime args: []const u8) []const u8 {
-      return switch (backend) {
-        .ogl_32, .ogl_43 => "texture(",
-        .ogles_20, .ogles_31 => "texture2D(",
-      } ++ args ++ ")";
+  fn deinit(a: *GlyphAtlas, allocator: std.mem.Allocator) void {
+    for (a.pages[0..a.page_count]) |*p| {
+      p.image.free();
+      allocator.free(p.pixels);
     }
+    while (a.variants.popFirst()) |node| allocator.destroy(node);
+    a.glyphs.deinit(allocator);
+    a.variant_nodes.deinit(allocator);
+    a.recycled.deinit(allocator);
+    a.evicted.deinit(allocator);
+    a.scratch.deinit(allocator);
+  }
 
-    fn precision(comptime def: []const u8) []const u8 {
-      return "precision " ++ def ++ ";\n";
-    }
+  /// addPage adds a page to the atlas, filled with the given pixels if not
+  /// null. Returns false if there are already max_glyph_pages or the page
+  /// cannot be allocated.
+  fn addPage(a: *GlyphAtlas, e: *Engine, pixels: ?[]const u8) bool {
+    if (a.page_count == max_glyph_pages) return false;
+    const size = @intCast(usize, std.math.min(glyph_atlas_size, e.max_tex_size));
+    const p = &a.pages[a.page_count];
+    p.pixels = e.allocator.alloc(u8, size * size) catch return false;
+    if (pixels) |content| std.mem.copy(u8, p.pixels, content) else std.mem.set(u8, p.pixels, 0);
+    p.image = Engine.Impl.genTexture(e, size, size, 1, false, p.pixels.ptr);
+    p.clear();
+    p.last_used = a.frame;
+    a.page_count += 1;
+    return true;
+  }
 
-    fn matMult(comptime m: []const u8, comptime v: []const u8) []const u8 {
-      return "vec2(" ++ m ++ "[0].x * " ++ v ++ ".x + " ++ m ++ "[1].x * " ++ v ++ ".y + " ++ m ++ "[2].x, "
-          ++ m ++ "[0].y * " ++ v ++ ".x + " ++ m ++ "[1].y * " ++ v ++ ".y + " ++ m ++ "[2].y)";
+  /// get returns the glyph with the given key, marking it as used.
+  fn get(a: *GlyphAtlas, key: Key) ?Glyph {
+    const g = a.glyphs.getPtr(key) orelse return null;
+    g.last_used = a.frame;
+    a.pages[g.page].last_used = a.frame;
+    if (key.phase != 0) {
+      if (a.variant_nodes.get(key)) |node| {
+        a.variants.remove(node);
+        a.variants.append(node);
+      }
     }
+    return g.*;
+  }
 
-    fn rect(comptime kind: ShaderKind) []const u8 {
-      return switch(kind) {
-        .vertex => versionDef() ++ uniform("vec2 u_transform[3]")
-            ++ attr("vec2 a_position") ++
-            \\ void main() {
-            \\   gl_Position = vec4(
-            ++     matMult("u_transform", "a_position") ++
-            \\     , 0, 1
-            \\   );
-            \\ }
-          ,
-        .fragment => versionDef() ++ precision("mediump float")
-            ++ uniform("vec4 u_color") ++ fragColorDef() ++
-            "void main() {\n  " ++ fragColor() ++ " = u_color;\n}",
-      };
+  /// dropGlyph removes the glyph with the given key from the atlas.
+  fn dropGlyph(a: *GlyphAtlas, allocator: std.mem.Allocator, key: Key) void {
+    _ = a.glyphs.remove(key);
+    if (a.variant_nodes.fetchRemove(key)) |kv| {
+      a.variants.remove(kv.value);
+      allocator.destroy(kv.value);
     }
+  }
 
-    fn img(comptime kind: ShaderKind) []const u8 {
-      return switch(kind) {
-        .vertex => versionDef()
-            ++ uniform("vec2 u_src_transform[3]")
-            ++ uniform("vec2 u_dst_transform[3]")
-            ++ attr("vec2 a_position")
-            ++ varyOut("vec2 v_texCoord") ++
-            \\ void main() {
-            \\   gl_Position = vec4(
-            ++     matMult("u_dst_transform", "a_position") ++
-            \\     , 0, 1);
-            \\   v_texCoord = vec2(
-            \\     u_src_transform[0].x * a_position.x + u_src_transform[1].x * a_position.y + u_src_transform[2].x,
-            \\     u_src_transform[0].y * a_position.x + u_src_transform[1].y * a_position.y + u_src_transform[2].y
-            \\   );
-            \\ }
-            ,
-        .fragment => versionDef() ++ precision("mediump float")
-            ++ varyIn("vec2 v_texCoord") ++ fragColorDef()
-            ++ uniform("sampler2D s_texture") ++ uniform("float u_alpha") ++
-            \\ void main() {
-            \\   vec4 c =
-            ++ texture("s_texture, v_texCoord") ++ ";\n  "
-            ++ fragColor() ++ " = vec4(c.rgb, u_alpha * c.a);\n}",
-      };
-    }
+  /// track registers a newly inserted subpixel variant. If there are more
+  /// than max_subpixel_variants, the least recently used one is evicted and
+  /// its area is kept for reuse once batched text has been drawn.
+  fn track(a: *GlyphAtlas, allocator: std.mem.Allocator, key: Key) void {
+    // untracked variants just stay until their page is repacked.
+    const node = allocator.create(VariantList.Node) catch return;
+    node.data = key;
+    a.variant_nodes.put(allocator, key, node) catch {
+      allocator.destroy(node);
+      return;
+    };
+    a.variants.append(node);
+    if (a.variants.len <= max_subpixel_variants) return;
 
-    fn blend(comptime kind: ShaderKind) []const u8 {
-      return switch(kind) {
-        .vertex => versionDef()
-            ++ uniform("vec2 u_posTrans[3]")
-            ++ uniform("vec2 u_texTrans[3]")
-            ++ attr("vec2 a_position")
-            ++ varyOut("vec2 v_texCoord") ++
-            \\ void main() {
-            \\   gl_Position = vec4(
-            ++       matMult("u_posTrans", "a_position") ++
-            \\       , 0, 1);
-            \\   vec2 flipped = vec2(a_position.x, 1.0-a_position.y);
-            \\   v_texCoord =
-            ++       matMult("u_texTrans", "flipped") ++
-            \\   ;
-            \\ }
-            ,
-        .fragment => versionDef() ++ precision("mediump float")
-            ++ varyIn("vec2 v_texCoord") ++ fragColorDef()
-            ++ uniform("sampler2D s_texture")
-            ++ uniform("vec4 u_primary")
-            ++ uniform("vec4 u_secondary") ++
-            \\ void main() {
-            \\   float a =
-            ++       texture("s_texture, v_texCoord") ++ ".r;"
-            ++   fragColor() ++ " = a * u_primary + (1.0-a) * u_secondary;" ++
-            \\ }
-      };
+    const oldest = a.variants.popFirst().?;
+    defer allocator.destroy(oldest);
+    _ = a.variant_nodes.remove(oldest.data);
+    const g = (a.glyphs.fetchRemove(oldest.data) orelse return).value;
+    if (g.width > 0 and a.recycled.items.len + a.evicted.items.len < max_recycled_areas) {
+      a.evicted.append(allocator, .{
+        .page = g.page, .x = g.x - 1, .y = g.y - 1, .width = g.width + 2, .height = g.height + 2,
+      }) catch {};
     }
-  };
-  return .{
-    .rect_vertex = builder.rect(.vertex),
-    .rect_fragment = builder.rect(.fragment),
-    .img_vertex = builder.img(.vertex),
-    .img_fragment = builder.img(.fragment),
-    .blend_vertex = builder.blend(.vertex),
-    .blend_fragment = builder.blend(.fragment),
-  };
-}
+  }
 
-fn EngineImpl(comptime Self: type, comptime RectImpl: type, comptime ImgImpl: type) type {
-  const len_type = std.meta.fieldInfo(ImgImpl, .width).field_type;
-  return struct {
-    fn debugCallback(e: *const Self, source: gl.DebugSource,
-        msg_type: gl.DebugMessageType, id: usize, severity: gl.DebugSeverity,
-        message: []const u8) void {
-      _ = id; _ = e;
-      if (msg_type == .@"error") {
-        std.log.scoped(.OpenGL).err("[{s}] {s}: {s}", .{@tagName(severity), @tagName(source), message});
-      } else if (severity != .notification) {
-        std.log.scoped(.OpenGL).warn("[{s}|{s}] {s}: {s}", .{@tagName(msg_type), @tagName(severity), @tagName(source), message});
-      } else {
-        std.log.scoped(.OpenGL).info("[{s}|{s}] {s}: {s}", .{@tagName(msg_type), @tagName(severity), @tagName(source), message});
+  /// takeRecycled returns the position of a recycled area at least as large
+  /// as the given size, if any.
+  fn takeRecycled(a: *GlyphAtlas, width: u16, height: u16) ?Position {
+    for (a.recycled.items) |area, i| {
+      if (area.width >= width and area.height >= height) {
+        _ = a.recycled.swapRemove(i);
+        return Position{.page = area.page, .x = area.x, .y = area.y};
       }
     }
+    return null;
+  }
 
-    /// init initializes the engine and must be called once before using the
-    /// engine. Before initializing the engine, you must create an OpenGL context.
-    /// This is platform dependent and therefore not implemented by the engine.
-    /// You can use libraries like GLFW or SDL to create a context.
-    ///
-    /// The backend you give must match the OpenGL context you created.
-    /// If it doesn't, you will likely get errors from shader compilation.
-    ///
-    /// windows_width and window_height ought to be the size of your OpenGL
-    /// context in pixels. Mind that this must be the *real* pixel size, not the
-    /// virtual pixel size you may get if you have an HiDPI monitor.
-    /// If your window is resizeable, you can change the window size later with
-    /// setWindowSize.
-    ///
-    /// Only set debug to true if backend is ogl_43. No other backend supports
-    /// debug output and will return an error.
-    pub fn init(
-      e: *Self,
-      allocator: std.mem.Allocator,
-      backend: Backend,
-      window_width: u32,
-      window_height: u32,
-      debug: bool,
-    ) !void {
-      e.backend = backend;
-      if (debug) {
-        if (backend != .ogl_43) {
-          return EngineError.NoDebugAvailable;
-        }
-        gl.enable(gl.Capabilities.debug_output);
-        gl.debugMessageCallback(e, debugCallback);
-        //gl.debugMessageInsert(.application, .other, .notification, "initialized debug output");
-      }
-
-      const vertices = [_]f32{0.0, 0.0, 1.0, 0.0, 1.0, 1.0, 0.0, 1.0};
-      e.vbo = gl.genBuffer();
-      gl.bindBuffer(e.vbo, gl.BufferTarget.array_buffer);
-      gl.bufferData(gl.BufferTarget.array_buffer, f32, &vertices, gl.BufferUsage.static_draw);
+  /// releaseEvicted makes the areas of evicted variants available for reuse.
+  /// Must only be called when no batched quads sample them anymore.
+  fn releaseEvicted(a: *GlyphAtlas, allocator: std.mem.Allocator) void {
+    for (a.evicted.items) |area| {
+      a.recycled.append(allocator, area) catch break;
+    }
+    a.evicted.clearRetainingCapacity();
+  }
 
-      switch (backend) {
-        .ogl_32, .ogl_43 => {
-          e.vao = gl.genVertexArray();
-          gl.bindVertexArray(e.vao);
-          e.single_value_color = gl.PixelFormat.red;
-        },
-        else => {
-          e.vao = .invalid;
-          e.single_value_color = gl.PixelFormat.luminance;
-        },
+  /// forgetAreas drops the recycled and evicted areas on the given page.
+  fn forgetAreas(a: *GlyphAtlas, page: u8) void {
+    for ([_]*std.ArrayListUnmanaged(Area){&a.recycled, &a.evicted}) |list| {
+      var i: usize = 0;
+      while (i < list.items.len) {
+        if (list.items[i].page == page) {
+          _ = list.swapRemove(i);
+        } else i += 1;
       }
+    }
+  }
 
-      e.canvas_count = 0;
-
-      const shaders = switch (backend) {
-        .ogl_32 => genShaders(.ogl_32),
-        .ogl_43 => genShaders(.ogl_43),
-        .ogles_20 => genShaders(.ogles_20),
-        .ogles_31 => genShaders(.ogles_31)
-      };
+  /// reserve returns the position of a free area with the given size, or
+  /// null if all pages are full. May be called from multiple threads.
+  fn reserve(a: *GlyphAtlas, width: u16, height: u16) ?Position {
+    // try the newest page first, older ones are likely full.
+    var i = a.page_count;
+    while (i > 0) {
+      i -= 1;
+      if (a.pages[i].reserve(width, height)) |pos| return Position{.page = i, .x = pos[0], .y = pos[1]};
+    }
+    return null;
+  }
 
-      var rect_proc = try linkProgram(shaders.rect_vertex, shaders.rect_fragment);
-      errdefer gl.deleteProgram(rect_proc);
-      e.rect_proc = .{
-        .p = rect_proc,
-        .transform = try getUniformLocation(rect_proc, "u_transform"),
-        .position  = try getAttribLocation(rect_proc, "a_position"),
-        .color     = try getUniformLocation(rect_proc, "u_color"),
-      };
+  /// makeRoom frees space after a glyph didn't fit into the atlas, see
+  /// GlyphAtlas. If aggressive is true, the least recently used page is
+  /// cleared instead of repacked. Glyphs may move, so text already batched
+  /// must have been drawn.
+  fn makeRoom(a: *GlyphAtlas, e: *Engine, aggressive: bool) void {
+    if (a.addPage(e, null)) return;
+    var victim: u8 = 0;
+    for (a.pages[0..a.page_count]) |*p, i| {
+      if (a.frame -% p.last_used > a.frame -% a.pages[victim].last_used) victim = @intCast(u8, i);
+    }
+    if (!aggressive and a.repacked_frame != a.frame) {
+      a.repacked_frame = a.frame;
+      a.repack(e, victim);
+    } else a.clearPage(e.allocator, victim);
+  }
 
-      var img_proc = try linkProgram(shaders.img_vertex, shaders.img_fragment);
-      errdefer gl.deleteProgram(img_proc);
-      e.img_proc = .{
-        .p = img_proc,
-        .src_transform = try getUniformLocation(img_proc, "u_src_transform"),
-        .dst_transform = try getUniformLocation(img_proc, "u_dst_transform"),
-        .position = try getAttribLocation(img_proc, "a_position"),
-        .texture = try getUniformLocation(img_proc, "s_texture"),
-        .alpha = try getUniformLocation(img_proc, "u_alpha"),
+  /// clearPage removes all glyphs from the given page.
+  fn clearPage(a: *GlyphAtlas, allocator: std.mem.Allocator, page: u8) void {
+    var keys = std.ArrayList(Key).init(allocator);
+    defer keys.deinit();
+    var everything = false;
+    var iter = a.glyphs.iterator();
+    while (iter.next()) |entry| {
+      const g = entry.value_ptr;
+      if (g.page != page or g.width == 0) continue;
+      keys.append(entry.key_ptr.*) catch {
+        everything = true;
+        break;
       };
+    }
+    if (everything) {
+      // out of memory, fall back to clearing the whole atlas.
+      while (a.variants.popFirst()) |node| allocator.destroy(node);
+      a.variant_nodes.clearRetainingCapacity();
+      a.glyphs.clearRetainingCapacity();
+      a.recycled.clearRetainingCapacity();
+      a.evicted.clearRetainingCapacity();
+      for (a.pages[0..a.page_count]) |*p| p.clear();
+      return;
+    }
+    for (keys.items) |key| a.dropGlyph(allocator, key);
+    a.forgetAreas(page);
+    a.pages[page].clear();
+  }
 
-      var blend_proc = try linkProgram(shaders.blend_vertex, shaders.blend_fragment);
-      errdefer gl.deleteProgram(blend_proc);
-      e.blend_proc = .{
-        .p = blend_proc,
-        .posTrans = try getUniformLocation(blend_proc, "u_posTrans"),
-        .texTrans = try getUniformLocation(blend_proc, "u_texTrans"),
-        .position = try getAttribLocation(blend_proc, "a_position"),
-        .texture = try getUniformLocation(blend_proc, "s_texture"),
-        .primary = try getUniformLocation(blend_proc, "u_primary"),
-        .secondary = try getUniformLocation(blend_proc, "u_secondary"),
-      };
+  fn tallerFirst(a: *GlyphAtlas, lhs: Key, rhs: Key) bool {
+    return a.glyphs.get(lhs).?.height > a.glyphs.get(rhs).?.height;
+  }
 
-      gl.disable(gl.Capabilities.depth_test);
-      gl.depthMask(false);
-      e.max_tex_size = gl.getInteger(gl.Parameter.max_texture_size);
-      e.setWindowSize(window_width, window_height);
+  /// repack packs the glyphs of the given page that have been used within
+  /// the last warm_glyph_frames anew and removes all others, then uploads the
+  /// page in one go.
+  fn repack(a: *GlyphAtlas, e: *Engine, page: u8) void {
+    const allocator = e.allocator;
+    const p = &a.pages[page];
+    var warm = std.ArrayList(Key).init(allocator);
+    defer warm.deinit();
+    var cold = std.ArrayList(Key).init(allocator);
+    defer cold.deinit();
+    var size: usize = 0;
+    var iter = a.glyphs.iterator();
+    while (iter.next()) |entry| {
+      const g = entry.value_ptr;
+      if (g.page != page or g.width == 0) continue;
+      if (a.frame -% g.last_used <= warm_glyph_frames) {
+        warm.append(entry.key_ptr.*) catch return a.clearPage(allocator, page);
+        size += @as(usize, g.width) * g.height;
+      } else cold.append(entry.key_ptr.*) catch return a.clearPage(allocator, page);
+    }
+    for (cold.items) |key| a.dropGlyph(allocator, key);
+    a.forgetAreas(page);
 
-      e.allocator = allocator;
-      e.freetype_memory = .{
-        .user = @ptrCast(*anyopaque, &e.allocator),
-        .alloc = FreeTypeMemImpl.allocFunc,
-        .free = FreeTypeMemImpl.freeFunc,
-        .realloc = FreeTypeMemImpl.reallocFunc,
+    // save the bitmaps of the glyphs to keep, then place them anew, tallest
+    // first since that fills shelves best.
+    const saved = allocator.alloc(u8, size) catch return a.clearPage(allocator, page);
+    defer allocator.free(saved);
+    std.sort.sort(Key, warm.items, a, tallerFirst);
+    var offset: usize = 0;
+    for (warm.items) |key| {
+      const g = a.glyphs.get(key).?;
+      const len = @as(usize, g.width) * g.height;
+      p.copyRect(saved[offset..][0..len], g.x, g.y, g.width, g.height, false);
+      offset += len;
+    }
+    p.clear();
+    std.mem.set(u8, p.pixels, 0);
+    offset = 0;
+    for (warm.items) |key| {
+      const g = a.glyphs.getPtr(key).?;
+      const len = @as(usize, g.width) * g.height;
+      const bitmap = saved[offset..][0..len];
+      offset += len;
+      const pos = p.reserve(g.width + 2, g.height + 2) orelse {
+        a.dropGlyph(allocator, key);
+        continue;
       };
-      const ft_res = ft.FT_New_Library(&e.freetype_memory, &e.freetype_lib);
-      if (ft_res != 0) {
-        gl.deleteBuffer(e.vbo);
-        if (e.vao != .invalid) {
-          gl.deleteVertexArray(e.vao);
-        }
-        if (@hasField(ft, "FT_Error_String")) {
-          const msg = std.mem.span(ft.FT_Error_String(ft_res));
-          std.log.scoped(.zargo).err("FreeType init error: {s}", .{msg});
-        } else {
-          // FT_Error_String not supported in Raspberry Pi FreeType version.
-          std.log.scoped(.zargo).err("FreeType init error", .{});
-        }
-        return EngineError.FreeTypeError;
-      }
+      g.x = pos[0] + 1;
+      g.y = pos[1] + 1;
+      p.copyRect(bitmap, g.x, g.y, g.width, g.height, true);
     }
+    gl.bindTexture(p.image.id, .@"2d");
+    gl.pixelStore(.unpack_alignment, 1);
+    epoxy.glTexSubImage2D(epoxy.GL_TEXTURE_2D, 0, 0, 0,
+        @intCast(c_int, p.image.width), @intCast(c_int, p.image.height),
+        @intCast(c_uint, @enumToInt(e.single_value_color)), epoxy.GL_UNSIGNED_BYTE,
+        p.pixels.ptr);
+  }
 
-    /// setWindowSize updates the window size.
-    /// The window size is the coordinate system for Rectangles and Transforms.
-    pub fn setWindowSize(e: *Self, width: u32, height: u32) void {
-      e.window = .{.width = width, .height = height};
-      if (e.canvas_count == 0) {
-        e.target_framebuffer = .{.width = e.window.width, .height = e.window.height};
-        gl.viewport(0, 0, width, height);
-      }
-      e.view_transform = Transform.identity().translate(-1.0, -1.0).scale(
-        2.0 / @intToFloat(f32, width), 2.0 / @intToFloat(f32, height));
+  /// upload writes the given bitmap, surrounded by padding, into the atlas at
+  /// the given position.
+  fn upload(a: *GlyphAtlas, e: *Engine, pos: Position, pixels: []const u8, bitmap_width: usize, bitmap_height: usize) !void {
+    const width = bitmap_width + 2;
+    const height = bitmap_height + 2;
+    try a.scratch.resize(e.allocator, width * height);
+    std.mem.set(u8, a.scratch.items, 0);
+    var row: usize = 0;
+    while (row < bitmap_height) : (row += 1) {
+      std.mem.copy(u8, a.scratch.items[(row + 1) * width + 1..][0..bitmap_width],
+          pixels[row * bitmap_width..][0..bitmap_width]);
     }
+    const p = &a.pages[pos.page];
+    p.copyRect(a.scratch.items, pos.x, pos.y, width, height, true);
+    gl.bindTexture(p.image.id, .@"2d");
+    gl.pixelStore(.unpack_alignment, 1);
+    epoxy.glTexSubImage2D(epoxy.GL_TEXTURE_2D, 0, pos.x, pos.y,
+        @intCast(c_int, width), @intCast(c_int, height),
+        @intCast(c_uint, @enumToInt(e.single_value_color)), epoxy.GL_UNSIGNED_BYTE,
+        a.scratch.items.ptr);
+  }
 
-    pub fn area(e: *Self) RectImpl {
-      return RectImpl{.x = 0, .y = 0, .width = @intCast(u31, e.window.width), .height = @intCast(u31, e.window.height)};
+  /// insert adds a rasterized glyph to the atlas, uploading its bitmap to the
+  /// given position, or to newly reserved space if pos is null.
+  /// Returns null if uploading fails.
+  fn insert(a: *GlyphAtlas, e: *Engine, key: Key, r: RasterizedGlyph, pos: ?Position) GlyphError!?Glyph {
+    var ret = r.glyph;
+    ret.last_used = a.frame;
+    if (key.phase != 0) a.track(e.allocator, key);
+    if (ret.width > 0 and ret.height > 0) {
+      const p = pos orelse
+          (if (key.phase != 0) a.takeRecycled(ret.width + 2, ret.height + 2) else null) orelse
+          a.reserve(ret.width + 2, ret.height + 2) orelse return GlyphError.AtlasFull;
+      a.upload(e, p, r.pixels, ret.width, ret.height) catch return null;
+      ret.page = p.page;
+      ret.x = p.x + 1;
+      ret.y = p.y + 1;
+      a.pages[p.page].last_used = a.frame;
     }
+    // if this fails, the glyph will just be rasterized again.
+    a.glyphs.put(e.allocator, key, ret) catch {};
+    return ret;
+  }
+};
 
-    /// clear clears the current framebuffer to be of the given color.
-    pub fn clear(e: *Self, color: [4]u8) void {
-      _ = e;
+const GlyphError = error {
+  AtlasFull,
+};
+
+/// em size in pixels at which glyphs of SDF fonts are stored in the atlas.
+const sdf_glyph_size = 32;
+/// distance in pixels at sdf_glyph_size from the outline at which the distance
+/// field saturates.
+const sdf_spread = 4;
+/// SDF glyphs are generated from outlines rasterized at this multiple of
+/// sdf_glyph_size.
+const sdf_oversampling = 4;
+
+/// edt1d computes the squared euclidean distance transform of f into d, after
+/// Felzenszwalb and Huttenlocher. v and z are temporary storage of at least
+/// f.len and f.len + 1 items.
+fn edt1d(f: []const f64, d: []f64, v: []usize, z: []f64) void {
+  const inf = std.math.inf(f64);
+  var k: usize = 0;
+  v[0] = 0;
+  z[0] = -inf;
+  z[1] = inf;
+  var q: usize = 1;
+  while (q < f.len) : (q += 1) {
+    const fq = @intToFloat(f64, q);
+    var s: f64 = undefined;
+    while (true) {
+      const r = @intToFloat(f64, v[k]);
+      s = ((f[q] + fq * fq) - (f[v[k]] + r * r)) / (2.0 * fq - 2.0 * r);
+      // z[0] is -inf, so this never goes below 0.
+      if (s > z[k]) break;
+      k -= 1;
+    }
+    k += 1;
+    v[k] = q;
+    z[k] = s;
+    z[k + 1] = inf;
+  }
+  k = 0;
+  q = 0;
+  while (q < f.len) : (q += 1) {
+    const fq = @intToFloat(f64, q);
+    while (z[k + 1] < fq) k += 1;
+    const r = fq - @intToFloat(f64, v[k]);
+    d[q] = r * r + f[v[k]];
+  }
+}
+
+/// edt computes the squared euclidean distance transform of the given grid in
+/// place: Each cell initially holds 0 for feature cells and a large value
+/// for all others, and afterwards holds the squared distance to the nearest
+/// feature cell.
+fn edt(allocator: std.mem.Allocator, grid: []f64, width: usize, height: usize) !void {
+  const len = std.math.max(width, height);
+  const f = try allocator.alloc(f64, len);
+  defer allocator.free(f);
+  const d = try allocator.alloc(f64, len);
+  defer allocator.free(d);
+  const v = try allocator.alloc(usize, len);
+  defer allocator.free(v);
+  const z = try allocator.alloc(f64, len + 1);
+  defer allocator.free(z);
+
+  var x: usize = 0;
+  while (x < width) : (x += 1) {
+    var y: usize = 0;
+    while (y < height) : (y += 1) f[y] = grid[y * width + x];
+    edt1d(f[0..height], d, v, z);
+    y = 0;
+    while (y < height) : (y += 1) grid[y * width + x] = d[y];
+  }
+  var y: usize = 0;
+  while (y < height) : (y += 1) {
+    const row = grid[y * width..][0..width];
+    std.mem.copy(f64, f[0..width], row);
+    edt1d(f[0..width], d, v, z);
+    std.mem.copy(f64, row, d[0..width]);
+  }
+}
+
+/// SdfBitmap is a signed distance field of a glyph. Its metrics are in pixels
+/// at sdf_glyph_size.
+const SdfBitmap = struct {
+  pixels: []u8,
+  width: usize,
+  height: usize,
+  left: i32,
+  top: i32,
+};
+
+/// sdfFromBitmap generates a signed distance field from a glyph outline
+/// rendered at sdf_oversampling times sdf_glyph_size. left and top are the
+/// offset of the bitmap's upper left corner from the pen position.
+///
+/// The result has 1/sdf_oversampling of the bitmap's resolution and a border
+/// of sdf_spread pixels. The outline is at value 128, values decrease to 0 at
+/// sdf_spread pixels outside of the outline and increase to 255 inside.
+fn sdfFromBitmap(allocator: std.mem.Allocator, bitmap: *const ft.FT_Bitmap, left: i32, top: i32) !SdfBitmap {
+  const over = sdf_oversampling;
+  const pad = sdf_spread * over;
+  // align the bitmap so that the pen position is on a pixel boundary of the
+  // distance field.
+  const sdf_left = @divFloor(left, over) - sdf_spread;
+  const sdf_top = -@divFloor(-top, over) + sdf_spread;
+  const off_x = @intCast(usize, left - sdf_left * over);
+  const off_y = @intCast(usize, sdf_top * over - top);
+  const width = (off_x + bitmap.width + pad + over - 1) / over;
+  const height = (off_y + bitmap.rows + pad + over - 1) / over;
+  const grid_width = width * over;
+  const grid_height = height * over;
+
+  // to_inside holds distances to the nearest covered cell, to_outside those to
+  // the nearest uncovered cell.
+  const to_inside = try allocator.alloc(f64, grid_width * grid_height);
+  defer allocator.free(to_inside);
+  const to_outside = try allocator.alloc(f64, grid_width * grid_height);
+  defer allocator.free(to_outside);
+  const far = 1.0e20;
+  var y: usize = 0;
+  while (y < grid_height) : (y += 1) {
+    var x: usize = 0;
+    while (x < grid_width) : (x += 1) {
+      const covered = x >= off_x and x - off_x < bitmap.width and y >= off_y and y - off_y < bitmap.rows and blk: {
+        const row = y - off_y;
+        const src = if (bitmap.pitch >= 0)
+          bitmap.buffer + row * @intCast(usize, bitmap.pitch)
+        else
+          bitmap.buffer + (bitmap.rows - 1 - row) * @intCast(usize, -bitmap.pitch);
+        break :blk src[x - off_x] >= 128;
+      };
+      to_inside[y * grid_width + x] = if (covered) 0 else far;
+      to_outside[y * grid_width + x] = if (covered) far else 0;
+    }
+  }
+  try edt(allocator, to_inside, grid_width, grid_height);
+  try edt(allocator, to_outside, grid_width, grid_height);
+
+  const pixels = try allocator.alloc(u8, width * height);
+  errdefer allocator.free(pixels);
+  y = 0;
+  while (y < height) : (y += 1) {
+    var x: usize = 0;
+    while (x < width) : (x += 1) {
+      // average the signed distances of the grid cells within the pixel,
+      // measured from cell boundaries.
+      var sum: f64 = 0;
+      var gy: usize = y * over;
+      while (gy < (y + 1) * over) : (gy += 1) {
+        var gx: usize = x * over;
+        while (gx < (x + 1) * over) : (gx += 1) {
+          const i = gy * grid_width + gx;
+          sum += if (to_inside[i] == 0) @sqrt(to_outside[i]) - 0.5 else 0.5 - @sqrt(to_inside[i]);
+        }
+      }
+      const dist = sum / (over * over * over);
+      const value = std.math.clamp(0.5 + dist / (2.0 * sdf_spread), 0.0, 1.0);
+      pixels[y * width + x] = @floatToInt(u8, @round(value * 255.0));
+    }
+  }
+  return SdfBitmap{.pixels = pixels, .width = width, .height = height, .left = sdf_left, .top = sdf_top};
+}
+
+/// RasterizedGlyph is a glyph that has been rasterized but not yet placed in
+/// the atlas. pixels holds width * height bytes, rows ordered top-down.
+const RasterizedGlyph = struct {
+  glyph: Glyph,
+  pixels: []u8,
+};
+
+/// rasterizeGlyph renders the glyph with the given index at the face's current
+/// size, shifted right by phase / subpixel_phases pixels. If sdf is true, the
+/// face's size must be sdf_glyph_size * sdf_oversampling and the result is a
+/// distance field with metrics given at sdf_glyph_size. The returned pixels
+/// are allocated with allocator.
+/// Returns null and logs an error on failure.
+fn rasterizeGlyph(allocator: std.mem.Allocator, face: ft.FT_Face, index: u32, sdf: bool, phase: u8) ?RasterizedGlyph {
+  var res = ft.FT_Load_Glyph(face, index, if (phase == 0) ft.FT_LOAD_RENDER else ft.FT_LOAD_DEFAULT);
+  if (res != 0) {
+    _ = freeTypeError("glyph loading", res);
+    return null;
+  }
+  const slot = face.*.glyph;
+  if (phase != 0) {
+    // bitmap glyphs, e.g. of emoji fonts, can't be shifted.
+    if (slot.*.format == @intCast(@TypeOf(slot.*.format), ft.FT_GLYPH_FORMAT_OUTLINE)) {
+      ft.FT_Outline_Translate(&slot.*.outline, @as(ft.FT_Pos, phase) * (64 / subpixel_phases), 0);
+    }
+    res = ft.FT_Render_Glyph(slot, @intCast(c_uint, ft.FT_RENDER_MODE_NORMAL));
+    if (res != 0) {
+      _ = freeTypeError("glyph rendering", res);
+      return null;
+    }
+  }
+  const bitmap = &slot.*.bitmap;
+  var ret = Glyph{
+    .page = 0, .x = 0, .y = 0,
+    .width = @intCast(u16, bitmap.width), .height = @intCast(u16, bitmap.rows),
+    .left = @intCast(i16, slot.*.bitmap_left), .top = @intCast(i16, slot.*.bitmap_top),
+    .advance = @intToFloat(f32, slot.*.advance.x) / 64.0,
+    .last_used = 0,
+  };
+  if (sdf) ret.advance /= sdf_oversampling;
+  if (ret.width == 0 or ret.height == 0) {
+    ret.width = 0;
+    ret.height = 0;
+    return RasterizedGlyph{.glyph = ret, .pixels = &[_]u8{}};
+  }
+  if (bitmap.pixel_mode != ft.FT_PIXEL_MODE_GRAY) {
+    std.log.scoped(.zargo).err("unsupported glyph pixel mode: {}", .{bitmap.pixel_mode});
+    return null;
+  }
+  if (sdf) {
+    const v = sdfFromBitmap(allocator, bitmap, slot.*.bitmap_left, slot.*.bitmap_top) catch {
+      std.log.scoped(.zargo).err("SDF generation: out of memory", .{});
+      return null;
+    };
+    ret.width = @intCast(u16, v.width);
+    ret.height = @intCast(u16, v.height);
+    ret.left = @intCast(i16, v.left);
+    ret.top = @intCast(i16, v.top);
+    return RasterizedGlyph{.glyph = ret, .pixels = v.pixels};
+  }
+  const pixels = allocator.alloc(u8, @as(usize, ret.width) * ret.height) catch {
+    std.log.scoped(.zargo).err("glyph rasterization: out of memory", .{});
+    return null;
+  };
+  var row: usize = 0;
+  while (row < ret.height) : (row += 1) {
+    // FreeType stores rows bottom-up if pitch is negative.
+    const src = if (bitmap.pitch >= 0)
+      bitmap.buffer + row * @intCast(usize, bitmap.pitch)
+    else
+      bitmap.buffer + (ret.height - 1 - row) * @intCast(usize, -bitmap.pitch);
+    std.mem.copy(u8, pixels[row * ret.width..][0..ret.width], src[0..ret.width]);
+  }
+  return RasterizedGlyph{.glyph = ret, .pixels = pixels};
+}
+
+/// TextProc is a program drawing glyphs from the glyph atlas.
+const TextProc = struct {
+  p: gl.Program,
+  transform: u32,
+  position: u32,
+  tex_coord: u32,
+  texture: u32,
+  color: u32,
+  /// only available in the SDF program.
+  smoothing: u32,
+
+  fn init(vs_src: []const u8, fs_src: []const u8, sdf: bool) !TextProc {
+    const p = try linkProgram(vs_src, fs_src);
+    errdefer gl.deleteProgram(p);
+    return TextProc{
+      .p = p,
+      .transform = try getUniformLocation(p, "u_transform"),
+      .position = try getAttribLocation(p, "a_position"),
+      .tex_coord = try getAttribLocation(p, "a_texCoord"),
+      .texture = try getUniformLocation(p, "s_texture"),
+      .color = try getUniformLocation(p, "u_color"),
+      .smoothing = if (sdf) try getUniformLocation(p, "u_smoothing") else 0,
+    };
+  }
+};
+
+/// FontData is the content of a font file. It is memory-mapped where possible,
+/// so that large fonts take up page cache shared with other processes instead
+/// of private heap. The faces of all threads are created over the same data.
+const FontData = struct {
+  bytes: []const u8,
+  /// whether bytes is a memory mapping rather than allocated.
+  mapped: bool,
+
+  fn load(allocator: std.mem.Allocator, path: [:0]const u8) !FontData {
+    const file = try std.fs.cwd().openFileZ(path, .{});
+    defer file.close();
+    const size = try file.getEndPos();
+    // empty files cannot be mapped. FreeType will reject them.
+    if (builtin.os.tag != .windows and size > 0) {
+      const bytes = try std.os.mmap(null, size, std.os.PROT.READ, std.os.MAP.PRIVATE, file.handle, 0);
+      return FontData{.bytes = bytes, .mapped = true};
+    }
+    return FontData{.bytes = try file.readToEndAlloc(allocator, std.math.maxInt(usize)), .mapped = false};
+  }
+
+  fn free(d: FontData, allocator: std.mem.Allocator) void {
+    if (d.mapped) {
+      std.os.munmap(@alignCast(std.mem.page_size, d.bytes));
+    } else allocator.free(d.bytes);
+  }
+};
+
+/// Font is a font face loaded with FreeType.
+/// Fonts are loaded via Engine.loadFont and must be explicitly free'd using
+/// free() before the engine is closed.
+pub const Font = struct {
+  /// Mode defines how the glyphs of a font are rendered.
+  pub const Mode = enum(c_int) {
+    /// glyphs are rasterized for each size they are drawn at. This gives the
+    /// best quality at small sizes.
+    bitmap,
+    /// glyphs are stored once as signed distance fields and scaled to the
+    /// size they are drawn at. This gives crisp edges at any size, at the
+    /// cost of slightly rounded corners, and keeps atlas usage independent
+    /// of the number of sizes used. Best for large or animated text.
+    sdf,
+  };
+
+  /// Metrics are the metrics of a glyph in pixels at the text size they were
+  /// queried for. top is the distance from the baseline upwards.
+  const Metrics = struct {
+    advance: f32,
+    left: f32,
+    top: f32,
+    width: f32,
+    height: f32,
+  };
+
+  const MetricKey = struct {
+    index: u32,
+    size: u16,
+    mode: Mode,
+  };
+
+  /// Extents are the measurements of a line of text.
+  pub const Extents = struct {
+    /// horizontal advance of the whole line.
+    advance: f32,
+    /// bounding box of the drawn glyphs, relative to the start of the baseline.
+    bounds: Rectangle,
+  };
+
+  /// Line is a line of text returned by breakLines.
+  pub const Line = extern struct {
+    /// byte range of the line in the text.
+    start: usize,
+    end: usize,
+    /// horizontal advance of the line.
+    advance: f32,
+
+    fn init(start: usize, start_pen: f32, end: usize, end_pen: f32) Line {
+      return if (end > start) Line{.start = start, .end = end, .advance = end_pen - start_pen}
+          else Line{.start = start, .end = start, .advance = 0};
+    }
+  };
+
+  e: *Engine,
+  face: ft.FT_Face,
+  /// guards face and metric_cache, which are used by drawing as well as by
+  /// measuring, which may happen on other threads.
+  mutex: std.Thread.Mutex,
+  metric_cache: std.AutoHashMapUnmanaged(MetricKey, Metrics),
+  /// content of the font file, also used by glyph workers to open their own
+  /// face.
+  data: FontData,
+  /// unique id of the font within its engine.
+  id: u32,
+  /// pixel size the face is currently set to.
+  size: u16,
+  /// may be changed at any time.
+  mode: Mode,
+
+  pub fn free(f: *Font) void {
+    if (f.e.glyph_workers) |pool| pool.forgetFont(f.id);
+    _ = ft.FT_Done_Face(f.face);
+    f.face = null;
+    f.data.free(f.e.allocator);
+    f.metric_cache.deinit(f.e.allocator);
+  }
+
+  /// loadBakedAtlas loads an atlas baked from the font's file with
+  /// zargo-bake (see BakedAtlas). Its pixels are uploaded as a new page of
+  /// the engine's glyph atlas and its glyphs and metrics are used as if they
+  /// had been rasterized already. Missing glyphs are still rasterized with
+  /// FreeType. Baked glyphs are only used in bitmap mode and are evicted like
+  /// any other glyph when they are not used anymore.
+  pub fn loadBakedAtlas(f: *Font, path: []const u8) !void {
+    const e = f.e;
+    if (builtin.cpu.arch.endian() != .Little) return BakedAtlas.Error.UnsupportedByteOrder;
+    const file = try std.fs.cwd().openFile(path, .{});
+    defer file.close();
+    var buffered = std.io.bufferedReader(file.reader());
+    const reader = buffered.reader();
+
+    const header = try reader.readStruct(BakedAtlas.Header);
+    if (!std.mem.eql(u8, &header.magic, &BakedAtlas.magic)) return BakedAtlas.Error.InvalidFile;
+    if (header.font_hash != BakedAtlas.fontHash(f.data.bytes)) return BakedAtlas.Error.WrongFont;
+    const page_size = @intCast(u32, std.math.min(glyph_atlas_size, e.max_tex_size));
+    if (header.page_size != page_size) return BakedAtlas.Error.WrongPageSize;
+    const glyphs = try e.allocator.alloc(BakedAtlas.GlyphRecord, header.glyph_count);
+    defer e.allocator.free(glyphs);
+    try reader.readNoEof(std.mem.sliceAsBytes(glyphs));
+    const metrics = try e.allocator.alloc(BakedAtlas.MetricRecord, header.metric_count);
+    defer e.allocator.free(metrics);
+    try reader.readNoEof(std.mem.sliceAsBytes(metrics));
+    const pixels = try e.allocator.alloc(u8, @as(usize, page_size) * page_size);
+    defer e.allocator.free(pixels);
+    try reader.readNoEof(pixels);
+    for (glyphs) |g| {
+      if (g.size == 0 or g.phase >= subpixel_phases or
+          (g.width > 0 and (g.x == 0 or g.y == 0 or
+           @as(u32, g.x) + g.width >= page_size or @as(u32, g.y) + g.height >= page_size))) {
+        return BakedAtlas.Error.InvalidFile;
+      }
+    }
+
+    // reserve everything that can fail before the page is added, so that a
+    // failure leaves the atlas unchanged.
+    f.mutex.lock();
+    defer f.mutex.unlock();
+    const metric_count = std.math.min(metrics.len, max_cached_metrics -| f.metric_cache.count());
+    try f.metric_cache.ensureUnusedCapacity(e.allocator, @intCast(u32, metric_count));
+    const a = &e.glyph_atlas;
+    try a.glyphs.ensureUnusedCapacity(e.allocator, header.glyph_count);
+    if (!a.addPage(e, pixels)) return BakedAtlas.Error.AtlasFull;
+    const page = a.page_count - 1;
+    // the page is packed already. Other glyphs are placed on it only after it
+    // has been repacked.
+    a.pages[page].extent.store(page_size, .Monotonic);
+    for (glyphs) |g| {
+      const key = GlyphAtlas.Key{.font = f.id, .index = g.index, .size = g.size, .phase = @intCast(u8, g.phase)};
+      a.glyphs.putAssumeCapacity(key, .{
+        .page = page, .x = g.x, .y = g.y, .width = g.width, .height = g.height,
+        .left = g.left, .top = g.top, .advance = g.advance, .last_used = a.frame,
+      });
+      if (key.phase != 0) a.track(e.allocator, key);
+    }
+    for (metrics[0..metric_count]) |m| {
+      f.metric_cache.putAssumeCapacity(.{.index = m.index, .size = @intCast(u16, m.size), .mode = .bitmap}, .{
+        .advance = m.advance, .left = m.left, .top = m.top, .width = m.width, .height = m.height,
+      });
+    }
+  }
+
+  /// rasterSize returns the size glyphs are rasterized at for drawing text
+  /// with the given size.
+  fn rasterSize(f: *const Font, text_size: u16) u16 {
+    return if (f.mode == .sdf) sdf_glyph_size * sdf_oversampling else text_size;
+  }
+
+  /// faceScale returns the factor from metrics at rasterSize(text_size) to
+  /// metrics at text_size.
+  fn faceScale(f: *const Font, text_size: u16) f32 {
+    return @intToFloat(f32, text_size) / @intToFloat(f32, f.rasterSize(text_size));
+  }
+
+  /// setSize sets the face to the size glyphs are rasterized at for drawing
+  /// text with the given size.
+  fn setSize(f: *Font, text_size: u16) bool {
+    const size = f.rasterSize(text_size);
+    if (f.size == size) return true;
+    const res = ft.FT_Set_Pixel_Sizes(f.face, 0, size);
+    if (res != 0) {
+      _ = freeTypeError("size selection", res);
+      return false;
+    }
+    f.size = size;
+    return true;
+  }
+
+  fn glyphKey(f: *const Font, index: u32, size: u16, phase: u8) GlyphAtlas.Key {
+    // SDF glyphs are stored with size 0 since they are used for all sizes,
+    // and are positioned freely without subpixel variants.
+    return if (f.mode == .sdf) GlyphAtlas.Key{.font = f.id, .index = index, .size = 0, .phase = 0}
+        else GlyphAtlas.Key{.font = f.id, .index = index, .size = size, .phase = phase};
+  }
+
+  /// glyph returns the glyph with the given index for drawing text with the
+  /// given size at the given subpixel phase, rasterizing it into the engine's
+  /// glyph atlas if it isn't there yet. In SDF mode, the glyph's metrics are
+  /// given at sdf_glyph_size and phase is ignored.
+  /// Returns null if the glyph cannot be rendered.
+  fn glyph(f: *Font, index: u32, size: u16, phase: u8) GlyphError!?Glyph {
+    const e = f.e;
+    const key = f.glyphKey(index, size, phase);
+    if (e.glyph_atlas.get(key)) |value| return value;
+
+    f.mutex.lock();
+    defer f.mutex.unlock();
+    if (!f.setSize(size)) return null;
+    const r = rasterizeGlyph(e.allocator, f.face, index, f.mode == .sdf, key.phase) orelse return null;
+    defer e.allocator.free(r.pixels);
+    return e.glyph_atlas.insert(e, key, r, null);
+  }
+
+  /// metrics returns the metrics of the glyph with the given index for
+  /// drawing text with the given size from the metric cache, loading the glyph
+  /// if it isn't cached yet. The glyph is not rasterized. The font's mutex must
+  /// be held.
+  /// Returns null if the glyph cannot be loaded.
+  fn metrics(f: *Font, index: u32, size: u16) ?Metrics {
+    const key = MetricKey{.index = index, .size = size, .mode = f.mode};
+    if (f.metric_cache.get(key)) |value| return value;
+    if (!f.setSize(size)) return null;
+    const res = ft.FT_Load_Glyph(f.face, index, ft.FT_LOAD_DEFAULT);
+    if (res != 0) {
+      _ = freeTypeError("glyph loading", res);
+      return null;
+    }
+    // FreeType gives metrics in 26.6 fixed point.
+    const ret = slotMetrics(f.face.*.glyph, f.faceScale(size) / 64.0);
+    if (f.metric_cache.count() >= max_cached_metrics) f.metric_cache.clearRetainingCapacity();
+    // if this fails, the glyph will just be loaded again.
+    f.metric_cache.put(f.e.allocator, key, ret) catch {};
+    return ret;
+  }
+
+  /// slotMetrics returns the metrics of the glyph loaded into slot,
+  /// multiplied by scale.
+  fn slotMetrics(slot: ft.FT_GlyphSlot, scale: f32) Metrics {
+    return Metrics{
+      .advance = @intToFloat(f32, slot.*.advance.x) * scale,
+      .left = @intToFloat(f32, slot.*.metrics.horiBearingX) * scale,
+      .top = @intToFloat(f32, slot.*.metrics.horiBearingY) * scale,
+      .width = @intToFloat(f32, slot.*.metrics.width) * scale,
+      .height = @intToFloat(f32, slot.*.metrics.height) * scale,
+    };
+  }
+
+  /// measure returns the extents of the given UTF-8 encoded text drawn in a
+  /// single line with the given size, as drawText would draw it.
+  ///
+  /// measure and breakLines only query FreeType and never use OpenGL, so they
+  /// can be called from any thread, e.g. by a layout pass running in parallel
+  /// with rendering. They are serialized with drawing the font through its
+  /// mutex. The engine's allocator must be thread-safe when doing so.
+  pub fn measure(f: *Font, text: []const u8, size: u16) error{InvalidUtf8}!Extents {
+    const view = try std.unicode.Utf8View.init(text);
+    f.mutex.lock();
+    defer f.mutex.unlock();
+    var shaper = Shaper.init(f, view, size) orelse
+        return Extents{.advance = 0, .bounds = .{.x = 0, .y = 0, .width = 0, .height = 0}};
+    while (shaper.next()) |_| {}
+    return Extents{.advance = shaper.pen, .bounds = shaper.bounds()};
+  }
+
+  /// breakLines breaks the given UTF-8 encoded text into lines no wider than
+  /// max_width when drawn with the given size. Lines are broken at line feeds,
+  /// at spaces and between CJK characters. Words wider than max_width are
+  /// broken between glyphs. Spaces at line breaks belong to no line.
+  ///
+  /// The returned lines refer to text and must be free'd with allocator.
+  pub fn breakLines(f: *Font, allocator: std.mem.Allocator, text: []const u8, size: u16, max_width: f32) ![]Line {
+    const Break = struct {
+      /// end of the line before the break.
+      end: usize,
+      end_pen: f32,
+      /// start of the line after the break.
+      next: usize,
+      next_pen: f32,
+    };
+
+    const view = try std.unicode.Utf8View.init(text);
+    f.mutex.lock();
+    defer f.mutex.unlock();
+    var lines = std.ArrayList(Line).init(allocator);
+    errdefer lines.deinit();
+    var shaper = Shaper.init(f, view, size) orelse return lines.toOwnedSlice();
+
+    // the current line starts at start and ends after its last non-space
+    // glyph, at end.
+    var start: usize = 0;
+    var start_pen: f32 = 0;
+    var end: usize = 0;
+    var end_pen: f32 = 0;
+    // last position the current line can be broken at.
+    var candidate: ?Break = null;
+    var prev_cp: u21 = 0;
+    while (shaper.next()) |g| {
+      defer prev_cp = g.cp;
+      if (g.cp == '\n') {
+        try lines.append(Line.init(start, start_pen, end, end_pen));
+        start = g.offset + g.len;
+        start_pen = g.x + g.advance;
+        end = start;
+        end_pen = start_pen;
+        candidate = null;
+        continue;
+      }
+      if (isBreakingSpace(g.cp)) {
+        if (end > start) {
+          if (!isBreakingSpace(prev_cp)) {
+            candidate = Break{.end = end, .end_pen = end_pen, .next = undefined, .next_pen = undefined};
+          }
+          if (candidate) |*b| {
+            b.next = g.offset + g.len;
+            b.next_pen = g.x + g.advance;
+          }
+        }
+        continue;
+      }
+      if (end > start and !isBreakingSpace(prev_cp) and (isCjk(prev_cp) or isCjk(g.cp)) and !noBreakBefore(g.cp)) {
+        candidate = Break{.end = end, .end_pen = end_pen, .next = g.offset, .next_pen = g.x};
+      }
+      if (end > start and g.x + g.advance - start_pen > max_width) {
+        const b = candidate orelse Break{.end = end, .end_pen = end_pen, .next = g.offset, .next_pen = g.x};
+        try lines.append(Line.init(start, start_pen, b.end, b.end_pen));
+        start = b.next;
+        start_pen = b.next_pen;
+        candidate = null;
+      }
+      end = g.offset + g.len;
+      end_pen = g.x + g.advance;
+    }
+    try lines.append(Line.init(start, start_pen, end, end_pen));
+    return lines.toOwnedSlice();
+  }
+};
+
+/// maximum number of glyph metrics a font caches before the cache is cleared.
+const max_cached_metrics = 16384;
+
+/// isBreakingSpace returns whether a line may be broken at the given space.
+fn isBreakingSpace(cp: u21) bool {
+  return cp == ' ' or cp == '\t' or cp == 0x3000;
+}
+
+/// isCjk returns whether the given codepoint is a CJK character. Lines may be
+/// broken between those.
+fn isCjk(cp: u21) bool {
+  return (cp >= 0x2E80 and cp <= 0x9FFF) or (cp >= 0xAC00 and cp <= 0xD7AF) or
+      (cp >= 0xF900 and cp <= 0xFAFF) or (cp >= 0xFF00 and cp <= 0xFFEF) or
+      (cp >= 0x20000 and cp <= 0x2FFFF);
+}
+
+/// noBreakBefore returns whether the given codepoint is closing CJK
+/// punctuation, which must not start a line.
+fn noBreakBefore(cp: u21) bool {
+  return switch (cp) {
+    0x3001, 0x3002, 0x3009, 0x300B, 0x300D, 0x300F, 0x3011, 0x30FC,
+    0xFF01, 0xFF09, 0xFF0C, 0xFF0E, 0xFF1A, 0xFF1B, 0xFF1F => true,
+    else => false,
+  };
+}
+
+/// Shaper walks through a text, placing its glyphs with kerning and keeping
+/// track of their bounds. The font's mutex must be held while it is used.
+const Shaper = struct {
+  const Step = struct {
+    index: u32,
+    /// pen position of the glyph.
+    x: f32,
+    advance: f32,
+    /// codepoint of the glyph and its byte position in the text.
+    cp: u21,
+    offset: usize,
+    len: usize,
+  };
+
+  font: *Font,
+  size: u16,
+  iter: std.unicode.Utf8Iterator,
+  has_kerning: bool,
+  /// kerning is given at the face's current size.
+  kerning_scale: f32,
+  prev: u32,
+  pen: f32,
+  min: [2]f32,
+  max: [2]f32,
+
+  /// init returns null if the font cannot be set to the given size.
+  fn init(font: *Font, view: std.unicode.Utf8View, size: u16) ?Shaper {
+    if (!font.setSize(size)) return null;
+    return Shaper{
+      .font = font,
+      .size = size,
+      .iter = view.iterator(),
+      .has_kerning = (font.face.*.face_flags & ft.FT_FACE_FLAG_KERNING) != 0,
+      .kerning_scale = font.faceScale(size),
+      .prev = 0,
+      .pen = 0,
+      .min = [2]f32{std.math.inf(f32), std.math.inf(f32)},
+      .max = [2]f32{-std.math.inf(f32), -std.math.inf(f32)},
+    };
+  }
+
+  /// next returns the next glyph, or null at the end of the text. Glyphs that
+  /// cannot be loaded are skipped.
+  fn next(s: *Shaper) ?Step {
+    while (true) {
+      const offset = s.iter.i;
+      const bytes = s.iter.nextCodepointSlice() orelse return null;
+      // the text has been validated by Utf8View.
+      const cp = std.unicode.utf8Decode(bytes) catch unreachable;
+      const index = ft.FT_Get_Char_Index(s.font.face, cp);
+      if (s.has_kerning and s.prev != 0 and index != 0) {
+        var delta: ft.FT_Vector = undefined;
+        if (ft.FT_Get_Kerning(s.font.face, s.prev, index, @intCast(c_uint, ft.FT_KERNING_DEFAULT), &delta) == 0) {
+          s.pen += @intToFloat(f32, delta.x) / 64.0 * s.kerning_scale;
+        }
+      }
+      s.prev = index;
+      const m = s.font.metrics(index, s.size) orelse continue;
+      if (m.width > 0 and m.height > 0) {
+        s.min[0] = std.math.min(s.min[0], s.pen + m.left);
+        s.min[1] = std.math.min(s.min[1], m.top - m.height);
+        s.max[0] = std.math.max(s.max[0], s.pen + m.left + m.width);
+        s.max[1] = std.math.max(s.max[1], m.top);
+      }
+      const ret = Step{
+        .index = index, .x = s.pen, .advance = m.advance,
+        .cp = cp, .offset = offset, .len = bytes.len,
+      };
+      s.pen += m.advance;
+      return ret;
+    }
+  }
+
+  /// bounds returns the bounding box of the glyphs walked through so far,
+  /// relative to the start of the baseline.
+  fn bounds(s: *const Shaper) Rectangle {
+    var ret = Rectangle{.x = 0, .y = 0, .width = 0, .height = 0};
+    if (s.min[0] < s.max[0] and s.min[1] < s.max[1]) {
+      ret.x = @floatToInt(i32, @floor(s.min[0]));
+      ret.y = @floatToInt(i32, @floor(s.min[1]));
+      ret.width = @floatToInt(u31, @ceil(s.max[0]) - @floor(s.min[0]));
+      ret.height = @floatToInt(u31, @ceil(s.max[1]) - @floor(s.min[1]));
+    }
+    return ret;
+  }
+};
+
+/// a text needs at least this many glyphs missing from the atlas to be
+/// rasterized by glyph workers. Fewer glyphs are cheaper to rasterize in place.
+const min_parallel_glyphs = 4;
+
+/// GlyphRequest is a glyph to be rasterized by a glyph worker.
+const GlyphRequest = struct {
+  key: GlyphAtlas.Key,
+  data: []const u8,
+  /// pixel size to rasterize at.
+  size: u16,
+  sdf: bool,
+  /// null if the glyph could not be rasterized.
+  result: ?RasterizedGlyph,
+  /// space reserved in the atlas, null if the atlas is full or the glyph is
+  /// empty.
+  pos: ?GlyphAtlas.Position,
+};
+
+/// GlyphWorker is a thread rasterizing glyphs for GlyphWorkers. FreeType
+/// libraries are not thread-safe, so each worker has its own library and opens
+/// its own face of each font it rasterizes glyphs of.
+const GlyphWorker = struct {
+  const Face = struct {
+    face: ft.FT_Face,
+    /// pixel size the face is currently set to.
+    size: u16,
+  };
+
+  pool: *GlyphWorkers,
+  thread: std.Thread,
+  heap: FreeTypeHeap,
+  library: ft.FT_Library,
+  faces: std.AutoHashMapUnmanaged(u32, Face),
+
+  fn run(w: *GlyphWorker) void {
+    const pool = w.pool;
+    while (true) {
+      const epoch = pool.epoch.load(.Acquire);
+      while (pool.claim()) |index| {
+        // the render thread may start a new batch as soon as done is complete.
+        const count = pool.requests.items.len;
+        w.process(&pool.requests.items[index]);
+        if (pool.done.fetchAdd(1, .AcqRel) + 1 == count) Futex.wake(&pool.done, 1);
+      }
+      if (pool.stopping.load(.Acquire)) break;
+      Futex.wait(&pool.epoch, epoch, null) catch unreachable;
+    }
+  }
+
+  fn process(w: *GlyphWorker, req: *GlyphRequest) void {
+    const face = w.openFace(req) orelse return;
+    const r = rasterizeGlyph(w.pool.allocator, face, req.key.index, req.sdf, req.key.phase) orelse return;
+    if (r.glyph.width > 0) req.pos = w.pool.atlas.reserve(r.glyph.width + 2, r.glyph.height + 2);
+    req.result = r;
+  }
+
+  /// openFace returns this worker's face of the requested font, set to the
+  /// requested size.
+  fn openFace(w: *GlyphWorker, req: *const GlyphRequest) ?ft.FT_Face {
+    const entry = w.faces.getOrPut(w.pool.allocator, req.key.font) catch return null;
+    if (!entry.found_existing) {
+      var face: ft.FT_Face = undefined;
+      const res = ft.FT_New_Memory_Face(w.library, req.data.ptr, @intCast(ft.FT_Long, req.data.len), 0, &face);
+      if (res != 0) {
+        _ = w.faces.remove(req.key.font);
+        _ = freeTypeError("font loading", res);
+        return null;
+      }
+      entry.value_ptr.* = .{.face = face, .size = 0};
+    }
+    const value = entry.value_ptr;
+    if (value.size != req.size) {
+      const res = ft.FT_Set_Pixel_Sizes(value.face, 0, req.size);
+      if (res != 0) {
+        _ = freeTypeError("size selection", res);
+        return null;
+      }
+      value.size = req.size;
+    }
+    return value.face;
+  }
+
+  fn teardown(w: *GlyphWorker) void {
+    var iter = w.faces.valueIterator();
+    while (iter.next()) |value| _ = ft.FT_Done_Face(value.face);
+    w.faces.deinit(w.pool.allocator);
+    _ = ft.FT_Done_Library(w.library);
+    w.heap.deinit();
+  }
+};
+
+/// GlyphWorkers rasterize the glyphs of a text that are missing from the atlas
+/// in parallel when the text is drawn. Workers reserve atlas space for the
+/// glyphs themselves, the render thread then only uploads the staged bitmaps.
+/// Started via Engine.startGlyphWorkers.
+const GlyphWorkers = struct {
+  allocator: std.mem.Allocator,
+  workers: []GlyphWorker,
+  /// requests of the current batch, only modified by the render thread while
+  /// no batch is running.
+  requests: std.ArrayListUnmanaged(GlyphRequest),
+  atlas: *GlyphAtlas,
+  /// number of requests of the current batch in the upper 32 bits, index of
+  /// the next request to be claimed in the lower 32 bits.
+  cursor: Atomic(u64),
+  /// number of processed requests of the current batch.
+  done: Atomic(u32),
+  /// incremented whenever a batch is started, workers sleep on it.
+  epoch: Atomic(u32),
+  stopping: Atomic(bool),
+
+  /// init starts num_workers threads. allocator is used from the worker
+  /// threads and must be thread-safe. pool must not be moved after init.
+  fn init(pool: *GlyphWorkers, allocator: std.mem.Allocator, num_workers: usize) !void {
+    pool.* = .{
+      .allocator = allocator,
+      .workers = try allocator.alloc(GlyphWorker, num_workers),
+      .requests = .{},
+      .atlas = undefined,
+      .cursor = Atomic(u64).init(0),
+      .done = Atomic(u32).init(0),
+      .epoch = Atomic(u32).init(0),
+      .stopping = Atomic(bool).init(false),
+    };
+    errdefer allocator.free(pool.workers);
+
+    var started: usize = 0;
+    errdefer pool.stop(started);
+    for (pool.workers) |*w| {
+      w.* = .{.pool = pool, .thread = undefined, .heap = undefined, .library = null, .faces = .{}};
+      w.heap.init(allocator);
+      const res = ft.FT_New_Library(&w.heap.memory, &w.library);
+      if (res != 0) {
+        w.heap.deinit();
+        return freeTypeError("initialization", res);
+      }
+      ft.FT_Add_Default_Modules(w.library);
+      w.thread = std.Thread.spawn(.{}, GlyphWorker.run, .{w}) catch |err| {
+        _ = ft.FT_Done_Library(w.library);
+        w.heap.deinit();
+        return err;
+      };
+      started += 1;
+    }
+  }
+
+  fn stop(pool: *GlyphWorkers, num_started: usize) void {
+    pool.stopping.store(true, .Release);
+    _ = pool.epoch.fetchAdd(1, .Release);
+    Futex.wake(&pool.epoch, std.math.maxInt(u32));
+    for (pool.workers[0..num_started]) |*w| {
+      w.thread.join();
+      w.teardown();
+    }
+  }
+
+  fn deinit(pool: *GlyphWorkers) void {
+    pool.stop(pool.workers.len);
+    pool.requests.deinit(pool.allocator);
+    pool.allocator.free(pool.workers);
+  }
+
+  /// claim returns the index of the next unclaimed request of the current
+  /// batch, or null if all have been claimed.
+  fn claim(pool: *GlyphWorkers) ?u32 {
+    var cursor = pool.cursor.load(.Acquire);
+    while (@truncate(u32, cursor) < @truncate(u32, cursor >> 32)) {
+      cursor = pool.cursor.tryCompareAndSwap(cursor, cursor + 1, .Acquire, .Acquire) orelse
+          return @truncate(u32, cursor);
+    }
+    return null;
+  }
+
+  /// forgetFont closes the workers' faces of the font with the given id.
+  /// Must not be called while a batch is running.
+  fn forgetFont(pool: *GlyphWorkers, id: u32) void {
+    for (pool.workers) |*w| {
+      if (w.faces.fetchRemove(id)) |kv| _ = ft.FT_Done_Face(kv.value.face);
+    }
+  }
+
+  /// rasterize rasterizes the glyphs of the given layout, drawn at x, which
+  /// are missing from the engine's glyph atlas on the workers and uploads
+  /// them. Glyphs that don't fit into the atlas anymore are left to drawText.
+  fn rasterize(pool: *GlyphWorkers, e: *Engine, font: *const Font, layout: *const TextLayout, x: f32, size: u16) void {
+    pool.requests.clearRetainingCapacity();
+    outer: for (layout.glyphs) |item| {
+      const key = font.glyphKey(item.index, size, subpixelPosition(x + item.x).phase);
+      if (e.glyph_atlas.glyphs.contains(key)) continue;
+      for (pool.requests.items) |req| {
+        if (req.key.index == key.index and req.key.phase == key.phase) continue :outer;
+      }
+      pool.requests.append(pool.allocator, .{
+        .key = key, .data = font.data.bytes, .size = font.rasterSize(size),
+        .sdf = font.mode == .sdf, .result = null, .pos = null,
+      }) catch return;
+    }
+    const count = @intCast(u32, pool.requests.items.len);
+    if (count < min_parallel_glyphs) return;
+
+    pool.atlas = &e.glyph_atlas;
+    pool.done.store(0, .Monotonic);
+    pool.cursor.store(@as(u64, count) << 32, .Release);
+    _ = pool.epoch.fetchAdd(1, .Release);
+    Futex.wake(&pool.epoch, std.math.maxInt(u32));
+    while (true) {
+      const done = pool.done.load(.Acquire);
+      if (done == count) break;
+      Futex.wait(&pool.done, done, null) catch unreachable;
+    }
+
+    for (pool.requests.items) |req| {
+      const r = req.result orelse continue;
+      defer pool.allocator.free(r.pixels);
+      if (r.glyph.width > 0 and req.pos == null) continue;
+      // can't fail with AtlasFull since space has already been reserved.
+      _ = e.glyph_atlas.insert(e, req.key, r, req.pos) catch unreachable;
+    }
+  }
+};
+
+/// TextLayout is a line of text shaped with a font at a given size: the glyphs
+/// to draw and their pen positions, with kerning applied.
+pub const TextLayout = struct {
+  pub const Item = struct {
+    /// glyph index in the font.
+    index: u32,
+    /// pen position relative to the start of the line.
+    x: f32,
+  };
+
+  glyphs: []Item,
+  /// horizontal advance of the whole line.
+  advance: f32,
+  /// bounding box of the drawn glyphs, relative to the start of the baseline.
+  bounds: Rectangle,
+};
+
+/// maximum number of text layouts the engine caches.
+const max_cached_layouts = 1024;
+
+const LayoutKey = struct {
+  font: u32,
+  size: u16,
+  mode: Font.Mode,
+  text: []const u8,
+
+  const Context = struct {
+    pub fn hash(_: Context, k: LayoutKey) u64 {
+      var h = std.hash.Wyhash.init(0);
+      h.update(std.mem.asBytes(&k.font));
+      h.update(std.mem.asBytes(&k.size));
+      h.update(std.mem.asBytes(&k.mode));
+      h.update(k.text);
+      return h.final();
+    }
+
+    pub fn eql(_: Context, a: LayoutKey, b: LayoutKey) bool {
+      return a.font == b.font and a.size == b.size and a.mode == b.mode and
+          std.mem.eql(u8, a.text, b.text);
+    }
+  };
+};
+
+/// LayoutCache keeps the most recently used text layouts, so that drawing the
+/// same text again doesn't need any FreeType calls.
+const LayoutCache = struct {
+  const Entry = struct {
+    key: LayoutKey,
+    layout: TextLayout,
+  };
+  const List = std.TailQueue(Entry);
+
+  map: std.HashMapUnmanaged(LayoutKey, *List.Node, LayoutKey.Context, std.hash_map.default_max_load_percentage),
+  /// ordered from least to most recently used.
+  lru: List,
+
+  fn init() LayoutCache {
+    return .{.map = .{}, .lru = .{}};
+  }
+
+  fn get(cache: *LayoutCache, key: LayoutKey) ?*const TextLayout {
+    const node = cache.map.get(key) orelse return null;
+    cache.lru.remove(node);
+    cache.lru.append(node);
+    return &node.data.layout;
+  }
+
+  /// put adds the given layout, taking ownership of its glyphs. The least
+  /// recently used layout is dropped if the cache is full.
+  fn put(cache: *LayoutCache, allocator: std.mem.Allocator, key: LayoutKey, layout: TextLayout) !*const TextLayout {
+    const node = try allocator.create(List.Node);
+    errdefer allocator.destroy(node);
+    const text = try allocator.dupe(u8, key.text);
+    errdefer allocator.free(text);
+    node.data = .{.key = key, .layout = layout};
+    node.data.key.text = text;
+    try cache.map.put(allocator, node.data.key, node);
+    cache.lru.append(node);
+    if (cache.lru.len > max_cached_layouts) {
+      const oldest = cache.lru.popFirst().?;
+      _ = cache.map.remove(oldest.data.key);
+      freeNode(allocator, oldest);
+    }
+    return &node.data.layout;
+  }
+
+  fn freeNode(allocator: std.mem.Allocator, node: *List.Node) void {
+    allocator.free(node.data.key.text);
+    allocator.free(node.data.layout.glyphs);
+    allocator.destroy(node);
+  }
+
+  fn deinit(cache: *LayoutCache, allocator: std.mem.Allocator) void {
+    while (cache.lru.popFirst()) |node| freeNode(allocator, node);
+    cache.map.deinit(allocator);
+  }
+};
+
+/// BakedAtlas describes pre-baked glyph atlas files. Such a file holds the
+/// bitmap glyphs of one font for a set of sizes and characters, at every
+/// subpixel position, packed into a single atlas page, along with the glyph
+/// metrics. Files are produced offline with the zargo-bake tool and loaded
+/// with Font.loadBakedAtlas, so that the glyphs a UI needs on startup don't
+/// have to be rasterized.
+///
+/// A file consists of a Header, header.glyph_count GlyphRecords,
+/// header.metric_count MetricRecords and page_size * page_size bytes of
+/// pixels, rows ordered top-down. Values are stored little-endian.
+pub const BakedAtlas = struct {
+  pub const magic = [4]u8{'Z', 'G', 'A', '1'};
+  /// page size used by the glyph atlas unless max_tex_size is smaller.
+  pub const default_page_size = glyph_atlas_size;
+
+  pub const Error = error {
+    InvalidFile,
+    /// the file has been baked from a different font file.
+    WrongFont,
+    /// the file's page size differs from the glyph atlas' page size.
+    WrongPageSize,
+    /// the glyphs don't fit into a page, or the atlas has no free page.
+    AtlasFull,
+    UnsupportedByteOrder,
+  };
+
+  pub const Header = extern struct {
+    magic: [4]u8,
+    page_size: u32,
+    /// fontHash of the font file the atlas has been baked from.
+    font_hash: u64,
+    glyph_count: u32,
+    metric_count: u32,
+  };
+
+  pub const GlyphRecord = extern struct {
+    index: u32,
+    size: u16,
+    phase: u16,
+    x: u16,
+    y: u16,
+    width: u16,
+    height: u16,
+    left: i16,
+    top: i16,
+    advance: f32,
+  };
+
+  pub const MetricRecord = extern struct {
+    index: u32,
+    size: u32,
+    advance: f32,
+    left: f32,
+    top: f32,
+    width: f32,
+    height: f32,
+  };
+
+  /// Range is an inclusive range of Unicode code points.
+  pub const Range = struct {
+    first: u21,
+    last: u21,
+  };
+
+  const Baked = struct {
+    record: GlyphRecord,
+    pixels: []u8,
+
+    fn tallerFirst(context: void, lhs: Baked, rhs: Baked) bool {
+      _ = context;
+      return lhs.record.height > rhs.record.height;
+    }
+  };
+
+  pub fn fontHash(data: []const u8) u64 {
+    return std.hash.Wyhash.hash(0, data);
+  }
+
+  /// bake rasterizes the glyphs of the given code point ranges in the given
+  /// sizes from the font at path and writes the resulting atlas to writer.
+  /// Code points the font doesn't have are skipped.
+  /// Fails with Error.AtlasFull if the glyphs don't fit into one page.
+  pub fn bake(allocator: std.mem.Allocator, path: [:0]const u8, sizes: []const u16,
+              ranges: []const Range, page_size: u16, writer: anytype) !void {
+    if (builtin.cpu.arch.endian() != .Little) return Error.UnsupportedByteOrder;
+    const data = try FontData.load(allocator, path);
+    defer data.free(allocator);
+    var lib: ft.FT_Library = undefined;
+    var res = ft.FT_Init_FreeType(&lib);
+    if (res != 0) return freeTypeError("initialization", res);
+    defer _ = ft.FT_Done_FreeType(lib);
+    var face: ft.FT_Face = undefined;
+    res = ft.FT_New_Memory_Face(lib, data.bytes.ptr, @intCast(ft.FT_Long, data.bytes.len), 0, &face);
+    if (res != 0) return freeTypeError("font loading", res);
+    defer _ = ft.FT_Done_Face(face);
+
+    var glyphs = std.ArrayList(Baked).init(allocator);
+    defer {
+      for (glyphs.items) |g| allocator.free(g.pixels);
+      glyphs.deinit();
+    }
+    var metrics = std.ArrayList(MetricRecord).init(allocator);
+    defer metrics.deinit();
+    // several code points may map to the same glyph.
+    var seen = std.AutoHashMap(u32, void).init(allocator);
+    defer seen.deinit();
+    for (sizes) |size| {
+      res = ft.FT_Set_Pixel_Sizes(face, 0, size);
+      if (res != 0) return freeTypeError("size selection", res);
+      seen.clearRetainingCapacity();
+      for (ranges) |range| {
+        var cp: u32 = range.first;
+        while (cp <= range.last) : (cp += 1) {
+          const index = ft.FT_Get_Char_Index(face, cp);
+          if (index == 0 or (try seen.getOrPut(index)).found_existing) continue;
+          var phase: u8 = 0;
+          while (phase < subpixel_phases) : (phase += 1) {
+            const r = rasterizeGlyph(allocator, face, index, false, phase) orelse return EngineError.FreeTypeError;
+            if (phase == 0) {
+              const m = Font.slotMetrics(face.*.glyph, 1.0 / 64.0);
+              metrics.append(.{
+                .index = index, .size = size, .advance = m.advance, .left = m.left,
+                .top = m.top, .width = m.width, .height = m.height,
+              }) catch |err| {
+                allocator.free(r.pixels);
+                return err;
+              };
+            }
+            const g = r.glyph;
+            glyphs.append(.{.record = .{
+              .index = index, .size = size, .phase = phase, .x = 0, .y = 0,
+              .width = g.width, .height = g.height, .left = g.left, .top = g.top,
+              .advance = g.advance,
+            }, .pixels = r.pixels}) catch |err| {
+              allocator.free(r.pixels);
+              return err;
+            };
+          }
+        }
+      }
+    }
+
+    // pack into shelves, tallest glyphs first so that each shelf is as high
+    // as its first glyph. Glyphs are padded like in the glyph atlas.
+    std.sort.sort(Baked, glyphs.items, {}, Baked.tallerFirst);
+    const pixels = try allocator.alloc(u8, @as(usize, page_size) * page_size);
+    defer allocator.free(pixels);
+    std.mem.set(u8, pixels, 0);
+    var x: usize = 0;
+    var y: usize = 0;
+    var shelf_height: usize = 0;
+    for (glyphs.items) |*g| {
+      const width = @as(usize, g.record.width);
+      const height = @as(usize, g.record.height);
+      if (width == 0) continue;
+      if (x + width + 2 > page_size) {
+        y += shelf_height;
+        x = 0;
+        shelf_height = 0;
+      }
+      if (x + width + 2 > page_size or y + height + 2 > page_size) return Error.AtlasFull;
+      if (shelf_height == 0) shelf_height = height + 2;
+      g.record.x = @intCast(u16, x + 1);
+      g.record.y = @intCast(u16, y + 1);
+      var row: usize = 0;
+      while (row < height) : (row += 1) {
+        std.mem.copy(u8, pixels[(y + 1 + row) * page_size + x + 1..][0..width], g.pixels[row * width..][0..width]);
+      }
+      x += width + 2;
+    }
+
+    try writer.writeStruct(Header{
+      .magic = magic, .page_size = page_size, .font_hash = fontHash(data.bytes),
+      .glyph_count = @intCast(u32, glyphs.items.len), .metric_count = @intCast(u32, metrics.items.len),
+    });
+    for (glyphs.items) |g| try writer.writeStruct(g.record);
+    try writer.writeAll(std.mem.sliceAsBytes(metrics.items));
+    try writer.writeAll(pixels);
+  }
+};
+
+//////////////////////////////////////////////////////////////////////////////
+// Shapes
+
+/// Polygon is a polygon to be filled by Engine.fillPolygons.
+pub const Polygon = extern struct {
+  /// corners in the current coordinate system, in either winding order.
+  points: [*]const [2]f32,
+  count: usize,
+  color: [4]u8,
+
+  fn slice(p: Polygon) []const [2]f32 {
+    return p.points[0..p.count];
+  }
+};
+
+/// Triangulation is a cached triangulation of a polygon.
+const Triangulation = struct {
+  /// corners of the polygon, to tell apart polygons with the same hash.
+  points: [][2]f32,
+  /// indices of the corners forming the triangles. Empty for polygons that
+  /// could not be triangulated.
+  indices: []const u32,
+};
+
+/// maximum number of triangulations kept by the engine.
+const max_cached_triangulations = 1024;
+
+fn cross(o: [2]f32, a: [2]f32, b: [2]f32) f32 {
+  return (a[0] - o[0]) * (b[1] - o[1]) - (a[1] - o[1]) * (b[0] - o[0]);
+}
+
+/// isEar checks whether the corner cur of the polygon formed by the remaining
+/// points can be cut off as a triangle. orientation is 1 if the polygon's
+/// corners are ordered counter-clockwise, -1 otherwise.
+fn isEar(points: []const [2]f32, remaining: []const u32, prev: u32, cur: u32, next: u32, orientation: f32) bool {
+  const a = points[prev];
+  const b = points[cur];
+  const c2 = points[next];
+  if (cross(a, b, c2) * orientation <= 0) return false;
+  for (remaining) |i| {
+    if (i == prev or i == cur or i == next) continue;
+    const p = points[i];
+    if (cross(a, b, p) * orientation >= 0 and cross(b, c2, p) * orientation >= 0 and
+        cross(c2, a, p) * orientation >= 0) return false;
+  }
+  return true;
+}
+
+/// onSegment returns whether p, which is in line with a and b, lies between
+/// them.
+fn onSegment(a: [2]f32, b: [2]f32, p: [2]f32) bool {
+  return p[0] >= std.math.min(a[0], b[0]) and p[0] <= std.math.max(a[0], b[0]) and
+      p[1] >= std.math.min(a[1], b[1]) and p[1] <= std.math.max(a[1], b[1]);
+}
+
+/// segmentsIntersect returns whether the segments from a to b and from c to
+/// d have a point in common.
+fn segmentsIntersect(a: [2]f32, b: [2]f32, c2: [2]f32, d: [2]f32) bool {
+  const d1 = cross(c2, d, a);
+  const d2 = cross(c2, d, b);
+  const d3 = cross(a, b, c2);
+  const d4 = cross(a, b, d);
+  if (((d1 > 0 and d2 < 0) or (d1 < 0 and d2 > 0)) and
+      ((d3 > 0 and d4 < 0) or (d3 < 0 and d4 > 0))) return true;
+  return (d1 == 0 and onSegment(c2, d, a)) or (d2 == 0 and onSegment(c2, d, b)) or
+      (d3 == 0 and onSegment(a, b, c2)) or (d4 == 0 and onSegment(a, b, d));
+}
+
+/// isSimple returns whether no two edges of the polygon with the given
+/// corners meet, other than neighboring edges at their common corner.
+/// Ear clipping cannot tell: a pentagram has ears, but cutting them off does
+/// not give the area it winds around.
+fn isSimple(points: []const [2]f32) bool {
+  const n = points.len;
+  var i: usize = 0;
+  while (i < n) : (i += 1) {
+    // edges i and i + 1 share a corner, as do the first and last edge.
+    var j = i + 2;
+    while (j < n) : (j += 1) {
+      if (i == 0 and j == n - 1) continue;
+      if (segmentsIntersect(points[i], points[i + 1], points[j], points[(j + 1) % n])) return false;
+    }
+  }
+  return true;
+}
+
+/// triangulate returns indices into points forming triangles that cover the
+/// polygon with the given corners, using ear clipping. This is exact for
+/// simple polygons. Returns EngineError.NonSimplePolygon for polygons whose
+/// edges intersect or touch, or if no ear is left; those are filled with
+/// stencil-then-cover instead. Checking for intersections takes quadratic
+/// time in the number of corners, which is why triangulations are cached.
+/// The returned slice must be free'd with allocator.
+fn triangulate(allocator: std.mem.Allocator, points: []const [2]f32) ![]u32 {
+  if (points.len < 3) return allocator.alloc(u32, 0);
+  if (!isSimple(points)) return EngineError.NonSimplePolygon;
+  var ret = try std.ArrayListUnmanaged(u32).initCapacity(allocator, (points.len - 2) * 3);
+  errdefer ret.deinit(allocator);
+  const remaining = try allocator.alloc(u32, points.len);
+  defer allocator.free(remaining);
+  for (remaining) |*v, i| v.* = @intCast(u32, i);
+
+  var area: f32 = 0;
+  for (points) |p, i| {
+    const q = points[(i + 1) % points.len];
+    area += p[0] * q[1] - q[0] * p[1];
+  }
+  const orientation: f32 = if (area < 0) -1 else 1;
+
+  var count = points.len;
+  var i: usize = 0;
+  var misses: usize = 0;
+  while (count > 3) {
+    const prev = remaining[(i + count - 1) % count];
+    const cur = remaining[i];
+    const next = remaining[(i + 1) % count];
+    // a corner in line with its neighbors cuts off no area and is dropped.
+    const degenerate = cross(points[prev], points[cur], points[next]) == 0;
+    if (degenerate or isEar(points, remaining[0..count], prev, cur, next, orientation)) {
+      if (!degenerate) ret.appendSliceAssumeCapacity(&[_]u32{prev, cur, next});
+      std.mem.copy(u32, remaining[i..count - 1], remaining[i + 1..count]);
+      count -= 1;
+      if (i == count) i = 0;
+      misses = 0;
+    } else {
+      i = (i + 1) % count;
+      misses += 1;
+      if (misses == count) return EngineError.NonSimplePolygon;
+    }
+  }
+  ret.appendSliceAssumeCapacity(remaining[0..3]);
+  return ret.toOwnedSlice(allocator);
+}
+
+/// Polyline is a sequence of connected line segments whose vertex data is
+/// kept in a GPU buffer, so that it can be drawn repeatedly without uploading
+/// it again. Polylines are created with Engine.createPolyline.
+pub const Polyline = struct {
+  buffer: gl.Buffer,
+  segments: usize,
+  /// whether the buffer holds points for instanced drawing rather than
+  /// segments expanded into triangles.
+  instanced: bool,
+
+  pub fn free(l: *Polyline) void {
+    gl.deleteBuffer(l.buffer);
+    l.segments = 0;
+  }
+};
+
+const LineProc = struct {
+  p: gl.Program,
+  transform: u32,
+  half_width: u32,
+  scale: u32,
+  color: u32,
+  corner: u32,
+  /// attributes taking the points of a segment and its neighbors, in order
+  /// prev, p0, p1, next.
+  points: [4]u32,
+
+  fn init(vs_src: []const u8, fs_src: []const u8) !LineProc {
+    const p = try linkProgram(vs_src, fs_src);
+    errdefer gl.deleteProgram(p);
+    return LineProc{
+      .p = p,
+      .transform = try getUniformLocation(p, "u_transform"),
+      .half_width = try getUniformLocation(p, "u_halfWidth"),
+      .scale = try getUniformLocation(p, "u_scale"),
+      .color = try getUniformLocation(p, "u_color"),
+      .corner = try getAttribLocation(p, "a_corner"),
+      .points = .{
+        try getAttribLocation(p, "a_prev"), try getAttribLocation(p, "a_p0"),
+        try getAttribLocation(p, "a_p1"), try getAttribLocation(p, "a_next"),
+      },
+    };
+  }
+};
+
+/// corners of the two triangles a line segment or shape is expanded to, see
+/// the line and sdfShape vertex shaders.
+const line_corners = [_][2]f32{.{0, -1}, .{1, -1}, .{1, 1}, .{0, -1}, .{1, 1}, .{0, 1}};
+
+/// Shape is a rounded rectangle drawn by Engine.drawShapes. Circles are
+/// rounded squares with a radius of half their size.
+pub const Shape = extern struct {
+  /// bounding box in the current coordinate system.
+  x: f32,
+  y: f32,
+  width: f32,
+  height: f32,
+  /// corner radius, limited to half the width and height.
+  radius: f32,
+  /// width of the border drawn inside the outline, or 0 to fill the shape.
+  border: f32,
+  color: [4]u8,
+
+  pub fn circle(center: [2]f32, radius: f32, border: f32, color: [4]u8) Shape {
+    return .{
+      .x = center[0] - radius, .y = center[1] - radius, .width = 2 * radius,
+      .height = 2 * radius, .radius = radius, .border = border, .color = color,
+    };
+  }
+
+  pub fn roundedRect(r: Rectangle, radius: f32, border: f32, color: [4]u8) Shape {
+    return .{
+      .x = @intToFloat(f32, r.x), .y = @intToFloat(f32, r.y),
+      .width = @intToFloat(f32, r.width), .height = @intToFloat(f32, r.height),
+      .radius = radius, .border = border, .color = color,
+    };
+  }
+
+  /// vertexData returns the attributes of the shape in the order of
+  /// ShapeProc.attributes: center and half size, radius and border, color.
+  fn vertexData(s: Shape) [shape_floats]f32 {
+    return .{
+      s.x + s.width / 2, s.y + s.height / 2, s.width / 2, s.height / 2, s.radius, s.border,
+      @intToFloat(f32, s.color[0]) / 255.0, @intToFloat(f32, s.color[1]) / 255.0,
+      @intToFloat(f32, s.color[2]) / 255.0, @intToFloat(f32, s.color[3]) / 255.0,
+    };
+  }
+};
+
+/// number of floats in the vertex data of a Shape.
+const shape_floats = 10;
+
+const ShapeProc = struct {
+  p: gl.Program,
+  transform: u32,
+  corner: u32,
+  /// attributes a_rect, a_params and a_color.
+  attributes: [3]u32,
+  const sizes = [_]u8{4, 2, 4};
+  const offsets = [_]usize{0, 4, 6};
+
+  fn init(vs_src: []const u8, fs_src: []const u8) !ShapeProc {
+    const p = try linkProgram(vs_src, fs_src);
+    errdefer gl.deleteProgram(p);
+    return ShapeProc{
+      .p = p,
+      .transform = try getUniformLocation(p, "u_transform"),
+      .corner = try getAttribLocation(p, "a_corner"),
+      .attributes = .{
+        try getAttribLocation(p, "a_rect"), try getAttribLocation(p, "a_params"),
+        try getAttribLocation(p, "a_color"),
+      },
+    };
+  }
+};
+
+/// Path is a vector shape made of contours of straight lines and quadratic
+/// and cubic Bézier curves, in its own coordinate system. Paths are drawn
+/// with Engine.fillPath and Engine.strokePath.
+///
+/// Curves are flattened with a tolerance depending on the scale a path is
+/// drawn with. Flattened paths are kept on the GPU per scale bucket, so that
+/// redrawing a path at a similar scale needs no CPU work. Changing the path
+/// drops them.
+pub const Path = struct {
+  const Command = union(enum) {
+    move: [2]f32,
+    line: [2]f32,
+    quad: [2][2]f32,
+    cubic: [3][2]f32,
+    close,
+  };
+
+  /// Contour is a range of points of a flattened path.
+  const Contour = struct {
+    start: usize,
+    len: usize,
+    closed: bool,
+  };
+
+  /// Flattened holds a path flattened for a scale bucket.
+  const Flattened = struct {
+    /// fan triangles of all contours, followed by a quad covering the
+    /// bounding box. Used for stencil-then-cover filling.
+    fill: gl.Buffer,
+    fill_vertices: usize,
+    /// contours as expanded line segments.
+    stroke: Polyline,
+    points: [][2]f32,
+    contours: []Contour,
+
+    fn deinit(f: *Flattened, allocator: std.mem.Allocator) void {
+      gl.deleteBuffer(f.fill);
+      f.stroke.free();
+      allocator.free(f.points);
+      allocator.free(f.contours);
+    }
+  };
+
+  allocator: std.mem.Allocator,
+  commands: std.ArrayListUnmanaged(Command),
+  /// flattened versions of the path, keyed by scale bucket.
+  flattened: std.AutoHashMapUnmanaged(i8, Flattened),
+
+  pub fn init(allocator: std.mem.Allocator) Path {
+    return .{.allocator = allocator, .commands = .{}, .flattened = .{}};
+  }
+
+  pub fn deinit(p: *Path) void {
+    p.invalidate();
+    p.commands.deinit(p.allocator);
+    p.flattened.deinit(p.allocator);
+  }
+
+  fn invalidate(p: *Path) void {
+    var iter = p.flattened.valueIterator();
+    while (iter.next()) |f| f.deinit(p.allocator);
+    p.flattened.clearRetainingCapacity();
+  }
+
+  fn add(p: *Path, cmd: Command) !void {
+    p.invalidate();
+    try p.commands.append(p.allocator, cmd);
+  }
+
+  /// moveTo starts a new contour at (x, y).
+  pub fn moveTo(p: *Path, x: f32, y: f32) !void {
+    try p.add(.{.move = .{x, y}});
+  }
+
+  /// lineTo adds a straight line to (x, y).
+  pub fn lineTo(p: *Path, x: f32, y: f32) !void {
+    try p.add(.{.line = .{x, y}});
+  }
+
+  /// quadTo adds a quadratic Bézier curve with the control point (cx, cy)
+  /// ending at (x, y).
+  pub fn quadTo(p: *Path, cx: f32, cy: f32, x: f32, y: f32) !void {
+    try p.add(.{.quad = .{.{cx, cy}, .{x, y}}});
+  }
+
+  /// cubicTo adds a cubic Bézier curve with the control points (c1x, c1y) and
+  /// (c2x, c2y) ending at (x, y).
+  pub fn cubicTo(p: *Path, c1x: f32, c1y: f32, c2x: f32, c2y: f32, x: f32, y: f32) !void {
+    try p.add(.{.cubic = .{.{c1x, c1y}, .{c2x, c2y}, .{x, y}}});
+  }
+
+  /// close closes the current contour with a straight line to its start.
+  pub fn close(p: *Path) !void {
+    try p.add(.close);
+  }
+
+  /// flatten converts the path's curves into lines which deviate at most
+  /// tolerance from them.
+  fn flatten(p: *const Path, tolerance: f32, points: *std.ArrayListUnmanaged([2]f32),
+             contours: *std.ArrayListUnmanaged(Contour)) !void {
+    var start: usize = 0;
+    var cur = [2]f32{0, 0};
+    for (p.commands.items) |cmd| {
+      switch (cmd) {
+        .move => |to| {
+          if (points.items.len > start) {
+            try contours.append(p.allocator, .{.start = start, .len = points.items.len - start, .closed = false});
+          }
+          start = points.items.len;
+          try points.append(p.allocator, to);
+          cur = to;
+        },
+        .line => |to| {
+          if (points.items.len == start) try points.append(p.allocator, cur);
+          try points.append(p.allocator, to);
+          cur = to;
+        },
+        .quad => |v| {
+          if (points.items.len == start) try points.append(p.allocator, cur);
+          // Wang's formula for the number of segments.
+          const dd = vecLength(vecSub(vecAdd(cur, v[1]), vecScale(v[0], 2)));
+          const n = segmentCount(@sqrt(dd / (4 * tolerance)));
+          var i: usize = 1;
+          while (i <= n) : (i += 1) {
+            const t = @intToFloat(f32, i) / @intToFloat(f32, n);
+            const u = 1 - t;
+            try points.append(p.allocator, vecAdd(vecAdd(vecScale(cur, u * u), vecScale(v[0], 2 * u * t)), vecScale(v[1], t * t)));
+          }
+          cur = v[1];
+        },
+        .cubic => |v| {
+          if (points.items.len == start) try points.append(p.allocator, cur);
+          const dd = std.math.max(vecLength(vecSub(vecAdd(cur, v[1]), vecScale(v[0], 2))),
+                                  vecLength(vecSub(vecAdd(v[0], v[2]), vecScale(v[1], 2))));
+          const n = segmentCount(@sqrt(0.75 * dd / tolerance));
+          var i: usize = 1;
+          while (i <= n) : (i += 1) {
+            const t = @intToFloat(f32, i) / @intToFloat(f32, n);
+            const u = 1 - t;
+            try points.append(p.allocator, vecAdd(vecAdd(vecScale(cur, u * u * u), vecScale(v[0], 3 * u * u * t)),
+                vecAdd(vecScale(v[1], 3 * u * t * t), vecScale(v[2], t * t * t))));
+          }
+          cur = v[2];
+        },
+        .close => {
+          if (points.items.len - start > 1) {
+            try contours.append(p.allocator, .{.start = start, .len = points.items.len - start, .closed = true});
+          }
+          cur = if (points.items.len > start) points.items[start] else cur;
+          start = points.items.len;
+        },
+      }
+    }
+    if (points.items.len - start > 1) {
+      try contours.append(p.allocator, .{.start = start, .len = points.items.len - start, .closed = false});
+    }
+  }
+
+  fn segmentCount(v: f32) usize {
+    return @floatToInt(usize, std.math.clamp(@ceil(v), 1, max_curve_segments));
+  }
+};
+
+/// maximum number of line segments a curve is flattened into.
+const max_curve_segments = 128;
+/// maximum deviation in pixels of flattened curves from the actual curves.
+const curve_tolerance = 0.25;
+/// maximum number of scale buckets a path keeps flattened versions for.
+const max_flattened_paths = 4;
+
+/// FillRule defines which areas of a path are inside it.
+pub const FillRule = enum(c_int) {
+  /// inside are areas around which the contours wind a non-zero number of
+  /// times, counting clockwise and counter-clockwise turns oppositely.
+  non_zero,
+  /// inside are areas around which the contours wind an odd number of times.
+  even_odd,
+};
+
+fn vecAdd(a: [2]f32, b: [2]f32) [2]f32 {
+  return .{a[0] + b[0], a[1] + b[1]};
+}
+
+fn vecSub(a: [2]f32, b: [2]f32) [2]f32 {
+  return .{a[0] - b[0], a[1] - b[1]};
+}
+
+fn vecScale(a: [2]f32, f: f32) [2]f32 {
+  return .{a[0] * f, a[1] * f};
+}
+
+fn vecLength(a: [2]f32) f32 {
+  return @sqrt(a[0] * a[0] + a[1] * a[1]);
+}
+
+/// GradientStop is the color of a gradient at offset, which goes from 0 at the
+/// gradient's start to 1 at its end.
+pub const GradientStop = extern struct {
+  offset: f32,
+  color: [4]u8,
+};
+
+/// Gradient is a color ramp through its stops, which must be ordered by
+/// offset. Before the first and after the last stop, the color of that stop
+/// is used.
+pub const Gradient = extern struct {
+  pub const Kind = enum(c_int) {
+    /// the color changes along the line from start to end.
+    linear,
+    /// the color changes along circles around start, up to the distance of
+    /// end.
+    radial,
+  };
+
+  kind: Kind,
+  /// start and end in the current coordinate system.
+  start: [2]f32,
+  end: [2]f32,
+  stops: [*]const GradientStop,
+  stop_count: usize,
+
+  pub fn slice(g: Gradient) []const GradientStop {
+    return g.stops[0..g.stop_count];
+  }
+};
+
+/// GradientRect is a rectangle filled with a gradient by Engine.fillGradients.
+pub const GradientRect = extern struct {
+  /// the rectangle in the current coordinate system.
+  x: f32,
+  y: f32,
+  width: f32,
+  height: f32,
+  gradient: Gradient,
+
+  pub fn init(r: Rectangle, g: Gradient) GradientRect {
+    return .{
+      .x = @intToFloat(f32, r.x), .y = @intToFloat(f32, r.y),
+      .width = @intToFloat(f32, r.width), .height = @intToFloat(f32, r.height),
+      .gradient = g,
+    };
+  }
+};
+
+/// number of texels of a gradient's color ramp.
+const gradient_ramp_size = 256;
+/// maximum number of color ramps kept in the lookup texture.
+const max_gradient_ramps = 64;
+/// number of floats per vertex of a gradient fill: position, start and end
+/// of the gradient, and the ramp's row in the lookup texture.
+const gradient_floats = 7;
+
+/// GradientRamps keeps the color ramps of recently drawn gradients as rows of
+/// a texture, which the gradient shaders use as 1D lookup texture. Rows are
+/// keyed by the hash of the gradient's stops. When all rows are taken, the
+/// least recently used one is replaced.
+const GradientRamps = struct {
+  const Row = struct {
+    hash: u64,
+    /// batch the row has last been used in.
+    last_used: u32,
+  };
+
+  /// the lookup texture, created on first use.
+  image: ?Image,
+  rows: [max_gradient_ramps]Row,
+  row_count: u8,
+  /// the batch currently being collected. Its rows must not be replaced
+  /// before it has been drawn.
+  batch: u32,
+
+  fn empty() GradientRamps {
+    return .{.image = null, .rows = undefined, .row_count = 0, .batch = 1};
+  }
+
+  fn deinit(r: *GradientRamps) void {
+    if (r.image) |*image| image.free();
+  }
+
+  /// get returns the row holding the ramp of the given stops, uploading it if
+  /// necessary. Returns null if all rows are used by the current batch.
+  fn get(r: *GradientRamps, e: *Engine, stops: []const GradientStop) ?u8 {
+    const hash = std.hash.Wyhash.hash(0, std.mem.sliceAsBytes(stops));
+    var lru: ?u8 = null;
+    for (r.rows[0..r.row_count]) |*row, i| {
+      if (row.hash == hash) {
+        row.last_used = r.batch;
+        return @intCast(u8, i);
+      }
+      // compared by age, since batch wraps around.
+      if (row.last_used != r.batch and (lru == null or r.batch -% row.last_used > r.batch -% r.rows[lru.?].last_used)) {
+        lru = @intCast(u8, i);
+      }
+    }
+    const index: u8 = if (r.row_count < max_gradient_ramps) blk: {
+      r.row_count += 1;
+      break :blk r.row_count - 1;
+    } else lru orelse return null;
+
+    if (r.image == null) {
+      r.image = Engine.Impl.genTexture(e, gradient_ramp_size, max_gradient_ramps, 4, false, null);
+    }
+    var texels: [gradient_ramp_size][4]u8 = undefined;
+    fillRamp(stops, &texels);
+    gl.bindTexture(r.image.?.id, .@"2d");
+    gl.pixelStore(.unpack_alignment, 4);
+    epoxy.glTexSubImage2D(epoxy.GL_TEXTURE_2D, 0, 0, index, gradient_ramp_size, 1,
+        epoxy.GL_RGBA, epoxy.GL_UNSIGNED_BYTE, &texels);
+    r.rows[index] = .{.hash = hash, .last_used = r.batch};
+    return index;
+  }
+
+  /// fillRamp interpolates the colors of the given stops into texels.
+  fn fillRamp(stops: []const GradientStop, texels: *[gradient_ramp_size][4]u8) void {
+    if (stops.len == 0) {
+      std.mem.set([4]u8, texels, .{0, 0, 0, 0});
+      return;
+    }
+    var k: usize = 0;
+    for (texels.*) |*texel, i| {
+      const t = @intToFloat(f32, i) / (gradient_ramp_size - 1);
+      while (k + 1 < stops.len and stops[k + 1].offset <= t) k += 1;
+      if (k + 1 == stops.len or t <= stops[k].offset) {
+        texel.* = stops[k].color;
+        continue;
+      }
+      const a = stops[k];
+      const b = stops[k + 1];
+      const f = (t - a.offset) / (b.offset - a.offset);
+      for (texel.*) |*v, j| {
+        v.* = @floatToInt(u8, @round(@intToFloat(f32, a.color[j]) * (1 - f) + @intToFloat(f32, b.color[j]) * f));
+      }
+    }
+  }
+};
+
+const GradientProc = struct {
+  p: gl.Program,
+  transform: u32,
+  ramps: u32,
+  /// attributes a_position, a_start, a_end and a_row.
+  attributes: [4]u32,
+  const sizes = [_]u8{2, 2, 2, 1};
+  const offsets = [_]usize{0, 2, 4, 6};
+
+  fn init(vs_src: []const u8, fs_src: []const u8) !GradientProc {
+    const p = try linkProgram(vs_src, fs_src);
+    errdefer gl.deleteProgram(p);
+    return GradientProc{
+      .p = p,
+      .transform = try getUniformLocation(p, "u_transform"),
+      .ramps = try getUniformLocation(p, "s_ramps"),
+      .attributes = .{
+        try getAttribLocation(p, "a_position"), try getAttribLocation(p, "a_start"),
+        try getAttribLocation(p, "a_end"), try getAttribLocation(p, "a_row"),
+      },
+    };
+  }
+};
+
+//////////////////////////////////////////////////////////////////////////////
+// Engine
+
+const gl = @import("zgl");
+
+// raw bindings for the few OpenGL functions zgl does not wrap.
+const epoxy = @cImport({
+  @cInclude("epoxy/gl.h");
+});
+
+const c = @cImport({
+  @cInclude("stb_image.h");
+});
+
+const ShaderError = error {
+  CompilationFailed,
+  LinkingFailed,
+  AttributeProblem
+};
+
+const EngineError = error {
+  NoDebugAvailable,
+  FreeTypeError,
+  IncompleteFramebuffer,
+  InvalidIterations,
+  NonSimplePolygon,
+};
+
+fn loadShader(src: []const u8, t: gl.ShaderType) !gl.Shader {
+  var shader = gl.createShader(t);
+  gl.shaderSource(shader, 1, &[_][]const u8{src});
+  errdefer gl.deleteShader(shader);
+  gl.compileShader(shader);
+  var compiled = gl.getShader(shader, gl.ShaderParameter.compile_status);
+  if (compiled == 1) {
+    return shader;
+  }
+  var log = try gl.getShaderInfoLog(shader, std.heap.c_allocator);
+  defer std.heap.c_allocator.free(log);
+  std.log.scoped(.zargo).err("error compiling shader: {s} –– shader source:\n{s}\n-- end shader source", .{log, src});
+  return ShaderError.CompilationFailed;
+}
+
+fn linkProgram(vs_src: []const u8, fs_src: []const u8) !gl.Program {
+  var vertex_shader = try loadShader(vs_src, gl.ShaderType.vertex);
+  errdefer gl.deleteShader(vertex_shader);
+  var fragment_shader = try loadShader(fs_src, gl.ShaderType.fragment);
+  errdefer gl.deleteShader(fragment_shader);
+  var program = gl.createProgram();
+  errdefer gl.deleteProgram(program);
+  gl.attachShader(program, vertex_shader);
+  gl.attachShader(program, fragment_shader);
+  gl.linkProgram(program);
+  var linked = gl.getProgram(program, gl.ProgramParameter.link_status);
+  if (linked == 1) {
+    return program;
+  }
+  var log = try gl.getProgramInfoLog(program, std.heap.c_allocator);
+  defer std.heap.c_allocator.free(log);
+  std.log.scoped(.zargo).err("error compiling shader: {s}", .{log});
+  return ShaderError.LinkingFailed;
+}
+
+fn getUniformLocation(p: gl.Program, name: [:0]const u8) !u32 {
+  if (gl.getUniformLocation(p, name)) |value| {
+    return value;
+  }
+  std.log.scoped(.zargo).err("unable to get attribute '{s}' location\n", .{name});
+  return ShaderError.AttributeProblem;
+}
+
+fn getAttribLocation(p: gl.Program, name: [:0]const u8) !u32 {
+  if (gl.getAttribLocation(p, name)) |value| {
+    return value;
+  }
+  std.log.scoped(.zargo).err("unable to get attribute '{s}' location\n", .{name});
+  return ShaderError.AttributeProblem;
+}
+
+/// alignedRect returns the rectangle t transforms the unit square around
+/// (0,0) into, if that rectangle is axis-aligned and has integral position and
+/// size. Returns null otherwise.
+fn alignedRect(t: Transform) ?Rectangle {
+  if (t.m[0][1] != 0 or t.m[1][0] != 0) return null;
+  const w = t.m[0][0];
+  const h = t.m[1][1];
+  const x = t.m[2][0] - w / 2.0;
+  const y = t.m[2][1] - h / 2.0;
+  if (w < 1 or h < 1 or w != @round(w) or h != @round(h) or x != @round(x) or y != @round(y) or
+      @fabs(x) > 1.0e8 or @fabs(y) > 1.0e8 or w > 1.0e8 or h > 1.0e8) return null;
+  return Rectangle{.x = @floatToInt(i32, x), .y = @floatToInt(i32, y),
+      .width = @floatToInt(u31, w), .height = @floatToInt(u31, h)};
+}
+
+fn setUniformColor(id: u32, color: [4]u8) void {
+  gl.uniform4f(id, @intToFloat(f32, color[0]) / 255.0,
+      @intToFloat(f32, color[1]) / 255.0, @intToFloat(f32, color[2]) / 255.0,
+      @intToFloat(f32, color[3]) / 255.0);
+}
+
+/// Backend defines the possible backends the engine can use. These are
+/// currently OpenGL 3.2, OpenGL 4.3, OpenGL ES 2.0, and OpenGL ES 3.1.
+/// The differences relevant to the engine are:
+///
+///  * OpenGL 4.3 will enable you to turn on debug output and is the only
+///    backend with this capability.
+///  * OpenGL 3.2 is the only backend available on macOS.
+///  * OpenGL ES 2.0 is widely supported on mobile devices but does not let you
+///    use MSAA when drawing to a canvas.
+///  * OpenGL ES 3.1 is supported on a small number on recent devices and does
+///    let you use MSAA when drawing to a canvas.
+///
+/// Other OpenGL versions are not supported as backends because they don't bring
+/// any relevant functionality.
+pub const Backend = enum(c_int) {
+  ogl_32, ogl_43, ogles_20, ogles_31
+};
+
+const ShaderKind = enum {
+  vertex, fragment
+};
+
+/// Fill selects the variant of the rect shader.
+const Fill = enum {
+  solid, linear, radial
+};
+
+const Shaders = struct {
+  rect_vertex: []const u8,
+  rect_fragment: []const u8,
+  img_vertex: []const u8,
+  img_fragment: []const u8,
+  blend_vertex: []const u8,
+  blend_fragment: []const u8,
+  kawase_down_fragment: []const u8,
+  kawase_up_fragment: []const u8,
+  text_vertex: []const u8,
+  text_fragment: []const u8,
+  sdf_text_fragment: []const u8,
+  line_vertex: []const u8,
+  line_fragment: []const u8,
+  sdf_shape_vertex: []const u8,
+  sdf_shape_fragment: []const u8,
+  linear_gradient_vertex: []const u8,
+  linear_gradient_fragment: []const u8,
+  radial_gradient_vertex: []const u8,
+  radial_gradient_fragment: []const u8,
+};
+
+fn genShaders(comptime backend: Backend) Shaders {
+  const builder = struct {
+    fn versionDef() []const u8 {
+      return switch (backend) {
+        .ogl_32, .ogl_43 => "#version 150\n",
+        .ogles_20, .ogles_31 => "#version 100\n",
+      };
+    }
+
+    fn attr(comptime def: []const u8) []const u8 {
+      return switch (backend) {
+        .ogl_32, .ogl_43 => "in ",
+        .ogles_20, .ogles_31 => "attribute ",
+      } ++ def ++ ";\n";
+    }
+
+    fn uniform(comptime def: []const u8) []const u8 {
+      return "uniform " ++ def ++ ";\n";
+    }
+
+    fn varyOut(comptime def: []const u8) []const u8 {
+      return switch (backend) {
+        .ogl_32, .ogl_43 => "out ",
+        .ogles_20, .ogles_31 => "varying ",
+      } ++ def ++ ";\n";
+    }
+
+    fn varyIn(comptime def: []const u8) []const u8 {
+      return switch (backend) {
+        .ogl_32, .ogl_43 => "in ",
+        .ogles_20, .ogles_31 => "varying "
+      } ++ def ++ ";\n";
+    }
+
+    fn fragColorDef() []const u8 {
+      return switch (backend) {
+        .ogl_32, .ogl_43 => "out vec4 fragColor;\n",
+        .ogles_20, .ogles_31 => "",
+      };
+    }
+
+    fn fragColor() []const u8 {
+      return switch (backend) {
+        .ogl_32, .ogl_43 => "fragColor",
+        .ogles_20, .ogles_31 => "gl_FragColor",
+      };
+    }
+
+    fn texture(comptime args: []const u8) []const u8 {
+      return switch (backend) {
+        .ogl_32, .ogl_43 => "texture(",
+        .ogles_20, .ogles_31 => "texture2D(",
+      } ++ args ++ ")";
+    }
+
+    fn precision(comptime def: []const u8) []const u8 {
+      return "precision " ++ def ++ ";\n";
+    }
+
+    /// highPrecision selects high float precision if the fragment shader
+    /// supports it.
+    fn highPrecision() []const u8 {
+      return "#ifdef GL_FRAGMENT_PRECISION_HIGH\n" ++ precision("highp float")
+          ++ "#else\n" ++ precision("mediump float") ++ "#endif\n";
+    }
+
+    const ramp_size = std.fmt.comptimePrint("{d}.0", .{gradient_ramp_size});
+
+    fn matMult(comptime m: []const u8, comptime v: []const u8) []const u8 {
+      return "vec2(" ++ m ++ "[0].x * " ++ v ++ ".x + " ++ m ++ "[1].x * " ++ v ++ ".y + " ++ m ++ "[2].x, "
+          ++ m ++ "[0].y * " ++ v ++ ".x + " ++ m ++ "[1].y * " ++ v ++ ".y + " ++ m ++ "[2].y)";
+    }
+
+    /// rect fills areas with a solid color or a gradient. Gradient variants
+    /// take the gradient's start and end, and the row of its color ramp in
+    /// s_ramps, per vertex so that different gradients can be drawn at once.
+    fn rect(comptime kind: ShaderKind, comptime fill: Fill) []const u8 {
+      return switch (fill) {
+        .solid => switch (kind) {
+          .vertex => versionDef() ++ uniform("vec2 u_transform[3]")
+              ++ attr("vec2 a_position") ++
+              \\ void main() {
+              \\   gl_Position = vec4(
+              ++     matMult("u_transform", "a_position") ++
+              \\     , 0, 1
+              \\   );
+              \\ }
+            ,
+          .fragment => versionDef() ++ precision("mediump float")
+              ++ uniform("vec4 u_color") ++ fragColorDef() ++
+              "void main() {\n  " ++ fragColor() ++ " = u_color;\n}",
+        },
+        .linear, .radial => switch (kind) {
+          .vertex => versionDef() ++ uniform("vec2 u_transform[3]")
+              ++ attr("vec2 a_position")
+              ++ attr("vec2 a_start")
+              ++ attr("vec2 a_end")
+              ++ attr("float a_row")
+              ++ varyOut("float v_row") ++ switch (fill) {
+                // the position along a linear gradient is affine, so it is
+                // computed per vertex.
+                .linear => varyOut("float v_t") ++
+                  \\ void main() {
+                  \\   vec2 d = a_end - a_start;
+                  \\   v_t = dot(a_position - a_start, d) / max(dot(d, d), 0.000001);
+                  \\
+                  ,
+                else => varyOut("vec2 v_offset") ++ varyOut("float v_radius") ++
+                  \\ void main() {
+                  \\   v_offset = a_position - a_start;
+                  \\   v_radius = max(length(a_end - a_start), 0.000001);
+                  \\
+                  ,
+              } ++
+              \\   v_row = a_row;
+              \\   gl_Position = vec4(
+              ++     matMult("u_transform", "a_position") ++
+              \\     , 0, 1);
+              \\ }
+            ,
+          .fragment => versionDef() ++ highPrecision()
+              ++ varyIn("float v_row") ++ switch (fill) {
+                .linear => varyIn("float v_t") ++ "float position() { return v_t; }\n",
+                else => varyIn("vec2 v_offset") ++ varyIn("float v_radius")
+                    ++ "float position() { return length(v_offset) / v_radius; }\n",
+              } ++ fragColorDef()
+              ++ uniform("sampler2D s_ramps") ++
+              \\ void main() {
+              \\   float t = (clamp(position(), 0.0, 1.0) * (
+              ++     ramp_size ++ " - 1.0) + 0.5) / " ++ ramp_size ++ ";\n  "
+              ++ fragColor() ++ " = " ++ texture("s_ramps, vec2(t, v_row)") ++ ";\n}",
+        },
+      };
+    }
+
+    fn img(comptime kind: ShaderKind) []const u8 {
+      return switch(kind) {
+        .vertex => versionDef()
+            ++ uniform("vec2 u_src_transform[3]")
+            ++ uniform("vec2 u_dst_transform[3]")
+            ++ attr("vec2 a_position")
+            ++ varyOut("vec2 v_texCoord") ++
+            \\ void main() {
+            \\   gl_Position = vec4(
+            ++     matMult("u_dst_transform", "a_position") ++
+            \\     , 0, 1);
+            \\   v_texCoord = vec2(
+            \\     u_src_transform[0].x * a_position.x + u_src_transform[1].x * a_position.y + u_src_transform[2].x,
+            \\     u_src_transform[0].y * a_position.x + u_src_transform[1].y * a_position.y + u_src_transform[2].y
+            \\   );
+            \\ }
+            ,
+        .fragment => versionDef() ++ precision("mediump float")
+            ++ varyIn("vec2 v_texCoord") ++ fragColorDef()
+            ++ uniform("sampler2D s_texture") ++ uniform("float u_alpha") ++
+            \\ void main() {
+            \\   vec4 c =
+            ++ texture("s_texture, v_texCoord") ++ ";\n  "
+            ++ fragColor() ++ " = vec4(c.rgb, u_alpha * c.a);\n}",
+      };
+    }
+
+    fn blend(comptime kind: ShaderKind) []const u8 {
+      return switch(kind) {
+        .vertex => versionDef()
+            ++ uniform("vec2 u_posTrans[3]")
+            ++ uniform("vec2 u_texTrans[3]")
+            ++ attr("vec2 a_position")
+            ++ varyOut("vec2 v_texCoord") ++
+            \\ void main() {
+            \\   gl_Position = vec4(
+            ++       matMult("u_posTrans", "a_position") ++
+            \\       , 0, 1);
+            \\   vec2 flipped = vec2(a_position.x, 1.0-a_position.y);
+            \\   v_texCoord =
+            ++       matMult("u_texTrans", "flipped") ++
+            \\   ;
+            \\ }
+            ,
+        .fragment => versionDef() ++ precision("mediump float")
+            ++ varyIn("vec2 v_texCoord") ++ fragColorDef()
+            ++ uniform("sampler2D s_texture")
+            ++ uniform("vec4 u_primary")
+            ++ uniform("vec4 u_secondary") ++
+            \\ void main() {
+            \\   float a =
+            ++       texture("s_texture, v_texCoord") ++ ".r;"
+            ++   fragColor() ++ " = a * u_primary + (1.0-a) * u_secondary;" ++
+            \\ }
+      };
+    }
+
+    /// fragment shaders of the dual filter Kawase blur. Both use the img
+    /// vertex shader. u_halfpixel is half the size of a target pixel in
+    /// texture coordinates.
+    fn kawase(comptime dir: enum {down, up}) []const u8 {
+      const head = versionDef() ++ precision("mediump float")
+          ++ varyIn("vec2 v_texCoord") ++ fragColorDef()
+          ++ uniform("sampler2D s_texture")
+          ++ uniform("vec2 u_halfpixel")
+          ++ uniform("float u_offset");
+      return head ++ switch (dir) {
+        .down =>
+            \\ void main() {
+            \\   vec2 hp = u_halfpixel * u_offset;
+            \\   vec4 sum =
+            ++ texture("s_texture, v_texCoord") ++ " * 4.0 +\n"
+            ++ texture("s_texture, v_texCoord - hp") ++ " +\n"
+            ++ texture("s_texture, v_texCoord + hp") ++ " +\n"
+            ++ texture("s_texture, v_texCoord + vec2(hp.x, -hp.y)") ++ " +\n"
+            ++ texture("s_texture, v_texCoord - vec2(hp.x, -hp.y)") ++ ";\n"
+            ++ fragColor() ++ " = sum / 8.0;\n}",
+        .up =>
+            \\ void main() {
+            \\   vec2 hp = u_halfpixel * u_offset;
+            \\   vec4 sum =
+            ++ texture("s_texture, v_texCoord + vec2(-hp.x * 2.0, 0.0)") ++ " +\n"
+            ++ texture("s_texture, v_texCoord + vec2(-hp.x, hp.y)") ++ " * 2.0 +\n"
+            ++ texture("s_texture, v_texCoord + vec2(0.0, hp.y * 2.0)") ++ " +\n"
+            ++ texture("s_texture, v_texCoord + vec2(hp.x, hp.y)") ++ " * 2.0 +\n"
+            ++ texture("s_texture, v_texCoord + vec2(hp.x * 2.0, 0.0)") ++ " +\n"
+            ++ texture("s_texture, v_texCoord + vec2(hp.x, -hp.y)") ++ " * 2.0 +\n"
+            ++ texture("s_texture, v_texCoord + vec2(0.0, -hp.y * 2.0)") ++ " +\n"
+            ++ texture("s_texture, v_texCoord + vec2(-hp.x, -hp.y)") ++ " * 2.0;\n"
+            ++ fragColor() ++ " = sum / 12.0;\n}",
+      };
+    }
+
+    /// draws glyphs from the single-channel glyph atlas. Vertices are given in
+    /// the current coordinate system, texture coordinates are normalized.
+    fn text(comptime kind: ShaderKind) []const u8 {
+      return switch(kind) {
+        .vertex => versionDef()
+            ++ uniform("vec2 u_transform[3]")
+            ++ attr("vec2 a_position")
+            ++ attr("vec2 a_texCoord")
+            ++ varyOut("vec2 v_texCoord") ++
+            \\ void main() {
+            \\   gl_Position = vec4(
+            ++     matMult("u_transform", "a_position") ++
+            \\     , 0, 1);
+            \\   v_texCoord = a_texCoord;
+            \\ }
+            ,
+        .fragment => versionDef() ++ precision("mediump float")
+            ++ varyIn("vec2 v_texCoord") ++ fragColorDef()
+            ++ uniform("sampler2D s_texture")
+            ++ uniform("vec4 u_color") ++
+            \\ void main() {
+            \\   float a =
+            ++       texture("s_texture, v_texCoord") ++ ".r;\n  "
+            ++   fragColor() ++ " = vec4(u_color.rgb, u_color.a * a);\n}",
+      };
+    }
+
+    /// fragment shader drawing glyphs stored as signed distance fields, used
+    /// with the text vertex shader. The outline is at 0.5, u_smoothing is half
+    /// the width of the anti-aliased edge in distance field units.
+    fn sdfText() []const u8 {
+      return versionDef() ++ precision("mediump float")
+          ++ varyIn("vec2 v_texCoord") ++ fragColorDef()
+          ++ uniform("sampler2D s_texture")
+          ++ uniform("vec4 u_color")
+          ++ uniform("float u_smoothing") ++
+          \\ void main() {
+          \\   float d =
+          ++     texture("s_texture, v_texCoord") ++ ".r;\n" ++
+          \\   float a = smoothstep(0.5 - u_smoothing, 0.5 + u_smoothing, d);
+          \\
+          ++   fragColor() ++ " = vec4(u_color.rgb, u_color.a * a);\n}";
+    }
+
+    /// vertex shader expanding a line segment from a_p0 to a_p1 into a quad,
+    /// with miter joins towards a_prev and a_next. a_corner.x selects the end
+    /// of the segment, a_corner.y its side. The quad is half a pixel wider
+    /// than the line on each side for anti-aliasing; u_scale is the size of a
+    /// unit of the line's points in pixels.
+    fn line(comptime kind: ShaderKind) []const u8 {
+      return switch (kind) {
+        .vertex => versionDef()
+            ++ uniform("vec2 u_transform[3]")
+            ++ uniform("float u_halfWidth")
+            ++ uniform("float u_scale")
+            ++ attr("vec2 a_corner")
+            ++ attr("vec2 a_prev")
+            ++ attr("vec2 a_p0")
+            ++ attr("vec2 a_p1")
+            ++ attr("vec2 a_next")
+            ++ varyOut("float v_dist")
+            ++ varyOut("float v_halfWidth") ++
+            \\ vec2 normalOf(vec2 d) {
+            \\   float l = length(d);
+            \\   return l > 0.000001 ? vec2(-d.y, d.x) / l : vec2(0.0);
+            \\ }
+            \\ void main() {
+            \\   vec2 n = normalOf(a_p1 - a_p0);
+            \\   vec2 p = a_corner.x < 0.5 ? a_p0 : a_p1;
+            \\   vec2 other = normalOf(a_corner.x < 0.5 ? a_p0 - a_prev : a_next - a_p1);
+            \\   vec2 sum = n + other;
+            \\   vec2 m = n;
+            \\   if (dot(other, other) > 0.0 && dot(sum, sum) > 0.000001) {
+            \\     m = normalize(sum);
+            \\     m /= max(dot(m, n), 0.25);
+            \\   }
+            \\   float w = u_halfWidth + 0.5 / u_scale;
+            \\   vec2 pos = p + m * (a_corner.y * w);
+            \\   v_dist = a_corner.y * w * u_scale;
+            \\   v_halfWidth = u_halfWidth * u_scale;
+            \\   gl_Position = vec4(
+            ++     matMult("u_transform", "pos") ++
+            \\     , 0, 1);
+            \\ }
+            ,
+        .fragment => versionDef() ++ precision("mediump float")
+            ++ varyIn("float v_dist")
+            ++ varyIn("float v_halfWidth") ++ fragColorDef()
+            ++ uniform("vec4 u_color") ++
+            \\ void main() {
+            \\   float a = clamp(v_halfWidth + 0.5 - abs(v_dist), 0.0, 1.0);
+            \\
+            ++   fragColor() ++ " = vec4(u_color.rgb, u_color.a * a);\n}",
+      };
+    }
+
+    /// shader drawing the shapes described by Shape as quads. The vertex
+    /// shader expands each shape's bounding box, given as center and half size
+    /// in a_rect, by a pixel for anti-aliasing; the fragment shader computes
+    /// the signed distance to the rounded rectangle's outline.
+    fn sdfShape(comptime kind: ShaderKind) []const u8 {
+      return switch (kind) {
+        .vertex => versionDef()
+            ++ uniform("vec2 u_transform[3]")
+            ++ attr("vec2 a_corner")
+            ++ attr("vec4 a_rect")
+            ++ attr("vec2 a_params")
+            ++ attr("vec4 a_color")
+            ++ varyOut("vec2 v_local")
+            ++ varyOut("vec2 v_halfSize")
+            ++ varyOut("vec2 v_params")
+            ++ varyOut("vec4 v_color") ++
+            \\ void main() {
+            \\   // a_corner is shared with lines, whose x goes from 0 to 1.
+            \\   vec2 corner = vec2(a_corner.x * 2.0 - 1.0, a_corner.y);
+            \\   v_local = corner * (a_rect.zw + 1.0);
+            \\   v_halfSize = a_rect.zw;
+            \\   v_params = a_params;
+            \\   v_color = a_color;
+            \\   vec2 pos = a_rect.xy + v_local;
+            \\   gl_Position = vec4(
+            ++     matMult("u_transform", "pos") ++
+            \\     , 0, 1);
+            \\ }
+            ,
+        .fragment => versionDef() ++ highPrecision()
+            ++ varyIn("vec2 v_local")
+            ++ varyIn("vec2 v_halfSize")
+            ++ varyIn("vec2 v_params")
+            ++ varyIn("vec4 v_color") ++ fragColorDef() ++
+            \\ void main() {
+            \\   float r = min(v_params.x, min(v_halfSize.x, v_halfSize.y));
+            \\   vec2 q = abs(v_local) - v_halfSize + r;
+            \\   float d = length(max(q, 0.0)) + min(max(q.x, q.y), 0.0) - r;
+            \\   float a = clamp(0.5 - d, 0.0, 1.0);
+            \\   if (v_params.y > 0.0) a *= clamp(d + v_params.y + 0.5, 0.0, 1.0);
+            \\
+            ++   fragColor() ++ " = vec4(v_color.rgb, v_color.a * a);\n}",
+      };
+    }
+  };
+  return .{
+    .rect_vertex = builder.rect(.vertex, .solid),
+    .rect_fragment = builder.rect(.fragment, .solid),
+    .img_vertex = builder.img(.vertex),
+    .img_fragment = builder.img(.fragment),
+    .blend_vertex = builder.blend(.vertex),
+    .blend_fragment = builder.blend(.fragment),
+    .kawase_down_fragment = builder.kawase(.down),
+    .kawase_up_fragment = builder.kawase(.up),
+    .text_vertex = builder.text(.vertex),
+    .text_fragment = builder.text(.fragment),
+    .sdf_text_fragment = builder.sdfText(),
+    .line_vertex = builder.line(.vertex),
+    .line_fragment = builder.line(.fragment),
+    .sdf_shape_vertex = builder.sdfShape(.vertex),
+    .sdf_shape_fragment = builder.sdfShape(.fragment),
+    .linear_gradient_vertex = builder.rect(.vertex, .linear),
+    .linear_gradient_fragment = builder.rect(.fragment, .linear),
+    .radial_gradient_vertex = builder.rect(.vertex, .radial),
+    .radial_gradient_fragment = builder.rect(.fragment, .radial),
+  };
+}
+
+fn EngineImpl(comptime Self: type, comptime RectImpl: type, comptime ImgImpl: type) type {
+  const len_type = std.meta.fieldInfo(ImgImpl, .width).field_type;
+  return struct {
+    fn debugCallback(e: *const Self, source: gl.DebugSource,
+        msg_type: gl.DebugMessageType, id: usize, severity: gl.DebugSeverity,
+        message: []const u8) void {
+      _ = id; _ = e;
+      if (msg_type == .@"error") {
+        std.log.scoped(.OpenGL).err("[{s}] {s}: {s}", .{@tagName(severity), @tagName(source), message});
+      } else if (severity != .notification) {
+        std.log.scoped(.OpenGL).warn("[{s}|{s}] {s}: {s}", .{@tagName(msg_type), @tagName(severity), @tagName(source), message});
+      } else {
+        std.log.scoped(.OpenGL).info("[{s}|{s}] {s}: {s}", .{@tagName(msg_type), @tagName(severity), @tagName(source), message});
+      }
+    }
+
+    /// init initializes the engine and must be called once before using the
+    /// engine. Before initializing the engine, you must create an OpenGL context.
+    /// This is platform dependent and therefore not implemented by the engine.
+    /// You can use libraries like GLFW or SDL to create a context.
+    ///
+    /// The backend you give must match the OpenGL context you created.
+    /// If it doesn't, you will likely get errors from shader compilation.
+    ///
+    /// windows_width and window_height ought to be the size of your OpenGL
+    /// context in pixels. Mind that this must be the *real* pixel size, not the
+    /// virtual pixel size you may get if you have an HiDPI monitor.
+    /// If your window is resizeable, you can change the window size later with
+    /// setWindowSize.
+    ///
+    /// Only set debug to true if backend is ogl_43. No other backend supports
+    /// debug output and will return an error.
+    pub fn init(
+      e: *Self,
+      allocator: std.mem.Allocator,
+      backend: Backend,
+      window_width: u32,
+      window_height: u32,
+      debug: bool,
+    ) !void {
+      e.backend = backend;
+      if (debug) {
+        if (backend != .ogl_43) {
+          return EngineError.NoDebugAvailable;
+        }
+        gl.enable(gl.Capabilities.debug_output);
+        gl.debugMessageCallback(e, debugCallback);
+        //gl.debugMessageInsert(.application, .other, .notification, "initialized debug output");
+      }
+
+      const vertices = [_]f32{0.0, 0.0, 1.0, 0.0, 1.0, 1.0, 0.0, 1.0};
+      e.vbo = gl.genBuffer();
+      gl.bindBuffer(e.vbo, gl.BufferTarget.array_buffer);
+      gl.bufferData(gl.BufferTarget.array_buffer, f32, &vertices, gl.BufferUsage.static_draw);
+      e.text_vbo = gl.genBuffer();
+      e.shape_vbo = gl.genBuffer();
+      e.corner_vbo = gl.genBuffer();
+      gl.bindBuffer(e.corner_vbo, gl.BufferTarget.array_buffer);
+      gl.bufferData(gl.BufferTarget.array_buffer, [2]f32, &line_corners, gl.BufferUsage.static_draw);
+      e.instancing = switch (backend) {
+        .ogl_43, .ogles_31 => true,
+        .ogl_32 => epoxy.epoxy_has_gl_extension("GL_ARB_instanced_arrays"),
+        .ogles_20 => false,
+      };
+
+      switch (backend) {
+        .ogl_32, .ogl_43 => {
+          e.vao = gl.genVertexArray();
+          gl.bindVertexArray(e.vao);
+          e.single_value_color = gl.PixelFormat.red;
+        },
+        else => {
+          e.vao = .invalid;
+          e.single_value_color = gl.PixelFormat.luminance;
+        },
+      }
+
+      e.canvas_count = 0;
+      e.blit_framebuffer = .invalid;
+      e.clip = null;
+      e.clip_stack = .{};
+      e.groups = .{};
+      e.group_base = 0;
+      e.group_bases = .{};
+      e.target_pool = .{};
+      e.text_vertices = .{};
+      e.text_page = 0;
+      e.shape_vertices = .{};
+      e.triangulations = .{};
+      e.gradient_ramps = GradientRamps.empty();
+      e.glyph_atlas = GlyphAtlas.empty();
+      e.text_layouts = LayoutCache.init();
+      e.font_count = 0;
+      e.glyph_workers = null;
+
+      const shaders = switch (backend) {
+        .ogl_32 => genShaders(.ogl_32),
+        .ogl_43 => genShaders(.ogl_43),
+        .ogles_20 => genShaders(.ogles_20),
+        .ogles_31 => genShaders(.ogles_31)
+      };
+
+      var rect_proc = try linkProgram(shaders.rect_vertex, shaders.rect_fragment);
+      errdefer gl.deleteProgram(rect_proc);
+      e.rect_proc = .{
+        .p = rect_proc,
+        .transform = try getUniformLocation(rect_proc, "u_transform"),
+        .position  = try getAttribLocation(rect_proc, "a_position"),
+        .color     = try getUniformLocation(rect_proc, "u_color"),
+      };
+
+      var img_proc = try linkProgram(shaders.img_vertex, shaders.img_fragment);
+      errdefer gl.deleteProgram(img_proc);
+      e.img_proc = .{
+        .p = img_proc,
+        .src_transform = try getUniformLocation(img_proc, "u_src_transform"),
+        .dst_transform = try getUniformLocation(img_proc, "u_dst_transform"),
+        .position = try getAttribLocation(img_proc, "a_position"),
+        .texture = try getUniformLocation(img_proc, "s_texture"),
+        .alpha = try getUniformLocation(img_proc, "u_alpha"),
+      };
+
+      var blend_proc = try linkProgram(shaders.blend_vertex, shaders.blend_fragment);
+      errdefer gl.deleteProgram(blend_proc);
+      e.blend_proc = .{
+        .p = blend_proc,
+        .posTrans = try getUniformLocation(blend_proc, "u_posTrans"),
+        .texTrans = try getUniformLocation(blend_proc, "u_texTrans"),
+        .position = try getAttribLocation(blend_proc, "a_position"),
+        .texture = try getUniformLocation(blend_proc, "s_texture"),
+        .primary = try getUniformLocation(blend_proc, "u_primary"),
+        .secondary = try getUniformLocation(blend_proc, "u_secondary"),
+      };
+
+      e.kawase_down_proc = try KawaseProc.init(shaders.img_vertex, shaders.kawase_down_fragment);
+      errdefer gl.deleteProgram(e.kawase_down_proc.p);
+      e.kawase_up_proc = try KawaseProc.init(shaders.img_vertex, shaders.kawase_up_fragment);
+      errdefer gl.deleteProgram(e.kawase_up_proc.p);
+
+      e.text_proc = try TextProc.init(shaders.text_vertex, shaders.text_fragment, false);
+      errdefer gl.deleteProgram(e.text_proc.p);
+      e.sdf_text_proc = try TextProc.init(shaders.text_vertex, shaders.sdf_text_fragment, true);
+      errdefer gl.deleteProgram(e.sdf_text_proc.p);
+      e.line_proc = try LineProc.init(shaders.line_vertex, shaders.line_fragment);
+      errdefer gl.deleteProgram(e.line_proc.p);
+      e.sdf_shape_proc = try ShapeProc.init(shaders.sdf_shape_vertex, shaders.sdf_shape_fragment);
+      errdefer gl.deleteProgram(e.sdf_shape_proc.p);
+      e.linear_gradient_proc = try GradientProc.init(shaders.linear_gradient_vertex, shaders.linear_gradient_fragment);
+      errdefer gl.deleteProgram(e.linear_gradient_proc.p);
+      e.radial_gradient_proc = try GradientProc.init(shaders.radial_gradient_vertex, shaders.radial_gradient_fragment);
+      errdefer gl.deleteProgram(e.radial_gradient_proc.p);
+      e.nine_patch_proc = try NinePatchProc.init(shaders.text_vertex, shaders.img_fragment);
+      errdefer gl.deleteProgram(e.nine_patch_proc.p);
+
+      gl.disable(gl.Capabilities.depth_test);
+      gl.depthMask(false);
+      e.max_tex_size = gl.getInteger(gl.Parameter.max_texture_size);
+      e.setWindowSize(window_width, window_height);
+
+      e.allocator = allocator;
+      e.freetype_heap.init(allocator);
+      const ft_res = ft.FT_New_Library(&e.freetype_heap.memory, &e.freetype_lib);
+      if (ft_res != 0) {
+        e.freetype_heap.deinit();
+        gl.deleteBuffer(e.vbo);
+        gl.deleteBuffer(e.text_vbo);
+        gl.deleteBuffer(e.shape_vbo);
+        gl.deleteBuffer(e.corner_vbo);
+        if (e.vao != .invalid) {
+          gl.deleteVertexArray(e.vao);
+        }
+        return freeTypeError("init", ft_res);
+      }
+      // a library created with FT_New_Library has no font drivers.
+      ft.FT_Add_Default_Modules(e.freetype_lib);
+    }
+
+    /// setWindowSize updates the window size.
+    /// The window size is the coordinate system for Rectangles and Transforms.
+    pub fn setWindowSize(e: *Self, width: u32, height: u32) void {
+      e.window = .{.width = width, .height = height};
+      if (e.canvas_count == 0) {
+        setTarget(e, 0, 0, width, height);
+      }
+    }
+
+    /// setTarget sets viewport and coordinate system to span the current
+    /// framebuffer, which has the given size. (x, y) are the coordinates
+    /// mapped to the lower left pixel of the framebuffer.
+    fn setTarget(e: *Self, x: i32, y: i32, width: u32, height: u32) void {
+      e.target_framebuffer = .{.x = x, .y = y, .width = width, .height = height};
+      e.target_stencil = null;
+      gl.viewport(0, 0, width, height);
+      e.view_transform = Transform.identity().translate(-1.0, -1.0).scale(
+        2.0 / @intToFloat(f32, width), 2.0 / @intToFloat(f32, height)
+      ).translate(@intToFloat(f32, -x), @intToFloat(f32, -y));
+      applyClip(e);
+    }
+
+    /// toPixels converts a rectangle in the current coordinate system into
+    /// pixels of the current framebuffer.
+    fn toPixels(e: *Self, r: Rectangle) Rectangle {
+      return r.move(-e.target_framebuffer.x, -e.target_framebuffer.y);
+    }
+
+    /// setClip restricts all following drawing operations to the given
+    /// rectangle, or lifts the restriction if r is null.
+    /// The clip only applies to the current framebuffer: a new Canvas starts
+    /// without clip, and the previous clip is restored when the Canvas is
+    /// finished or closed.
+    pub fn setClip(e: *Self, r: ?RectImpl) void {
+      e.clip = if (r) |v| toRect(v) else null;
+      applyClip(e);
+    }
+
+    fn applyClip(e: *Self) void {
+      if (e.clip) |clip| {
+        const r = toPixels(e, clip);
+        gl.enable(.scissor_test);
+        epoxy.glScissor(r.x, r.y, r.width, r.height);
+      } else {
+        gl.disable(.scissor_test);
+      }
+    }
+
+    /// pushClip saves the clip and the opacity groups of the current target
+    /// when a canvas is created. The canvas starts without clip and outside
+    /// of any group; popClip restores both when the canvas is finished.
+    fn pushClip(e: *Self) !void {
+      try e.group_bases.ensureUnusedCapacity(e.allocator, 1);
+      try e.clip_stack.append(e.allocator, e.clip);
+      e.group_bases.appendAssumeCapacity(e.group_base);
+      e.clip = null;
+      e.group_base = e.groups.items.len;
+      applyClip(e);
+    }
+
+    fn popClip(e: *Self) void {
+      e.clip = e.clip_stack.pop();
+      e.group_base = e.group_bases.pop();
+      applyClip(e);
+    }
+
+    /// inGroup returns true if an opacity group is active on the current
+    /// target.
+    fn inGroup(e: *Self) bool {
+      return e.groups.items.len > e.group_base;
+    }
+
+    pub fn area(e: *Self) RectImpl {
+      return RectImpl{.x = 0, .y = 0, .width = @intCast(u31, e.window.width), .height = @intCast(u31, e.window.height)};
+    }
+
+    /// clear clears the current framebuffer to be of the given color.
+    /// Its stencil buffer, if any, is reset for filling paths.
+    /// Inside an opacity group, the group's content is cleared.
+    pub fn clear(e: *Self, color: [4]u8) void {
+      if (inGroup(e)) _ = deferDraw(e, null);
       gl.clearColor(@intToFloat(f32, color[0])/255.0, @intToFloat(f32, color[1])/255.0,
           @intToFloat(f32, color[2])/255.0, @intToFloat(f32, color[3])/255.0);
-      gl.clear(.{.color = true});
+      gl.clear(.{.color = true, .stencil = true});
+    }
+
+    /// close closes the engine. It must not be used after that.
+    pub fn close(e: *Self) void {
+      e.stopGlyphWorkers();
+      for (e.target_pool.items) |*t| t.free();
+      e.target_pool.deinit(e.allocator);
+      e.clip_stack.deinit(e.allocator);
+      e.groups.deinit(e.allocator);
+      e.group_bases.deinit(e.allocator);
+      e.glyph_atlas.deinit(e.allocator);
+      e.text_layouts.deinit(e.allocator);
+      e.text_vertices.deinit(e.allocator);
+      gl.deleteBuffer(e.text_vbo);
+      e.shape_vertices.deinit(e.allocator);
+      e.clearTriangulations();
+      e.triangulations.deinit(e.allocator);
+      gl.deleteBuffer(e.shape_vbo);
+      gl.deleteBuffer(e.corner_vbo);
+      e.gradient_ramps.deinit();
+      if (e.blit_framebuffer != .invalid) {
+        e.blit_framebuffer.delete();
+      }
+      gl.deleteBuffer(e.vbo);
+      if (e.vao != .invalid) {
+        gl.deleteVertexArray(e.vao);
+      }
+      _ = ft.FT_Done_Library(e.freetype_lib);
+      e.freetype_heap.deinit();
+    }
+
+    /// fillUnit fills the unit square around (0,0) with the given color.
+    /// The square is transformed by t before it is being filled.
+    /// If copy_alpha is true, the alpha value of the color is copied into the
+    /// framebuffer; if it is false, it will cause the rectangle to blend with the
+    /// existing content according to the given alpha value.
+    ///
+    /// The target area spans from (0,0) to (window_width, window_height) if
+    /// rendering to the primary framebuffer, or from (0,0) to (c.width, c.height)
+    /// if rendering to the canvas c.
+    pub fn fillUnit(e: *Self, t: Transform, color: [4]u8, copy_alpha: bool) void {
+      if (inGroup(e) and deferDraw(e, .{.fill_unit = .{
+        .t = t, .color = color, .copy_alpha = copy_alpha,
+      }})) return;
+      const blend = !copy_alpha and color[3] != 255;
+      if (!blend and clearRect(e, t, color)) return;
+      if (blend) {
+        gl.enable(gl.Capabilities.blend);
+        gl.blendFuncSeparate(gl.BlendFactor.src_alpha, gl.BlendFactor.one_minus_src_alpha, gl.BlendFactor.one_minus_dst_alpha, gl.BlendFactor.one);
+      }
+      defer if (blend) gl.disable(gl.Capabilities.blend);
+      gl.bindBuffer(e.vbo, gl.BufferTarget.array_buffer);
+      if (e.vao != .invalid) {
+        gl.bindVertexArray(e.vao);
+      }
+      gl.useProgram(e.rect_proc.p);
+      gl.vertexAttribPointer(e.rect_proc.position, 2, gl.Type.float, false, 2*@sizeOf(f32), 0);
+      gl.enableVertexAttribArray(e.rect_proc.position);
+
+      const it = toInternalCoords(e, t, false);
+
+      setUniformColor(e.rect_proc.color, color);
+      gl.uniform2fv(e.rect_proc.transform, &it.m);
+      gl.drawArrays(gl.PrimitiveType.triangle_fan, 0, 4);
+    }
+
+    /// fillRect fills the given rectangle with the given color according to the
+    /// semantic of fillUnit.
+    pub fn fillRect(e: *Self, r: RectImpl, color: [4]u8, copy_alpha: bool) void {
+      e.fillUnit(r.transformation(), color, copy_alpha);
+    }
+
+    /// blendUnit fills the unit square around (0,0) with two colors.
+    /// The square is transformed by dst_transform before it is being filled.
+    /// The two colors are mixed via the red channel of mask by mapping
+    /// 0 to color1 and 255 to color2, the values in between doing linear blending.
+    ///
+    /// The area of the mask used for blending is the unit square around (0,0),
+    /// transformed by src_transform. The result can be larger than the mask if
+    /// the mask should be repeated.
+    pub fn blendUnit(e: *Self, mask: ImgImpl, dst_transform: Transform, src_transform: Transform, color1: [4]u8, color2: [4]u8) void {
+      if (inGroup(e) and deferDraw(e, .{.blend_unit = .{
+        .mask = toImage(mask), .dst_transform = dst_transform,
+        .src_transform = src_transform, .color1 = color1, .color2 = color2,
+      }})) return;
+      gl.bindBuffer(e.vbo, gl.BufferTarget.array_buffer);
+      if (e.vao != .invalid) {
+        gl.bindVertexArray(e.vao);
+      }
+      gl.useProgram(e.blend_proc.p);
+      gl.vertexAttribPointer(e.blend_proc.position, 2, gl.Type.float, false, 2*@sizeOf(f32), 0);
+      gl.enableVertexAttribArray(e.blend_proc.position);
+
+      gl.activeTexture(gl.TextureUnit.texture_0);
+      gl.bindTexture(mask.id, gl.TextureTarget.@"2d");
+      gl.uniform1i(e.blend_proc.texture, 0);
+
+      const ist = Transform.identity().scale(
+        1.0 / @intToFloat(f32, mask.width), -1.0 / @intToFloat(f32, mask.height)
+      ).compose(src_transform).translate(-0.5, -0.5);
+      gl.uniform2fv(e.blend_proc.texTrans, &ist.m);
+
+      const idt = toInternalCoords(e, dst_transform, false);
+      gl.uniform2fv(e.blend_proc.posTrans, &idt.m);
+
+      setUniformColor(e.blend_proc.primary, color1);
+      setUniformColor(e.blend_proc.secondary, color2);
+
+      gl.drawArrays(gl.PrimitiveType.triangle_fan, 0, 4);
+    }
+
+    /// blendRect fills the given rectangle a blend of the given colors according
+    /// to the semantics of blendUnit, with src_rect being source area of the mask,
+    /// which may be larger than the mask and will then cause to repeat it.
+    pub fn blendRect(e: *Self, mask: ImgImpl, dst_rect: RectImpl, src_rect: RectImpl, color1: [4]u8, color2: [4]u8) void {
+      blendUnit(e, mask, dst_rect.transformation(), src_rect.transformation(), color1, color2);
+    }
+
+    /// loadImage loads the image file at the given path into a texture.
+    /// on failure, the returned image will be empty.
+    pub fn loadImage(e: *Self, path: [:0]const u8) ImgImpl {
+      var x: c_int = undefined;
+      var y: c_int = undefined;
+      var n: c_int = undefined;
+      const pixels = c.stbi_load(path, &x, &y, &n, 0);
+      defer c.stbi_image_free(pixels);
+      return genTexture(e, @intCast(usize, x), @intCast(usize, y), @intCast(u8, n), false, pixels);
+    }
+
+    /// uploadImage uploads a decoded image into a texture.
+    pub fn uploadImage(e: *Self, d: DecodedImage) ImgImpl {
+      return genTexture(e, d.width, d.height, d.num_colors, false, d.pixels);
+    }
+
+    /// drawImage is the low-level version of Image.draw. The src_transform
+    /// transforms the unit square around (0,0) into the rectangle you want
+    /// to draw from (give i.area() to draw the whole image).
+    /// The dst_transform transforms the unit square around (0,0) into the
+    /// rectangle you want to draw into.
+    /// The given alpha value will applied on top of an existing alpha value if
+    /// the image has an alpha channel.
+    pub fn drawImage(e: *Self, i: ImgImpl, dst_transform: Transform, src_transform: Transform, alpha: u8) void {
+      if (inGroup(e) and deferDraw(e, .{.draw_image = .{
+        .image = toImage(i), .dst_transform = dst_transform,
+        .src_transform = src_transform, .alpha = alpha,
+      }})) return;
+      if (alpha == 255 and !i.has_alpha and copyImage(e, i, dst_transform, src_transform)) return;
+      const blend = alpha != 255 or i.has_alpha;
+      if (blend) {
+        gl.enable(gl.Capabilities.blend);
+        gl.blendFuncSeparate(gl.BlendFactor.src_alpha, gl.BlendFactor.one_minus_src_alpha, gl.BlendFactor.one_minus_dst_alpha, gl.BlendFactor.one);
+      }
+      defer if (blend) gl.disable(gl.Capabilities.blend);
+      drawTexture(e, i, dst_transform, src_transform, alpha);
+    }
+
+    /// drawTexture runs the img program for drawImage with the current
+    /// blending setup.
+    fn drawTexture(e: *Self, i: ImgImpl, dst_transform: Transform, src_transform: Transform, alpha: u8) void {
+      gl.bindBuffer(e.vbo, .array_buffer);
+      if (e.vao != .invalid) {
+        gl.bindVertexArray(e.vao);
+      }
+      gl.useProgram(e.img_proc.p);
+
+      gl.vertexAttribPointer(e.rect_proc.position, 2, gl.Type.float, false, 2*@sizeOf(f32), 0);
+      gl.enableVertexAttribArray(e.rect_proc.position);
+
+      gl.activeTexture(gl.TextureUnit.texture_0);
+      gl.bindTexture(i.id, gl.TextureTarget.@"2d");
+      gl.uniform1i(e.img_proc.texture, 0);
+      gl.uniform1f(e.img_proc.alpha, @intToFloat(f32, alpha)/255.0);
+
+      // images created from a canvas are stored bottom-up, loaded images
+      // top-down.
+      const ist = Transform.identity().scale(
+        1.0 / @intToFloat(f32, i.width),
+        (if (i.flipped) @as(f32, 1.0) else -1.0) / @intToFloat(f32, i.height)
+      ).compose(src_transform).translate(-0.5, -0.5);
+      gl.uniform2fv(e.img_proc.src_transform, &ist.m);
+
+      const idt = toInternalCoords(e, dst_transform, false);
+      gl.uniform2fv(e.img_proc.dst_transform, &idt.m);
+
+      gl.drawArrays(gl.PrimitiveType.triangle_fan, 0, 4);
+    }
+
+    /// readPixels reads back the given area of the current framebuffer into
+    /// buffer, which must be able to hold 4*width*height bytes.
+    /// Pixels are stored as RGBA with rows ordered bottom-up.
+    /// Inside an opacity group, the group's content drawn so far is read,
+    /// with colors premultiplied by alpha and before the group's alpha is
+    /// applied.
+    pub fn readPixels(e: *Self, r: RectImpl, buffer: []u8) void {
+      if (inGroup(e)) _ = deferDraw(e, null);
+      std.debug.assert(buffer.len >= 4 * @as(usize, r.width) * @as(usize, r.height));
+      const p = toPixels(e, toRect(r));
+      gl.pixelStore(.pack_alignment, 1);
+      epoxy.glReadPixels(p.x, p.y, p.width, p.height,
+          epoxy.GL_RGBA, epoxy.GL_UNSIGNED_BYTE, buffer.ptr);
+    }
+
+    /// clearRect fills the unit square transformed by t by clearing it with
+    /// the scissor test if the result is a pixel-aligned rectangle, which is
+    /// much cheaper than running the rect program, especially on tiled GPUs.
+    /// Returns false if that's not the case.
+    fn clearRect(e: *Self, t: Transform, color: [4]u8) bool {
+      var r = alignedRect(t) orelse return false;
+      if (e.clip) |clip| {
+        r = r.intersect(clip) orelse return true;
+      }
+      const p = toPixels(e, r);
+      gl.enable(.scissor_test);
+      epoxy.glScissor(p.x, p.y, p.width, p.height);
+      clear(e, color);
+      applyClip(e);
+      return true;
+    }
+
+    /// copyImage copies pixels of i directly into the current framebuffer if
+    /// the transformations describe an unscaled copy between pixel-aligned
+    /// areas. Returns false if that's not the case, so that the image must be
+    /// drawn with the img program.
+    fn copyImage(e: *Self, i: ImgImpl, dst_transform: Transform, src_transform: Transform) bool {
+      const src = alignedRect(src_transform) orelse return false;
+      const dst = toPixels(e, alignedRect(dst_transform) orelse return false);
+      if (src.width != dst.width or src.height != dst.height or src.x < 0 or src.y < 0 or
+          @as(i64, src.x) + src.width > i.width or @as(i64, src.y) + src.height > i.height) return false;
+      const height = @intCast(i32, i.height);
+
+      const current = @intCast(c_uint, gl.getInteger(.draw_framebuffer_binding));
+      if (e.blit_framebuffer == .invalid) e.blit_framebuffer = gl.Framebuffer.gen();
+      switch (e.backend) {
+        .ogl_32, .ogl_43, .ogles_31 => {
+          // blitting into a multisampled framebuffer is an error.
+          var sample_buffers: c_int = 0;
+          epoxy.glGetIntegerv(epoxy.GL_SAMPLE_BUFFERS, &sample_buffers);
+          if (sample_buffers != 0) return false;
+          // blitting mirrors top-down images by swapping the source rows.
+          const y0 = if (i.flipped) src.y else height - src.y;
+          const y1 = if (i.flipped) src.y + src.height else height - src.y - src.height;
+          epoxy.glBindFramebuffer(epoxy.GL_READ_FRAMEBUFFER, @enumToInt(e.blit_framebuffer));
+          epoxy.glFramebufferTexture2D(epoxy.GL_READ_FRAMEBUFFER, epoxy.GL_COLOR_ATTACHMENT0,
+              epoxy.GL_TEXTURE_2D, @enumToInt(i.id), 0);
+          defer epoxy.glBindFramebuffer(epoxy.GL_READ_FRAMEBUFFER, current);
+          if (epoxy.glCheckFramebufferStatus(epoxy.GL_READ_FRAMEBUFFER) != epoxy.GL_FRAMEBUFFER_COMPLETE) return false;
+          epoxy.glBlitFramebuffer(src.x, y0, src.x + src.width, y1,
+              dst.x, dst.y, dst.x + dst.width, dst.y + dst.height,
+              epoxy.GL_COLOR_BUFFER_BIT, epoxy.GL_NEAREST);
+          return true;
+        },
+        .ogles_20 => {
+          // glCopyTexSubImage2D can only copy into a texture, which is
+          // available when drawing onto a canvas. It ignores the clip and
+          // cannot mirror rows.
+          if (!i.flipped or e.clip != null or e.canvas_count == 0 or dst.x < 0 or dst.y < 0 or
+              @as(i64, dst.x) + dst.width > e.target_framebuffer.width or
+              @as(i64, dst.y) + dst.height > e.target_framebuffer.height) return false;
+          var dst_texture: c_int = 0;
+          epoxy.glGetFramebufferAttachmentParameteriv(epoxy.GL_FRAMEBUFFER, epoxy.GL_COLOR_ATTACHMENT0,
+              epoxy.GL_FRAMEBUFFER_ATTACHMENT_OBJECT_NAME, &dst_texture);
+          if (dst_texture <= 0 or @intCast(c_uint, dst_texture) == @enumToInt(i.id)) return false;
+          // the formats of source and destination must match, e.g. RGB
+          // cannot be copied into RGBA.
+          var alpha_bits: c_int = 0;
+          epoxy.glGetIntegerv(epoxy.GL_ALPHA_BITS, &alpha_bits);
+          if ((alpha_bits > 0) != i.has_alpha) return false;
+          e.blit_framebuffer.bind(.buffer);
+          defer epoxy.glBindFramebuffer(epoxy.GL_FRAMEBUFFER, current);
+          epoxy.glFramebufferTexture2D(epoxy.GL_FRAMEBUFFER, epoxy.GL_COLOR_ATTACHMENT0,
+              epoxy.GL_TEXTURE_2D, @enumToInt(i.id), 0);
+          if (epoxy.glCheckFramebufferStatus(epoxy.GL_FRAMEBUFFER) != epoxy.GL_FRAMEBUFFER_COMPLETE) return false;
+          epoxy.glBindTexture(epoxy.GL_TEXTURE_2D, @intCast(c_uint, dst_texture));
+          epoxy.glCopyTexSubImage2D(epoxy.GL_TEXTURE_2D, 0, dst.x, dst.y, src.x, src.y, src.width, src.height);
+          return true;
+        },
+      }
+    }
+
+    /// pushOpacityGroup starts a group of drawing operations that will be
+    /// composited with the given alpha value, as if they were drawn onto a
+    /// separate canvas which is then drawn with alpha. Drawing is restricted
+    /// to bounds, which should enclose all drawing operations of the group.
+    ///
+    /// The group is rendered into a pooled render target of the size of bounds.
+    /// If the group contains only a single fill or image draw, the offscreen
+    /// pass is skipped and the draw is done directly with modulated alpha.
+    ///
+    /// Groups may be nested. Each group must be ended with popOpacityGroup
+    /// while the same canvas is active. Canvases created inside a group start
+    /// outside of it; drawing their image afterwards is part of the group.
+    ///
+    /// The first draw of a group may be kept pending until popOpacityGroup,
+    /// so an image drawn inside a group must not be freed before the group
+    /// has been popped.
+    pub fn pushOpacityGroup(e: *Self, alpha: u8, bounds: RectImpl) !void {
+      try e.groups.append(e.allocator, .{
+        .alpha = alpha, .bounds = toRect(bounds), .pending = null,
+        .direct = false, .target = null, .canvas = undefined,
+      });
+    }
+
+    /// popOpacityGroup ends the group started by the last call to
+    /// pushOpacityGroup and composites it.
+    pub fn popOpacityGroup(e: *Self) void {
+      var g = e.groups.pop();
+      if (g.target) |target| {
+        _ = g.canvas.finish() catch unreachable;
+        defer e.releaseTarget(target);
+        // the target must not become the pending draw of an enclosing
+        // group, it is released right away.
+        if (inGroup(e)) _ = deferDraw(e, null);
+        // the target has been drawn with blending onto transparent black and
+        // thus holds colors premultiplied by alpha. Only the group's alpha is
+        // applied to them, as constant blend factor.
+        const a = @intToFloat(f32, g.alpha) / 255.0;
+        epoxy.glBlendColor(0, 0, 0, a);
+        gl.enable(gl.Capabilities.blend);
+        defer gl.disable(gl.Capabilities.blend);
+        epoxy.glBlendFuncSeparate(epoxy.GL_CONSTANT_ALPHA, epoxy.GL_ONE_MINUS_SRC_ALPHA,
+            epoxy.GL_ONE_MINUS_DST_ALPHA, epoxy.GL_ONE);
+        drawTexture(e, fromImage(target.image), g.bounds.transformation(), target.image.area().transformation(), g.alpha);
+      } else if (g.pending) |pending| {
+        const prev_clip = e.clip;
+        setClipRect(e, if (prev_clip) |clip| clip.intersect(g.bounds) orelse return else g.bounds);
+        defer setClipRect(e, prev_clip);
+        var cmd = pending;
+        switch (cmd) {
+          .fill_unit => |*v| {
+            v.color[3] = @intCast(u8, @as(u16, v.color[3]) * g.alpha / 255);
+            v.copy_alpha = false;
+          },
+          .draw_image => |*v| {
+            v.alpha = @intCast(u8, @as(u16, v.alpha) * g.alpha / 255);
+          },
+          .blend_unit => unreachable,
+        }
+        cmd.execute(e);
+      }
+    }
+
+    /// deferDraw handles a drawing operation issued while an opacity group is
+    /// active. The first operation of a group is kept pending. Returns true if
+    /// the operation has been deferred, false if it must be drawn now.
+    /// cmd is null for operations that cannot be recorded, e.g. drawText;
+    /// those always go offscreen.
+    fn deferDraw(e: *Self, cmd: ?DrawCommand) bool {
+      const g = &e.groups.items[e.groups.items.len - 1];
+      if (g.target != null or g.direct) return false;
+      if (cmd) |v| {
+        if (g.pending == null and v != .blend_unit) {
+          g.pending = v;
+          return true;
+        }
+      }
+      // more than a single draw, go offscreen.
+      const target = e.acquireTarget(g.bounds.width, g.bounds.height, true) catch {
+        drawGroupDirectly(e, g);
+        return false;
+      };
+      g.canvas = Canvas.createOn(e, target.framebuffer, target.image) catch {
+        e.releaseTarget(target);
+        drawGroupDirectly(e, g);
+        return false;
+      };
+      g.target = target;
+      setTarget(e, g.bounds.x, g.bounds.y, g.bounds.width, g.bounds.height);
+      clear(e, [_]u8{0, 0, 0, 0});
+      if (g.pending) |p| p.execute(e);
+      g.pending = null;
+      return false;
+    }
+
+    /// drawGroupDirectly is the fallback if no offscreen target is available
+    /// for the given group: its content is drawn without group opacity.
+    fn drawGroupDirectly(e: *Self, g: *OpacityGroup) void {
+      std.log.scoped(.zargo).err("unable to create target for opacity group, drawing without it", .{});
+      g.direct = true;
+      const pending = g.pending;
+      g.pending = null;
+      if (pending) |p| p.execute(e);
+    }
+
+    fn setClipRect(e: *Self, r: ?Rectangle) void {
+      e.clip = r;
+      applyClip(e);
+    }
+
+    fn toImage(i: ImgImpl) Image {
+      return if (ImgImpl == Image) i else Image{
+        .id = i.id, .width = @intCast(u31, i.width), .height = @intCast(u31, i.height),
+        .flipped = i.flipped, .has_alpha = i.has_alpha,
+      };
+    }
+
+    fn fromImage(i: Image) ImgImpl {
+      return if (ImgImpl == Image) i else ImgImpl{
+        .id = i.id, .width = i.width, .height = i.height,
+        .flipped = i.flipped, .has_alpha = i.has_alpha,
+      };
+    }
+
+    fn toRect(r: RectImpl) Rectangle {
+      return if (RectImpl == Rectangle) r else Rectangle.from(r);
+    }
+
+    fn toInternalCoords(e: *Self, t: Transform, flip: bool) Transform {
+      var r = e.view_transform.compose(t);
+      if (flip) {
+        r = r.scale(1.0, -1.0);
+      }
+      return r.translate(-0.5, -0.5);
+    }
+
+    fn genTexture(e: *Self, width: usize, height: usize, num_colors: u8, flipped: bool, pixels: ?[*]const u8) ImgImpl {
+      const ret = gl.genTexture();
+      gl.bindTexture(ret, .@"2d");
+      gl.texParameter(.@"2d", .mag_filter, .linear);
+      gl.texParameter(.@"2d", .min_filter, .linear);
+      gl.texParameter(.@"2d", .wrap_s, .repeat);
+      gl.texParameter(.@"2d", .wrap_t, .repeat);
+      gl.pixelStore(.unpack_alignment, @intCast(usize, num_colors));
+      const gl_format = switch (num_colors) {
+        1    => e.single_value_color,
+        2, 3 => .rgb,
+        4    => .rgba,
+        else => unreachable
+      };
+      gl.textureImage2D(.@"2d", 0, gl_format, width, height, gl_format, gl.PixelType.unsigned_byte, pixels);
+      return ImgImpl{
+        .id = ret,
+        .width = @intCast(len_type, width),
+        .height = @intCast(len_type, height),
+        .flipped = flipped,
+        .has_alpha = num_colors == 4,
+      };
+    }
+
+    /// attachStencil creates a stencil buffer of the given size for filling
+    /// paths, attaches it to the current framebuffer and returns it.
+    /// A packed depth-stencil buffer is used where available since it is the
+    /// most widely supported format; OpenGL ES 2.0 only guarantees a plain
+    /// 8-bit stencil buffer.
+    fn attachStencil(e: *Self, width: u32, height: u32) c_uint {
+      var ret: c_uint = undefined;
+      epoxy.glGenRenderbuffers(1, &ret);
+      epoxy.glBindRenderbuffer(epoxy.GL_RENDERBUFFER, ret);
+      defer epoxy.glBindRenderbuffer(epoxy.GL_RENDERBUFFER, 0);
+      const w = @intCast(c_int, width);
+      const h = @intCast(c_int, height);
+      if (e.backend == .ogles_20) {
+        epoxy.glRenderbufferStorage(epoxy.GL_RENDERBUFFER, epoxy.GL_STENCIL_INDEX8, w, h);
+        epoxy.glFramebufferRenderbuffer(epoxy.GL_FRAMEBUFFER, epoxy.GL_STENCIL_ATTACHMENT, epoxy.GL_RENDERBUFFER, ret);
+      } else {
+        epoxy.glRenderbufferStorage(epoxy.GL_RENDERBUFFER, epoxy.GL_DEPTH24_STENCIL8, w, h);
+        epoxy.glFramebufferRenderbuffer(epoxy.GL_FRAMEBUFFER, epoxy.GL_DEPTH_STENCIL_ATTACHMENT, epoxy.GL_RENDERBUFFER, ret);
+      }
+      return ret;
+    }
+  };
+}
+
+/// The Engine is the core of the API.
+/// You need to initialize an Engine with init() before doing any drawing.
+///
+/// Giving debug=true will enable debug output, you should have created a
+/// debugging context for that. Non-debugging contexts are allowed not to
+/// provide any debugging output.
+///
+/// Applications drawing text must call endFrame after each frame. Otherwise,
+/// the glyph atlas cannot tell recently used glyphs from stale ones and, once
+/// full, evicts glyphs that are still on screen.
+pub const Engine = struct {
+  backend: Backend,
+  rect_proc: struct {
+    p: gl.Program,
+    transform: u32,
+    position: u32,
+    color: u32,
+  },
+  img_proc: struct {
+    p: gl.Program,
+    src_transform: u32,
+    dst_transform: u32,
+    position: u32,
+    texture: u32,
+    alpha: u32,
+  },
+  blend_proc: struct {
+    p: gl.Program,
+    posTrans: u32,
+    texTrans: u32,
+    position: u32,
+    texture: u32,
+    primary: u32,
+    secondary: u32,
+  },
+  kawase_down_proc: KawaseProc,
+  kawase_up_proc: KawaseProc,
+  text_proc: TextProc,
+  sdf_text_proc: TextProc,
+  line_proc: LineProc,
+  sdf_shape_proc: ShapeProc,
+  linear_gradient_proc: GradientProc,
+  radial_gradient_proc: GradientProc,
+  nine_patch_proc: NinePatchProc,
+  window: struct {
+    width: u32, height: u32,
+  },
+  target_framebuffer: struct {
+    x: i32, y: i32, width: u32, height: u32,
+  },
+  /// whether the current framebuffer has a stencil buffer, queried on first
+  /// use by fillPath.
+  target_stencil: ?bool,
+  view_transform: Transform,
+  vao: gl.VertexArray,
+  vbo: gl.Buffer,
+  canvas_count: u8,
+  /// read framebuffer for copying images, created on first use.
+  blit_framebuffer: gl.Framebuffer,
+  clip: ?Rectangle,
+  clip_stack: std.ArrayListUnmanaged(?Rectangle),
+  groups: std.ArrayListUnmanaged(OpacityGroup),
+  /// number of groups that belong to enclosing canvases; only the groups
+  /// above it are active on the current target.
+  group_base: usize,
+  group_bases: std.ArrayListUnmanaged(usize),
+  target_pool: std.ArrayListUnmanaged(RenderTarget),
+  max_tex_size: i32,
+  single_value_color: gl.PixelFormat,
+  freetype_heap: FreeTypeHeap,
+  freetype_lib: ft.FT_Library,
+  /// glyph atlas, created on first use of drawText.
+  glyph_atlas: GlyphAtlas,
+  text_layouts: LayoutCache,
+  /// streamed vertices of the text currently being drawn.
+  text_vbo: gl.Buffer,
+  text_vertices: std.ArrayListUnmanaged(f32),
+  /// atlas page of the glyphs in text_vertices.
+  text_page: u8,
+  /// streamed vertices of the shapes currently being drawn.
+  shape_vbo: gl.Buffer,
+  shape_vertices: std.ArrayListUnmanaged(f32),
+  /// triangulations of recently filled polygons, keyed by the hash of their
+  /// corners, which are compared on lookup.
+  triangulations: std.AutoHashMapUnmanaged(u64, Triangulation),
+  /// color ramps of the gradients drawn recently.
+  gradient_ramps: GradientRamps,
+  /// line_corners, used by all instances when drawing lines and shapes.
+  corner_vbo: gl.Buffer,
+  /// whether lines and shapes are drawn with instancing. Without it, they are
+  /// expanded into triangles on the CPU.
+  instancing: bool,
+  /// number of fonts loaded so far, used to give each font a unique id.
+  font_count: u32,
+  glyph_workers: ?*GlyphWorkers,
+  allocator: std.mem.Allocator,
+
+  const Impl = EngineImpl(@This(), Rectangle, Image);
+
+  usingnamespace Impl;
+
+  pub const createCanvas = Canvas.create;
+
+  /// acquireTarget returns a render target with the given size from the pool,
+  /// creating a new one if none is available. The content of the returned
+  /// target is undefined.
+  /// Give the target back with releaseTarget when it is not needed anymore.
+  pub fn acquireTarget(e: *Engine, width: u31, height: u31, with_alpha: bool) !RenderTarget {
+    for (e.target_pool.items) |t, index| {
+      if (t.image.width == width and t.image.height == height and t.image.has_alpha == with_alpha) {
+        return e.target_pool.orderedRemove(index);
+      }
     }
+    const previous = @intToEnum(gl.Framebuffer, @intCast(std.meta.Tag(gl.Framebuffer), gl.getInteger(.draw_framebuffer_binding)));
+    defer previous.bind(.buffer);
+    var ret = RenderTarget{
+      .framebuffer = gl.Framebuffer.gen(),
+      .stencil_buffer = undefined,
+      .image = Impl.genTexture(e, width, height, if (with_alpha) 4 else 3, true, null),
+    };
+    ret.framebuffer.texture2D(.buffer, .color0, .@"2d", ret.image.id, 0);
+    ret.stencil_buffer = Impl.attachStencil(e, width, height);
+    if (e.backend == .ogl_32 or e.backend == .ogl_43) {
+      gl.drawBuffers(&[_]gl.FramebufferAttachment{.color0});
+    }
+    if (gl.Framebuffer.checkStatus(.buffer) != .complete) {
+      ret.free();
+      return EngineError.IncompleteFramebuffer;
+    }
+    // fillPath expects a zeroed stencil buffer.
+    gl.clear(.{.stencil = true});
+    return ret;
+  }
 
-    /// close closes the engine. It must not be used after that.
-    pub fn close(e: *Self) void {
-      gl.deleteBuffer(e.vbo);
-      if (e.vao != .invalid) {
-        gl.deleteVertexArray(e.vao);
+  /// releaseTarget gives a render target back to the pool.
+  /// The least recently released targets are freed if the pool grows too
+  /// large.
+  pub fn releaseTarget(e: *Engine, t: RenderTarget) void {
+    e.target_pool.append(e.allocator, t) catch {
+      var v = t;
+      v.free();
+      return;
+    };
+    if (e.target_pool.items.len > max_pooled_targets) {
+      var oldest = e.target_pool.orderedRemove(0);
+      oldest.free();
+    }
+  }
+
+  /// blur returns a blurred copy of the area src_area of src, using the dual
+  /// filter Kawase blur: the image is downsampled iterations times to half its
+  /// resolution, then upsampled back, each pass sampling a few neighboring
+  /// pixels at distance offset (in pixels of the pass' target; 1.0 is a
+  /// reasonable default). The blur radius roughly doubles with each iteration
+  /// while the work needed shrinks with the size of each level, making wide
+  /// blurs much cheaper than a gaussian blur.
+  ///
+  /// All intermediate images are pooled render targets. The result is a render
+  /// target of the size of src_area which must be given back to the engine
+  /// with releaseTarget.
+  ///
+  /// Returns EngineError.InvalidIterations unless
+  /// 0 < iterations <= max_blur_iterations.
+  pub fn blur(e: *Engine, src: Image, src_area: Rectangle, iterations: u4, offset: f32) !RenderTarget {
+    if (iterations == 0 or iterations > max_blur_iterations) return EngineError.InvalidIterations;
+    var levels: [max_blur_iterations + 1]RenderTarget = undefined;
+    var num_levels: usize = 0;
+    errdefer {
+      for (levels[0..num_levels]) |t| e.releaseTarget(t);
+    }
+
+    levels[0] = try e.acquireTarget(src_area.width, src_area.height, src.has_alpha);
+    num_levels = 1;
+    var i: usize = 1;
+    while (i <= iterations) : (i += 1) {
+      const prev = levels[i - 1].image;
+      levels[i] = try e.acquireTarget(std.math.max(prev.width / 2, 1), std.math.max(prev.height / 2, 1), src.has_alpha);
+      num_levels += 1;
+    }
+
+    // the first downsampling pass reads directly from the source. Loaded
+    // images are stored top-down, so their y axis is mapped to 1 - y/h, which
+    // keeps coordinates inside the texture as required by clamping.
+    const src_transform = Transform.identity().translate(
+      0.0, if (src.flipped) @as(f32, 0.0) else 1.0
+    ).scale(
+      1.0 / @intToFloat(f32, src.width),
+      (if (src.flipped) @as(f32, 1.0) else -1.0) / @intToFloat(f32, src.height)
+    ).compose(src_area.transformation()).translate(-0.5, -0.5);
+    try e.kawase_down_proc.pass(e, src, src_transform, levels[1], offset);
+    i = 2;
+    while (i <= iterations) : (i += 1) {
+      try e.kawase_down_proc.pass(e, levels[i - 1].image, Transform.identity(), levels[i], offset);
+    }
+    i = iterations;
+    while (i > 0) : (i -= 1) {
+      try e.kawase_up_proc.pass(e, levels[i].image, Transform.identity(), levels[i - 1], offset);
+    }
+    for (levels[1..num_levels]) |t| e.releaseTarget(t);
+    return levels[0];
+  }
+
+  /// blurBehind blurs the given area of the current framebuffer in place, e.g.
+  /// to draw a translucent panel on top of it. See blur for the parameters.
+  pub fn blurBehind(e: *Engine, area: Rectangle, iterations: u4, offset: f32) !void {
+    const captured = try e.acquireTarget(area.width, area.height, false);
+    defer e.releaseTarget(captured);
+    const p = Impl.toPixels(e, area);
+    gl.bindTexture(captured.image.id, .@"2d");
+    epoxy.glCopyTexSubImage2D(epoxy.GL_TEXTURE_2D, 0, 0, 0, p.x, p.y, p.width, p.height);
+    const blurred = try e.blur(captured.image, captured.image.area(), iterations, offset);
+    defer e.releaseTarget(blurred);
+    blurred.image.drawAll(e, area, 255);
+  }
+
+  /// loadFont loads the font file at the given path with FreeType.
+  /// If the file contains multiple faces, the first one is used.
+  ///
+  /// The file is memory-mapped rather than read (except on Windows) and must
+  /// not be modified while the font is in use.
+  pub fn loadFont(e: *Engine, path: [:0]const u8) !Font {
+    const data = FontData.load(e.allocator, path) catch |err| {
+      std.log.scoped(.zargo).err("unable to read font file {s}: {s}", .{path, @errorName(err)});
+      return err;
+    };
+    errdefer data.free(e.allocator);
+    var face: ft.FT_Face = undefined;
+    const res = ft.FT_New_Memory_Face(e.freetype_lib, data.bytes.ptr, @intCast(ft.FT_Long, data.bytes.len), 0, &face);
+    if (res != 0) return freeTypeError("font loading", res);
+    e.font_count += 1;
+    return Font{
+      .e = e, .face = face, .mutex = .{}, .metric_cache = .{}, .data = data,
+      .id = e.font_count, .size = 0, .mode = .bitmap,
+    };
+  }
+
+  /// startGlyphWorkers starts num_workers threads which rasterize glyphs in
+  /// parallel when drawText finds many of them missing from the glyph atlas,
+  /// e.g. when a screen of CJK text first appears. Each worker opens its own
+  /// face of the fonts it rasterizes glyphs of.
+  ///
+  /// The engine's allocator is used from the worker threads and must be
+  /// thread-safe. The workers are stopped by close.
+  pub fn startGlyphWorkers(e: *Engine, num_workers: usize) !void {
+    e.stopGlyphWorkers();
+    const pool = try e.allocator.create(GlyphWorkers);
+    errdefer e.allocator.destroy(pool);
+    try pool.init(e.allocator, num_workers);
+    e.glyph_workers = pool;
+  }
+
+  /// freeTypeStats returns statistics about the memory FreeType uses for the
+  /// engine's fonts, including that used by glyph workers.
+  pub fn freeTypeStats(e: *Engine) FreeTypeStats {
+    var ret = e.freetype_heap.readStats();
+    if (e.glyph_workers) |pool| {
+      for (pool.workers) |*w| ret.add(w.heap.readStats());
+    }
+    return ret;
+  }
+
+  /// endFrame marks the end of a frame. The glyph atlas uses frames to tell
+  /// which glyphs are still in use when it runs out of space: repacking a
+  /// page keeps the glyphs used within the last warm_glyph_frames frames.
+  /// Must be called once per frame when drawing text.
+  pub fn endFrame(e: *Engine) void {
+    e.glyph_atlas.frame +%= 1;
+  }
+
+  /// stopGlyphWorkers stops the glyph workers, if any. Glyphs are then
+  /// rasterized on the calling thread again.
+  pub fn stopGlyphWorkers(e: *Engine) void {
+    if (e.glyph_workers) |pool| {
+      pool.deinit();
+      e.allocator.destroy(pool);
+      e.glyph_workers = null;
+    }
+  }
+
+  /// drawText draws the given UTF-8 encoded text in a single line with the
+  /// given font, size (in pixels) and color. (x, y) is the start of the
+  /// baseline in the current coordinate system.
+  ///
+  /// Glyphs are rasterized into the engine's glyph atlas the first time they
+  /// are used, on the glyph workers if they have been started. Bitmap glyphs
+  /// are positioned at quarter pixels horizontally, using one variant of the
+  /// glyph per position. The text is then drawn as one batch of quads with a
+  /// single draw call. The layout of the text is cached, so drawing the same
+  /// text again doesn't need to query FreeType.
+  pub fn drawText(e: *Engine, font: *Font, text: []const u8, x: f32, y: f32, size: u16, color: [4]u8) void {
+    if (Impl.inGroup(e)) _ = Impl.deferDraw(e, null);
+    const layout = e.layoutText(font, text, size) orelse return;
+    if (e.glyph_atlas.page_count == 0 and !e.glyph_atlas.addPage(e, null)) {
+      std.log.scoped(.zargo).err("drawText: unable to create glyph atlas", .{});
+      return;
+    }
+    if (e.glyph_workers) |pool| pool.rasterize(e, font, layout, x, size);
+    const sdf = font.mode == .sdf;
+    // scale from glyph metrics to the requested size.
+    const scale: f32 = if (sdf) @intToFloat(f32, size) / sdf_glyph_size else 1.0;
+    // bitmap glyphs are only crisp when drawn at whole pixels vertically.
+    const baseline = if (sdf) y else @round(y);
+    const tex_scale = 1.0 / @intToFloat(f32, e.glyph_atlas.pages[0].image.width);
+
+    for (layout.glyphs) |item| {
+      const pen = if (sdf) SubpixelPosition{.origin = x + item.x, .phase = 0}
+          else subpixelPosition(x + item.x);
+      const g = font.glyph(item.index, size, pen.phase) catch blk: {
+        // the atlas is full. draw what we have so far since glyphs may move,
+        // then make room. The second attempt clears a page, which always
+        // makes room for a glyph.
+        flushText(e, color, if (sdf) scale else null);
+        var attempt: usize = 0;
+        while (attempt < 2) : (attempt += 1) {
+          e.glyph_atlas.makeRoom(e, attempt > 0);
+          break :blk font.glyph(item.index, size, pen.phase) catch continue;
+        }
+        break :blk null;
+      } orelse continue;
+      if (g.width == 0) continue;
+      if (g.page != e.text_page) {
+        flushText(e, color, if (sdf) scale else null);
+        e.text_page = g.page;
       }
-      _ = ft.FT_Done_Library(e.freetype_lib);
+
+      const x0 = pen.origin + @intToFloat(f32, g.left) * scale;
+      const y0 = baseline + @intToFloat(f32, g.top) * scale;
+      const x1 = x0 + @intToFloat(f32, g.width) * scale;
+      const y1 = y0 - @intToFloat(f32, g.height) * scale;
+      const s0 = @intToFloat(f32, g.x) * tex_scale;
+      const t0 = @intToFloat(f32, g.y) * tex_scale;
+      const s1 = @intToFloat(f32, g.x + g.width) * tex_scale;
+      const t1 = @intToFloat(f32, g.y + g.height) * tex_scale;
+      e.text_vertices.appendSlice(e.allocator, &[_]f32{
+        x0, y0, s0, t0, x1, y0, s1, t0, x1, y1, s1, t1,
+        x0, y0, s0, t0, x1, y1, s1, t1, x0, y1, s0, t1,
+      }) catch {
+        std.log.scoped(.zargo).err("drawText: out of memory", .{});
+        break;
+      };
     }
+    flushText(e, color, if (sdf) scale else null);
+  }
 
-    /// fillUnit fills the unit square around (0,0) with the given color.
-    /// The square is transformed by t before it is being filled.
-    /// If copy_alpha is true, the alpha value of the color is copied into the
-    /// framebuffer; if it is false, it will cause the rectangle to blend with the
-    /// existing content according to the given alpha value.
-    ///
-    /// The target area spans from (0,0) to (window_width, window_height) if
-    /// rendering to the primary framebuffer, or from (0,0) to (c.width, c.height)
-    /// if rendering to the canvas c.
-    pub fn fillUnit(e: *Self, t: Transform, color: [4]u8, copy_alpha: bool) void {
-      if (!copy_alpha and color[3] != 255) {
-        gl.enable(gl.Capabilities.blend);
-        gl.blendFuncSeparate(gl.BlendFactor.src_alpha, gl.BlendFactor.one_minus_src_alpha, gl.BlendFactor.one_minus_dst_alpha, gl.BlendFactor.one);
-        defer gl.disable(gl.Capabilities.blend);
+  /// textBounds returns the bounding box of the given text as drawn by
+  /// drawText, relative to the start of the baseline.
+  /// Returns an empty rectangle at (0,0) if the text cannot be laid out.
+  pub fn textBounds(e: *Engine, font: *Font, text: []const u8, size: u16) Rectangle {
+    const layout = e.layoutText(font, text, size) orelse
+        return Rectangle{.x = 0, .y = 0, .width = 0, .height = 0};
+    return layout.bounds;
+  }
+
+  /// layoutText returns the layout of the given text from the layout cache,
+  /// shaping the text if it isn't cached yet. The returned layout is valid
+  /// until the next layout is added to the cache.
+  /// Returns null and logs an error on failure.
+  fn layoutText(e: *Engine, font: *Font, text: []const u8, size: u16) ?*const TextLayout {
+    const key = LayoutKey{.font = font.id, .size = size, .mode = font.mode, .text = text};
+    if (e.text_layouts.get(key)) |layout| return layout;
+
+    const view = std.unicode.Utf8View.init(text) catch {
+      std.log.scoped(.zargo).err("text is not valid UTF-8", .{});
+      return null;
+    };
+    font.mutex.lock();
+    defer font.mutex.unlock();
+    var shaper = Shaper.init(font, view, size) orelse return null;
+    var glyphs = std.ArrayListUnmanaged(TextLayout.Item){};
+    while (shaper.next()) |g| {
+      glyphs.append(e.allocator, .{.index = g.index, .x = g.x}) catch {
+        glyphs.deinit(e.allocator);
+        std.log.scoped(.zargo).err("text layout: out of memory", .{});
+        return null;
+      };
+    }
+    const owned = glyphs.toOwnedSlice(e.allocator);
+    return e.text_layouts.put(e.allocator, key, .{
+      .glyphs = owned, .advance = shaper.pen, .bounds = shaper.bounds(),
+    }) catch {
+      e.allocator.free(owned);
+      std.log.scoped(.zargo).err("text layout: out of memory", .{});
+      return null;
+    };
+  }
+
+  /// flushText draws the glyph quads collected in text_vertices.
+  /// sdf_scale is the factor by which SDF glyphs are scaled, or null for
+  /// bitmap glyphs.
+  fn flushText(e: *Engine, color: [4]u8, sdf_scale: ?f32) void {
+    // areas evicted until now are only overwritten after the draw call below.
+    e.glyph_atlas.releaseEvicted(e.allocator);
+    if (e.text_vertices.items.len == 0) return;
+    defer e.text_vertices.clearRetainingCapacity();
+    gl.enable(gl.Capabilities.blend);
+    gl.blendFuncSeparate(gl.BlendFactor.src_alpha, gl.BlendFactor.one_minus_src_alpha, gl.BlendFactor.one_minus_dst_alpha, gl.BlendFactor.one);
+    defer gl.disable(gl.Capabilities.blend);
+
+    const proc = if (sdf_scale != null) &e.sdf_text_proc else &e.text_proc;
+    gl.bindBuffer(e.text_vbo, .array_buffer);
+    gl.bufferData(.array_buffer, f32, e.text_vertices.items, .stream_draw);
+    if (e.vao != .invalid) {
+      gl.bindVertexArray(e.vao);
+    }
+    gl.useProgram(proc.p);
+    gl.vertexAttribPointer(proc.position, 2, gl.Type.float, false, 4*@sizeOf(f32), 0);
+    gl.enableVertexAttribArray(proc.position);
+    gl.vertexAttribPointer(proc.tex_coord, 2, gl.Type.float, false, 4*@sizeOf(f32), 2*@sizeOf(f32));
+    gl.enableVertexAttribArray(proc.tex_coord);
+    defer gl.disableVertexAttribArray(proc.tex_coord);
+
+    gl.activeTexture(gl.TextureUnit.texture_0);
+    gl.bindTexture(e.glyph_atlas.pages[e.text_page].image.id, gl.TextureTarget.@"2d");
+    gl.uniform1i(proc.texture, 0);
+    setUniformColor(proc.color, color);
+    gl.uniform2fv(proc.transform, &e.view_transform.m);
+    if (sdf_scale) |s| {
+      // the edge is anti-aliased over one target pixel, which is 1/s pixels
+      // in the distance field, where 2*sdf_spread pixels span the value range.
+      gl.uniform1f(proc.smoothing, std.math.min(0.5, 0.5 / (s * 2.0 * sdf_spread)));
+    }
+
+    gl.drawArrays(gl.PrimitiveType.triangles, 0, e.text_vertices.items.len / 4);
+  }
+
+  /// fillPolygon fills the polygon with the given corners with the given
+  /// color, see fillPolygons.
+  pub fn fillPolygon(e: *Engine, points: []const [2]f32, color: [4]u8) void {
+    e.fillPolygons(&[_]Polygon{.{.points = points.ptr, .count = points.len, .color = color}});
+  }
+
+  /// fillPolygons fills the given polygons, blending them with the existing
+  /// content according to their colors' alpha value. Polygons are
+  /// triangulated on the CPU, and the triangulations of recently drawn
+  /// polygons are kept, so static shapes are only triangulated once.
+  /// Consecutive polygons of the same color are drawn with a single draw call.
+  ///
+  /// Self-intersecting polygons cannot be triangulated; they are filled with
+  /// stencil-then-cover like fillPath with the non-zero rule instead, which
+  /// needs a stencil buffer in the current framebuffer.
+  pub fn fillPolygons(e: *Engine, polygons: []const Polygon) void {
+    if (Impl.inGroup(e)) _ = Impl.deferDraw(e, null);
+    for (polygons) |p, i| {
+      if (i > 0 and !std.mem.eql(u8, &p.color, &polygons[i - 1].color)) e.flushShapes(e.view_transform, polygons[i - 1].color);
+      const points = p.slice();
+      const indices = e.triangulation(points) orelse continue;
+      if (indices.len == 0 and points.len >= 3) {
+        // keeps the order of drawing.
+        e.flushShapes(e.view_transform, p.color);
+        e.fillNonSimplePolygon(points, p.color);
+        continue;
       }
-      gl.bindBuffer(e.vbo, gl.BufferTarget.array_buffer);
-      if (e.vao != .invalid) {
-        gl.bindVertexArray(e.vao);
+      e.shape_vertices.ensureUnusedCapacity(e.allocator, indices.len * 2) catch {
+        std.log.scoped(.zargo).err("fillPolygons: out of memory", .{});
+        break;
+      };
+      for (indices) |index| e.shape_vertices.appendSliceAssumeCapacity(&points[index]);
+    }
+    if (polygons.len > 0) e.flushShapes(e.view_transform, polygons[polygons.len - 1].color);
+  }
+
+  /// triangulation returns the triangulation of the polygon with the given
+  /// corners from the triangulation cache, triangulating it if it isn't
+  /// cached yet. The returned indices are valid until the next call.
+  /// They are empty if the polygon is not simple, which is cached as well.
+  /// Returns null and logs an error on failure.
+  fn triangulation(e: *Engine, points: []const [2]f32) ?[]const u32 {
+    const bytes = std.mem.sliceAsBytes(points);
+    const key = std.hash.Wyhash.hash(0, bytes);
+    if (e.triangulations.get(key)) |value| {
+      if (std.mem.eql(u8, std.mem.sliceAsBytes(value.points), bytes)) return value.indices;
+    }
+    const indices: []const u32 = triangulate(e.allocator, points) catch |err| switch (err) {
+      error.OutOfMemory => {
+        std.log.scoped(.zargo).err("polygon triangulation: out of memory", .{});
+        return null;
+      },
+      error.NonSimplePolygon => &[_]u32{},
+    };
+    const copy = e.allocator.dupe([2]f32, points) catch {
+      std.log.scoped(.zargo).err("polygon triangulation: out of memory", .{});
+      e.allocator.free(indices);
+      return null;
+    };
+    if (e.triangulations.count() >= max_cached_triangulations) e.clearTriangulations();
+    const entry = e.triangulations.getOrPut(e.allocator, key) catch {
+      std.log.scoped(.zargo).err("polygon triangulation: out of memory", .{});
+      e.allocator.free(copy);
+      e.allocator.free(indices);
+      return null;
+    };
+    if (entry.found_existing) {
+      e.allocator.free(entry.value_ptr.points);
+      e.allocator.free(entry.value_ptr.indices);
+    }
+    entry.value_ptr.* = .{.points = copy, .indices = indices};
+    return indices;
+  }
+
+  /// fillNonSimplePolygon fills a polygon that cannot be triangulated with
+  /// stencil-then-cover, using the non-zero rule.
+  fn fillNonSimplePolygon(e: *Engine, points: []const [2]f32, color: [4]u8) void {
+    if (!e.hasStencil()) {
+      std.log.scoped(.zargo).err("fillPolygons: self-intersecting polygons need a stencil buffer", .{});
+      return;
+    }
+    defer e.shape_vertices.clearRetainingCapacity();
+    e.appendFan(points) catch {
+      std.log.scoped(.zargo).err("fillPolygons: out of memory", .{});
+      return;
+    };
+    e.appendCoverQuad(points) catch {
+      std.log.scoped(.zargo).err("fillPolygons: out of memory", .{});
+      return;
+    };
+    gl.bindBuffer(e.shape_vbo, .array_buffer);
+    gl.bufferData(.array_buffer, f32, e.shape_vertices.items, .stream_draw);
+    e.stencilThenCover(e.shape_vbo, e.shape_vertices.items.len / 2, e.view_transform, .non_zero, color);
+  }
+
+  fn clearTriangulations(e: *Engine) void {
+    var iter = e.triangulations.valueIterator();
+    while (iter.next()) |value| {
+      e.allocator.free(value.points);
+      e.allocator.free(value.indices);
+    }
+    e.triangulations.clearRetainingCapacity();
+  }
+
+  /// flushShapes fills the triangles collected in shape_vertices with the
+  /// given color, transforming them into normalized device coordinates with t.
+  fn flushShapes(e: *Engine, t: Transform, color: [4]u8) void {
+    if (e.shape_vertices.items.len == 0) return;
+    defer e.shape_vertices.clearRetainingCapacity();
+    const blend = color[3] != 255;
+    if (blend) {
+      gl.enable(gl.Capabilities.blend);
+      gl.blendFuncSeparate(gl.BlendFactor.src_alpha, gl.BlendFactor.one_minus_src_alpha, gl.BlendFactor.one_minus_dst_alpha, gl.BlendFactor.one);
+    }
+    defer if (blend) gl.disable(gl.Capabilities.blend);
+
+    gl.bindBuffer(e.shape_vbo, .array_buffer);
+    gl.bufferData(.array_buffer, f32, e.shape_vertices.items, .stream_draw);
+    if (e.vao != .invalid) {
+      gl.bindVertexArray(e.vao);
+    }
+    gl.useProgram(e.rect_proc.p);
+    gl.vertexAttribPointer(e.rect_proc.position, 2, gl.Type.float, false, 2*@sizeOf(f32), 0);
+    gl.enableVertexAttribArray(e.rect_proc.position);
+    setUniformColor(e.rect_proc.color, color);
+    gl.uniform2fv(e.rect_proc.transform, &t.m);
+    gl.drawArrays(gl.PrimitiveType.triangles, 0, e.shape_vertices.items.len / 2);
+  }
+
+  /// createPolyline uploads the line segments between the given points, in
+  /// the current coordinate system, for drawing them with drawPolyline.
+  pub fn createPolyline(e: *Engine, points: []const [2]f32) !Polyline {
+    var ret = Polyline{.buffer = gl.genBuffer(), .segments = 0, .instanced = e.instancing};
+    errdefer gl.deleteBuffer(ret.buffer);
+    try e.updatePolyline(&ret, points);
+    return ret;
+  }
+
+  /// updatePolyline replaces the points of the given polyline.
+  pub fn updatePolyline(e: *Engine, l: *Polyline, points: []const [2]f32) !void {
+    l.segments = try e.uploadLine(l.buffer, points, .static_draw);
+  }
+
+  /// drawPolyline draws the given polyline with the given color and width,
+  /// in units of the current coordinate system. Segments are connected with
+  /// miter joins and the line's edges are anti-aliased. The whole polyline is
+  /// drawn with a single draw call; segments are expanded into quads in the
+  /// vertex shader through instancing where the backend supports it.
+  pub fn drawPolyline(e: *Engine, l: Polyline, width: f32, color: [4]u8) void {
+    if (Impl.inGroup(e)) _ = Impl.deferDraw(e, null);
+    e.drawLine(l, e.view_transform, 1.0, width, color);
+  }
+
+  /// drawLine draws the given polyline, transforming its points into
+  /// normalized device coordinates with t. scale is the size of a unit of
+  /// the points in the current coordinate system, so that anti-aliasing
+  /// stays a pixel wide.
+  fn drawLine(e: *Engine, l: Polyline, t: Transform, scale: f32, width: f32, color: [4]u8) void {
+    if (l.segments == 0) return;
+    gl.enable(gl.Capabilities.blend);
+    gl.blendFuncSeparate(gl.BlendFactor.src_alpha, gl.BlendFactor.one_minus_src_alpha, gl.BlendFactor.one_minus_dst_alpha, gl.BlendFactor.one);
+    defer gl.disable(gl.Capabilities.blend);
+    if (e.vao != .invalid) {
+      gl.bindVertexArray(e.vao);
+    }
+    const proc = &e.line_proc;
+    gl.useProgram(proc.p);
+    setUniformColor(proc.color, color);
+    gl.uniform2fv(proc.transform, &t.m);
+    gl.uniform1f(proc.half_width, width / 2.0);
+    gl.uniform1f(proc.scale, scale);
+    defer gl.disableVertexAttribArray(proc.corner);
+    defer for (proc.points) |attr| gl.disableVertexAttribArray(attr);
+
+    if (l.instanced) {
+      gl.bindBuffer(e.corner_vbo, .array_buffer);
+      gl.vertexAttribPointer(proc.corner, 2, gl.Type.float, false, 2*@sizeOf(f32), 0);
+      gl.enableVertexAttribArray(proc.corner);
+      // all four attributes read the same points, each one point further.
+      gl.bindBuffer(l.buffer, .array_buffer);
+      for (proc.points) |attr, i| {
+        gl.vertexAttribPointer(attr, 2, gl.Type.float, false, 2*@sizeOf(f32), i*2*@sizeOf(f32));
+        gl.enableVertexAttribArray(attr);
+        epoxy.glVertexAttribDivisor(attr, 1);
+      }
+      defer for (proc.points) |attr| epoxy.glVertexAttribDivisor(attr, 0);
+      epoxy.glDrawArraysInstanced(epoxy.GL_TRIANGLES, 0, line_corners.len, @intCast(c_int, l.segments));
+    } else {
+      gl.bindBuffer(l.buffer, .array_buffer);
+      gl.vertexAttribPointer(proc.corner, 2, gl.Type.float, false, 10*@sizeOf(f32), 0);
+      gl.enableVertexAttribArray(proc.corner);
+      for (proc.points) |attr, i| {
+        gl.vertexAttribPointer(attr, 2, gl.Type.float, false, 10*@sizeOf(f32), (i + 1)*2*@sizeOf(f32));
+        gl.enableVertexAttribArray(attr);
+      }
+      gl.drawArrays(gl.PrimitiveType.triangles, 0, l.segments * line_corners.len);
+    }
+  }
+
+  /// strokePolyline draws the line segments between the given points like
+  /// drawPolyline, streaming the points instead of keeping them in a buffer.
+  pub fn strokePolyline(e: *Engine, points: []const [2]f32, width: f32, color: [4]u8) void {
+    const segments = e.uploadLine(e.shape_vbo, points, .stream_draw) catch {
+      std.log.scoped(.zargo).err("strokePolyline: out of memory", .{});
+      return;
+    };
+    e.drawPolyline(.{.buffer = e.shape_vbo, .segments = segments, .instanced = e.instancing}, width, color);
+  }
+
+  /// uploadLine writes the vertex data of the line segments between the given
+  /// points into buffer and returns the number of segments. With instancing,
+  /// the data are the points with the first and last one repeated, so that
+  /// each segment can read its neighbors. Otherwise, the segments are
+  /// expanded by appendLineSegments.
+  fn uploadLine(e: *Engine, buffer: gl.Buffer, points: []const [2]f32, usage: gl.BufferUsage) !usize {
+    if (points.len < 2) return 0;
+    defer e.shape_vertices.clearRetainingCapacity();
+    const n = points.len;
+    if (e.instancing) {
+      try e.shape_vertices.ensureUnusedCapacity(e.allocator, (n + 2) * 2);
+      e.shape_vertices.appendSliceAssumeCapacity(&points[0]);
+      for (points) |*p| e.shape_vertices.appendSliceAssumeCapacity(p);
+      e.shape_vertices.appendSliceAssumeCapacity(&points[n - 1]);
+    } else try e.appendLineSegments(points, false);
+    gl.bindBuffer(buffer, .array_buffer);
+    gl.bufferData(.array_buffer, f32, e.shape_vertices.items, usage);
+    return n - 1;
+  }
+
+  /// appendLineSegments expands each of the line segments between the given
+  /// points into two triangles whose vertices carry the corner and all points
+  /// of the segment, and appends them to shape_vertices. If closed is true,
+  /// the last point is connected to the first one.
+  fn appendLineSegments(e: *Engine, points: []const [2]f32, closed: bool) !void {
+    const n = points.len;
+    if (n < 2) return;
+    const segments = if (closed) n else n - 1;
+    try e.shape_vertices.ensureUnusedCapacity(e.allocator, segments * line_corners.len * 10);
+    var i: usize = 0;
+    while (i < segments) : (i += 1) {
+      const prev = if (i > 0) points[i - 1] else if (closed) points[n - 1] else points[0];
+      const p1 = points[(i + 1) % n];
+      const next = if (i + 2 < n or closed) points[(i + 2) % n] else points[n - 1];
+      for (line_corners) |corner| {
+        for ([_][2]f32{corner, prev, points[i], p1, next}) |v| {
+          e.shape_vertices.appendSliceAssumeCapacity(&v);
+        }
+      }
+    }
+  }
+
+  /// fillPath fills the given path, transformed by t into the current
+  /// coordinate system, with the given color according to the fill rule.
+  ///
+  /// Paths are filled with stencil-then-cover: the contours' fan triangles
+  /// count the windings around each pixel in the stencil buffer, then a quad
+  /// covering the path fills the pixels that are inside. This needs a stencil
+  /// buffer in the current framebuffer; canvases and render targets have one,
+  /// the window needs to be created with stencil bits. Without one, each
+  /// contour is triangulated and filled on its own, which is only exact for
+  /// paths of simple, non-overlapping contours.
+  pub fn fillPath(e: *Engine, path: *Path, t: Transform, rule: FillRule, color: [4]u8) void {
+    if (Impl.inGroup(e)) _ = Impl.deferDraw(e, null);
+    const f = e.flattenedPath(path, t) orelse return;
+    if (f.fill_vertices == 0) return;
+    const it = e.view_transform.compose(t);
+    if (!e.hasStencil()) return e.fillContours(f, it, color);
+    e.stencilThenCover(f.fill, f.fill_vertices, it, rule, color);
+  }
+
+  /// stencilThenCover fills the first vertices of buffer, which are the fan
+  /// triangles of some contours followed by a quad covering them, with the
+  /// given color according to rule. t transforms the vertices into
+  /// normalized device coordinates. The current framebuffer must have a
+  /// stencil buffer.
+  fn stencilThenCover(e: *Engine, buffer: gl.Buffer, vertices: usize, t: Transform, rule: FillRule, color: [4]u8) void {
+    if (e.vao != .invalid) {
+      gl.bindVertexArray(e.vao);
+    }
+    gl.useProgram(e.rect_proc.p);
+    setUniformColor(e.rect_proc.color, color);
+    gl.uniform2fv(e.rect_proc.transform, &t.m);
+    gl.bindBuffer(buffer, .array_buffer);
+    gl.vertexAttribPointer(e.rect_proc.position, 2, gl.Type.float, false, 2*@sizeOf(f32), 0);
+    gl.enableVertexAttribArray(e.rect_proc.position);
+
+    epoxy.glEnable(epoxy.GL_STENCIL_TEST);
+    defer epoxy.glDisable(epoxy.GL_STENCIL_TEST);
+    epoxy.glStencilMask(0xff);
+    epoxy.glColorMask(epoxy.GL_FALSE, epoxy.GL_FALSE, epoxy.GL_FALSE, epoxy.GL_FALSE);
+    epoxy.glStencilFunc(epoxy.GL_ALWAYS, 0, 0xff);
+    switch (rule) {
+      .non_zero => {
+        epoxy.glStencilOpSeparate(epoxy.GL_FRONT, epoxy.GL_KEEP, epoxy.GL_KEEP, epoxy.GL_INCR_WRAP);
+        epoxy.glStencilOpSeparate(epoxy.GL_BACK, epoxy.GL_KEEP, epoxy.GL_KEEP, epoxy.GL_DECR_WRAP);
+      },
+      .even_odd => epoxy.glStencilOp(epoxy.GL_KEEP, epoxy.GL_KEEP, epoxy.GL_INVERT),
+    }
+    // the last six vertices are the covering quad.
+    gl.drawArrays(gl.PrimitiveType.triangles, 0, vertices - 6);
+
+    // cover the path, resetting the stencil buffer to zero on the way.
+    epoxy.glColorMask(epoxy.GL_TRUE, epoxy.GL_TRUE, epoxy.GL_TRUE, epoxy.GL_TRUE);
+    epoxy.glStencilFunc(epoxy.GL_NOTEQUAL, 0, 0xff);
+    epoxy.glStencilOp(epoxy.GL_ZERO, epoxy.GL_ZERO, epoxy.GL_ZERO);
+    const blend = color[3] != 255;
+    if (blend) {
+      gl.enable(gl.Capabilities.blend);
+      gl.blendFuncSeparate(gl.BlendFactor.src_alpha, gl.BlendFactor.one_minus_src_alpha, gl.BlendFactor.one_minus_dst_alpha, gl.BlendFactor.one);
+    }
+    defer if (blend) gl.disable(gl.Capabilities.blend);
+    gl.drawArrays(gl.PrimitiveType.triangles, vertices - 6, 6);
+  }
+
+  /// strokePath draws the contours of the given path, transformed by t into
+  /// the current coordinate system, with the given color like drawPolyline.
+  /// width is given in the path's coordinate system.
+  pub fn strokePath(e: *Engine, path: *Path, t: Transform, width: f32, color: [4]u8) void {
+    if (Impl.inGroup(e)) _ = Impl.deferDraw(e, null);
+    const f = e.flattenedPath(path, t) orelse return;
+    const scale = std.math.max(std.math.max(vecLength(t.m[0]), vecLength(t.m[1])), 1.0e-6);
+    e.drawLine(f.stroke, e.view_transform.compose(t), scale, width, color);
+  }
+
+  /// flattenedPath returns the given path flattened for being drawn with the
+  /// transformation t, flattening and uploading it if it hasn't been drawn
+  /// at a similar scale before.
+  /// Returns null and logs an error on failure.
+  fn flattenedPath(e: *Engine, path: *Path, t: Transform) ?*Path.Flattened {
+    const scale = std.math.max(std.math.max(vecLength(t.m[0]), vecLength(t.m[1])), 1.0e-6);
+    // buckets are half an octave wide.
+    const bucket = @floatToInt(i8, std.math.clamp(@ceil(std.math.log2(scale) * 2), -64, 63));
+    if (path.flattened.getPtr(bucket)) |f| return f;
+
+    var points = std.ArrayListUnmanaged([2]f32){};
+    defer points.deinit(path.allocator);
+    var contours = std.ArrayListUnmanaged(Path.Contour){};
+    defer contours.deinit(path.allocator);
+    // flatten for the largest scale in the bucket.
+    const tolerance = curve_tolerance / std.math.pow(f32, 2, @intToFloat(f32, bucket) / 2);
+    path.flatten(tolerance, &points, &contours) catch {
+      std.log.scoped(.zargo).err("path flattening: out of memory", .{});
+      return null;
+    };
+    var ret = Path.Flattened{
+      .fill = gl.genBuffer(), .fill_vertices = 0,
+      .stroke = .{.buffer = gl.genBuffer(), .segments = 0, .instanced = false},
+      .points = points.toOwnedSlice(path.allocator), .contours = contours.toOwnedSlice(path.allocator),
+    };
+    e.uploadPath(&ret) catch {
+      std.log.scoped(.zargo).err("path flattening: out of memory", .{});
+      ret.deinit(path.allocator);
+      return null;
+    };
+    if (path.flattened.count() >= max_flattened_paths) path.invalidate();
+    const entry = path.flattened.getOrPut(path.allocator, bucket) catch {
+      std.log.scoped(.zargo).err("path flattening: out of memory", .{});
+      ret.deinit(path.allocator);
+      return null;
+    };
+    entry.value_ptr.* = ret;
+    return entry.value_ptr;
+  }
+
+  /// uploadPath writes the fill triangles and stroke segments of the given
+  /// flattened path into its buffers.
+  fn uploadPath(e: *Engine, f: *Path.Flattened) !void {
+    defer e.shape_vertices.clearRetainingCapacity();
+    if (f.points.len == 0) return;
+    for (f.contours) |contour| {
+      try e.appendFan(f.points[contour.start..][0..contour.len]);
+    }
+    if (e.shape_vertices.items.len > 0) {
+      try e.appendCoverQuad(f.points);
+      gl.bindBuffer(f.fill, .array_buffer);
+      gl.bufferData(.array_buffer, f32, e.shape_vertices.items, .static_draw);
+      f.fill_vertices = e.shape_vertices.items.len / 2;
+    }
+
+    e.shape_vertices.clearRetainingCapacity();
+    for (f.contours) |contour| {
+      try e.appendLineSegments(f.points[contour.start..][0..contour.len], contour.closed);
+      f.stroke.segments += if (contour.closed) contour.len else contour.len - 1;
+    }
+    gl.bindBuffer(f.stroke.buffer, .array_buffer);
+    gl.bufferData(.array_buffer, f32, e.shape_vertices.items, .static_draw);
+  }
+
+  /// appendFan appends the fan triangles of the contour with the given points
+  /// to shape_vertices, for counting windings in the stencil buffer.
+  fn appendFan(e: *Engine, points: []const [2]f32) !void {
+    if (points.len < 3) return;
+    try e.shape_vertices.ensureUnusedCapacity(e.allocator, (points.len - 2) * 6);
+    var i: usize = 1;
+    while (i + 1 < points.len) : (i += 1) {
+      for ([_][2]f32{points[0], points[i], points[i + 1]}) |v| {
+        e.shape_vertices.appendSliceAssumeCapacity(&v);
+      }
+    }
+  }
+
+  /// appendCoverQuad appends a quad covering the bounding box of the given
+  /// points to shape_vertices.
+  fn appendCoverQuad(e: *Engine, points: []const [2]f32) !void {
+    var min = points[0];
+    var max = points[0];
+    for (points) |p| {
+      min = .{std.math.min(min[0], p[0]), std.math.min(min[1], p[1])};
+      max = .{std.math.max(max[0], p[0]), std.math.max(max[1], p[1])};
+    }
+    try e.shape_vertices.appendSlice(e.allocator, &[_]f32{
+      min[0], min[1], max[0], min[1], max[0], max[1],
+      min[0], min[1], max[0], max[1], min[0], max[1],
+    });
+  }
+
+  /// fillContours fills each contour of the given flattened path on its own
+  /// by triangulating it, for targets without stencil buffer.
+  fn fillContours(e: *Engine, f: *const Path.Flattened, t: Transform, color: [4]u8) void {
+    for (f.contours) |contour| {
+      const points = f.points[contour.start..][0..contour.len];
+      const indices = e.triangulation(points) orelse continue;
+      if (indices.len == 0 and points.len >= 3) {
+        std.log.scoped(.zargo).err("fillPath: self-intersecting contours need a stencil buffer", .{});
+      }
+      e.shape_vertices.ensureUnusedCapacity(e.allocator, indices.len * 2) catch {
+        std.log.scoped(.zargo).err("fillPath: out of memory", .{});
+        break;
+      };
+      for (indices) |index| e.shape_vertices.appendSliceAssumeCapacity(&points[index]);
+    }
+    e.flushShapes(t, color);
+  }
+
+  /// hasStencil returns whether the current framebuffer has a stencil buffer.
+  fn hasStencil(e: *Engine) bool {
+    if (e.target_stencil) |v| return v;
+    const ret = e.queryStencil();
+    e.target_stencil = ret;
+    return ret;
+  }
+
+  fn queryStencil(e: *Engine) bool {
+    var value: c_int = 0;
+    if (e.backend == .ogles_20) {
+      epoxy.glGetIntegerv(epoxy.GL_STENCIL_BITS, &value);
+      return value > 0;
+    }
+    var framebuffer: c_int = 0;
+    epoxy.glGetIntegerv(epoxy.GL_DRAW_FRAMEBUFFER_BINDING, &framebuffer);
+    const attachment: c_uint = if (framebuffer == 0) epoxy.GL_STENCIL else epoxy.GL_STENCIL_ATTACHMENT;
+    epoxy.glGetFramebufferAttachmentParameteriv(epoxy.GL_DRAW_FRAMEBUFFER, attachment,
+        epoxy.GL_FRAMEBUFFER_ATTACHMENT_OBJECT_TYPE, &value);
+    if (value == epoxy.GL_NONE) return false;
+    epoxy.glGetFramebufferAttachmentParameteriv(epoxy.GL_DRAW_FRAMEBUFFER, attachment,
+        epoxy.GL_FRAMEBUFFER_ATTACHMENT_STENCIL_SIZE, &value);
+    return value > 0;
+  }
+
+  /// fillCircle fills the circle around center with the given radius.
+  pub fn fillCircle(e: *Engine, center: [2]f32, radius: f32, color: [4]u8) void {
+    e.drawShapes(&[_]Shape{Shape.circle(center, radius, 0, color)});
+  }
+
+  /// strokeCircle draws the outline of the circle around center with the
+  /// given radius. The outline is width wide and lies inside the circle.
+  pub fn strokeCircle(e: *Engine, center: [2]f32, radius: f32, width: f32, color: [4]u8) void {
+    e.drawShapes(&[_]Shape{Shape.circle(center, radius, width, color)});
+  }
+
+  /// fillRoundedRect fills the given rectangle with corners rounded by the
+  /// given radius.
+  pub fn fillRoundedRect(e: *Engine, r: Rectangle, radius: f32, color: [4]u8) void {
+    e.drawShapes(&[_]Shape{Shape.roundedRect(r, radius, 0, color)});
+  }
+
+  /// strokeRoundedRect draws the outline of the given rectangle with corners
+  /// rounded by the given radius. The outline is width wide and lies inside
+  /// the rectangle.
+  pub fn strokeRoundedRect(e: *Engine, r: Rectangle, radius: f32, width: f32, color: [4]u8) void {
+    e.drawShapes(&[_]Shape{Shape.roundedRect(r, radius, width, color)});
+  }
+
+  /// drawShapes draws the given shapes with a single draw call. Each shape is
+  /// a quad whose outline is computed from its signed distance field in the
+  /// fragment shader, so edges are anti-aliased at any size without
+  /// tessellation. Shapes are instanced where the backend supports it.
+  pub fn drawShapes(e: *Engine, shapes: []const Shape) void {
+    if (Impl.inGroup(e)) _ = Impl.deferDraw(e, null);
+    if (shapes.len == 0) return;
+    defer e.shape_vertices.clearRetainingCapacity();
+    const per_shape: usize = if (e.instancing) shape_floats else line_corners.len * (2 + shape_floats);
+    e.shape_vertices.ensureUnusedCapacity(e.allocator, shapes.len * per_shape) catch {
+      std.log.scoped(.zargo).err("drawShapes: out of memory", .{});
+      return;
+    };
+    for (shapes) |s| {
+      const data = s.vertexData();
+      if (e.instancing) {
+        e.shape_vertices.appendSliceAssumeCapacity(&data);
+      } else for (line_corners) |corner| {
+        e.shape_vertices.appendSliceAssumeCapacity(&corner);
+        e.shape_vertices.appendSliceAssumeCapacity(&data);
+      }
+    }
+
+    gl.enable(gl.Capabilities.blend);
+    gl.blendFuncSeparate(gl.BlendFactor.src_alpha, gl.BlendFactor.one_minus_src_alpha, gl.BlendFactor.one_minus_dst_alpha, gl.BlendFactor.one);
+    defer gl.disable(gl.Capabilities.blend);
+    if (e.vao != .invalid) {
+      gl.bindVertexArray(e.vao);
+    }
+    const proc = &e.sdf_shape_proc;
+    gl.useProgram(proc.p);
+    gl.uniform2fv(proc.transform, &e.view_transform.m);
+    defer gl.disableVertexAttribArray(proc.corner);
+    defer for (proc.attributes) |attr| gl.disableVertexAttribArray(attr);
+
+    if (e.instancing) {
+      gl.bindBuffer(e.corner_vbo, .array_buffer);
+      gl.vertexAttribPointer(proc.corner, 2, gl.Type.float, false, 2*@sizeOf(f32), 0);
+      gl.enableVertexAttribArray(proc.corner);
+      gl.bindBuffer(e.shape_vbo, .array_buffer);
+      gl.bufferData(.array_buffer, f32, e.shape_vertices.items, .stream_draw);
+      for (proc.attributes) |attr, i| {
+        gl.vertexAttribPointer(attr, ShapeProc.sizes[i], gl.Type.float, false,
+            shape_floats*@sizeOf(f32), ShapeProc.offsets[i]*@sizeOf(f32));
+        gl.enableVertexAttribArray(attr);
+        epoxy.glVertexAttribDivisor(attr, 1);
+      }
+      defer for (proc.attributes) |attr| epoxy.glVertexAttribDivisor(attr, 0);
+      epoxy.glDrawArraysInstanced(epoxy.GL_TRIANGLES, 0, line_corners.len, @intCast(c_int, shapes.len));
+    } else {
+      gl.bindBuffer(e.shape_vbo, .array_buffer);
+      gl.bufferData(.array_buffer, f32, e.shape_vertices.items, .stream_draw);
+      const stride = (2 + shape_floats)*@sizeOf(f32);
+      gl.vertexAttribPointer(proc.corner, 2, gl.Type.float, false, stride, 0);
+      gl.enableVertexAttribArray(proc.corner);
+      for (proc.attributes) |attr, i| {
+        gl.vertexAttribPointer(attr, ShapeProc.sizes[i], gl.Type.float, false, stride, (2 + ShapeProc.offsets[i])*@sizeOf(f32));
+        gl.enableVertexAttribArray(attr);
+      }
+      gl.drawArrays(gl.PrimitiveType.triangles, 0, shapes.len * line_corners.len);
+    }
+  }
+
+  /// fillGradientRect fills the given rectangle with the given gradient.
+  pub fn fillGradientRect(e: *Engine, r: Rectangle, g: Gradient) void {
+    e.fillGradients(&[_]GradientRect{GradientRect.init(r, g)});
+  }
+
+  /// fillGradients fills the given rectangles with their gradients.
+  /// Consecutive rectangles with gradients of the same kind are drawn with a
+  /// single draw call. Color ramps are looked up in a texture holding up to
+  /// max_gradient_ramps of them, so drawing gradients whose stops have
+  /// already been used needs no upload.
+  pub fn fillGradients(e: *Engine, rects: []const GradientRect) void {
+    if (Impl.inGroup(e)) _ = Impl.deferDraw(e, null);
+    for (rects) |r, i| {
+      if (i > 0 and r.gradient.kind != rects[i - 1].gradient.kind) e.flushGradients(rects[i - 1].gradient.kind);
+      const stops = r.gradient.slice();
+      const row = e.gradient_ramps.get(e, stops) orelse blk: {
+        // all rows are used by the current batch.
+        e.flushGradients(r.gradient.kind);
+        break :blk e.gradient_ramps.get(e, stops).?;
+      };
+      e.shape_vertices.ensureUnusedCapacity(e.allocator, 6 * gradient_floats) catch {
+        std.log.scoped(.zargo).err("fillGradients: out of memory", .{});
+        break;
+      };
+      const v = (@intToFloat(f32, row) + 0.5) / max_gradient_ramps;
+      const g = r.gradient;
+      const x2 = r.x + r.width;
+      const y2 = r.y + r.height;
+      for ([_][2]f32{.{r.x, r.y}, .{x2, r.y}, .{x2, y2}, .{r.x, r.y}, .{x2, y2}, .{r.x, y2}}) |pos| {
+        e.shape_vertices.appendSliceAssumeCapacity(&[_]f32{
+          pos[0], pos[1], g.start[0], g.start[1], g.end[0], g.end[1], v,
+        });
+      }
+    }
+    if (rects.len > 0) e.flushGradients(rects[rects.len - 1].gradient.kind);
+  }
+
+  /// flushGradients draws the rectangles collected in shape_vertices with
+  /// the program for the given kind of gradient and starts a new batch.
+  fn flushGradients(e: *Engine, kind: Gradient.Kind) void {
+    e.gradient_ramps.batch +%= 1;
+    if (e.shape_vertices.items.len == 0) return;
+    defer e.shape_vertices.clearRetainingCapacity();
+    gl.enable(gl.Capabilities.blend);
+    gl.blendFuncSeparate(gl.BlendFactor.src_alpha, gl.BlendFactor.one_minus_src_alpha, gl.BlendFactor.one_minus_dst_alpha, gl.BlendFactor.one);
+    defer gl.disable(gl.Capabilities.blend);
+    if (e.vao != .invalid) {
+      gl.bindVertexArray(e.vao);
+    }
+    const proc = switch (kind) {
+      .linear => &e.linear_gradient_proc,
+      .radial => &e.radial_gradient_proc,
+    };
+    gl.useProgram(proc.p);
+    gl.uniform2fv(proc.transform, &e.view_transform.m);
+    gl.activeTexture(gl.TextureUnit.texture_0);
+    gl.bindTexture(e.gradient_ramps.image.?.id, .@"2d");
+    gl.uniform1i(proc.ramps, 0);
+
+    gl.bindBuffer(e.shape_vbo, .array_buffer);
+    gl.bufferData(.array_buffer, f32, e.shape_vertices.items, .stream_draw);
+    for (proc.attributes) |attr, i| {
+      gl.vertexAttribPointer(attr, GradientProc.sizes[i], gl.Type.float, false,
+          gradient_floats*@sizeOf(f32), GradientProc.offsets[i]*@sizeOf(f32));
+      gl.enableVertexAttribArray(attr);
+    }
+    defer for (proc.attributes) |attr| gl.disableVertexAttribArray(attr);
+    gl.drawArrays(gl.PrimitiveType.triangles, 0, e.shape_vertices.items.len / gradient_floats);
+  }
+
+  /// drawNinePatches draws the given nine-patches. The nine parts of each
+  /// patch are drawn as triangles of a single vertex buffer, and consecutive
+  /// patches from the same image with the same alpha are drawn with a single
+  /// draw call, so panels using an atlas of patches are drawn at once.
+  pub fn drawNinePatches(e: *Engine, draws: []const NinePatchDraw) void {
+    if (Impl.inGroup(e)) _ = Impl.deferDraw(e, null);
+    for (draws) |d, i| {
+      if (i > 0) {
+        const prev = draws[i - 1];
+        if (d.patch.image.id != prev.patch.image.id or d.alpha != prev.alpha) {
+          e.flushNinePatches(prev.patch.image, prev.alpha);
+        }
       }
-      gl.useProgram(e.rect_proc.p);
-      gl.vertexAttribPointer(e.rect_proc.position, 2, gl.Type.float, false, 2*@sizeOf(f32), 0);
-      gl.enableVertexAttribArray(e.rect_proc.position);
+      e.appendNinePatch(d) catch {
+        std.log.scoped(.zargo).err("drawNinePatches: out of memory", .{});
+        break;
+      };
+    }
+    if (draws.len > 0) e.flushNinePatches(draws[draws.len - 1].patch.image, draws[draws.len - 1].alpha);
+  }
 
-      const it = toInternalCoords(e, t, false);
+  /// appendNinePatch appends position and texture coordinates of the
+  /// triangles of the given patch's parts to shape_vertices. Parts without
+  /// area are skipped.
+  fn appendNinePatch(e: *Engine, d: NinePatchDraw) !void {
+    const p = d.patch;
+    const dst = d.dst_area;
+    const src = p.area;
+    const horiz = @intToFloat(f32, @as(u32, p.left) + p.right);
+    const vert = @intToFloat(f32, @as(u32, p.bottom) + p.top);
+    const sx = if (horiz > @intToFloat(f32, dst.width)) @intToFloat(f32, dst.width) / horiz else 1.0;
+    const sy = if (vert > @intToFloat(f32, dst.height)) @intToFloat(f32, dst.height) / vert else 1.0;
+    const dx = @intToFloat(f32, dst.x);
+    const dy = @intToFloat(f32, dst.y);
+    const xs = [4]f32{
+      dx, dx + @intToFloat(f32, p.left) * sx,
+      dx + @intToFloat(f32, dst.width) - @intToFloat(f32, p.right) * sx, dx + @intToFloat(f32, dst.width),
+    };
+    const ys = [4]f32{
+      dy, dy + @intToFloat(f32, p.bottom) * sy,
+      dy + @intToFloat(f32, dst.height) - @intToFloat(f32, p.top) * sy, dy + @intToFloat(f32, dst.height),
+    };
+    const w = @intToFloat(f32, p.image.width);
+    const h = @intToFloat(f32, p.image.height);
+    const us = [4]f32{
+      @intToFloat(f32, src.x) / w, @intToFloat(f32, src.x + p.left) / w,
+      @intToFloat(f32, src.x + src.width - p.right) / w, @intToFloat(f32, src.x + src.width) / w,
+    };
+    var vs = [4]f32{
+      @intToFloat(f32, src.y) / h, @intToFloat(f32, src.y + p.bottom) / h,
+      @intToFloat(f32, src.y + src.height - p.top) / h, @intToFloat(f32, src.y + src.height) / h,
+    };
+    // images created from a canvas are stored bottom-up, loaded images
+    // top-down.
+    if (!p.image.flipped) {
+      for (vs) |*v| v.* = 1.0 - v.*;
+    }
 
-      setUniformColor(e.rect_proc.color, color);
-      gl.uniform2fv(e.rect_proc.transform, &it.m);
-      gl.drawArrays(gl.PrimitiveType.triangle_fan, 0, 4);
+    try e.shape_vertices.ensureUnusedCapacity(e.allocator, 9 * 6 * 4);
+    const corners = [_][2]usize{.{0, 0}, .{1, 0}, .{1, 1}, .{0, 0}, .{1, 1}, .{0, 1}};
+    var row: usize = 0;
+    while (row < 3) : (row += 1) {
+      if (ys[row + 1] <= ys[row]) continue;
+      var col: usize = 0;
+      while (col < 3) : (col += 1) {
+        if (xs[col + 1] <= xs[col]) continue;
+        for (corners) |c| {
+          e.shape_vertices.appendSliceAssumeCapacity(&[_]f32{
+            xs[col + c[0]], ys[row + c[1]], us[col + c[0]], vs[row + c[1]],
+          });
+        }
+      }
     }
+  }
 
-    /// fillRect fills the given rectangle with the given color according to the
-    /// semantic of fillUnit.
-    pub fn fillRect(e: *Self, r: RectImpl, color: [4]u8, copy_alpha: bool) void {
-      e.fillUnit(r.transformation(), color, copy_alpha);
+  /// flushNinePatches draws the triangles collected in shape_vertices with
+  /// the given image and alpha.
+  fn flushNinePatches(e: *Engine, image: Image, alpha: u8) void {
+    if (e.shape_vertices.items.len == 0) return;
+    defer e.shape_vertices.clearRetainingCapacity();
+    const blend = alpha != 255 or image.has_alpha;
+    if (blend) {
+      gl.enable(gl.Capabilities.blend);
+      gl.blendFuncSeparate(gl.BlendFactor.src_alpha, gl.BlendFactor.one_minus_src_alpha, gl.BlendFactor.one_minus_dst_alpha, gl.BlendFactor.one);
     }
+    defer if (blend) gl.disable(gl.Capabilities.blend);
 
-    /// blendUnit fills the unit square around (0,0) with two colors.
-    /// The square is transformed by dst_transform before it is being filled.
-    /// The two colors are mixed via the red channel of mask by mapping
-    /// 0 to color1 and 255 to color2, the values in between doing linear blending.
-    ///
-    /// The area of the mask used for blending is the unit square around (0,0),
-    /// transformed by src_transform. The result can be larger than the mask if
-    /// the mask should be repeated.
-    pub fn blendUnit(e: *Self, mask: ImgImpl, dst_transform: Transform, src_transform: Transform, color1: [4]u8, color2: [4]u8) void {
-      gl.bindBuffer(e.vbo, gl.BufferTarget.array_buffer);
-      if (e.vao != .invalid) {
-        gl.bindVertexArray(e.vao);
-      }
-      gl.useProgram(e.blend_proc.p);
-      gl.vertexAttribPointer(e.blend_proc.position, 2, gl.Type.float, false, 2*@sizeOf(f32), 0);
-      gl.enableVertexAttribArray(e.blend_proc.position);
+    const proc = &e.nine_patch_proc;
+    gl.bindBuffer(e.shape_vbo, .array_buffer);
+    gl.bufferData(.array_buffer, f32, e.shape_vertices.items, .stream_draw);
+    if (e.vao != .invalid) {
+      gl.bindVertexArray(e.vao);
+    }
+    gl.useProgram(proc.p);
+    gl.vertexAttribPointer(proc.position, 2, gl.Type.float, false, 4*@sizeOf(f32), 0);
+    gl.enableVertexAttribArray(proc.position);
+    defer gl.disableVertexAttribArray(proc.position);
+    gl.vertexAttribPointer(proc.tex_coord, 2, gl.Type.float, false, 4*@sizeOf(f32), 2*@sizeOf(f32));
+    gl.enableVertexAttribArray(proc.tex_coord);
+    defer gl.disableVertexAttribArray(proc.tex_coord);
 
-      gl.activeTexture(gl.TextureUnit.texture_0);
-      gl.bindTexture(mask.id, gl.TextureTarget.@"2d");
-      gl.uniform1i(e.blend_proc.texture, 0);
+    gl.activeTexture(gl.TextureUnit.texture_0);
+    gl.bindTexture(image.id, gl.TextureTarget.@"2d");
+    gl.uniform1i(proc.texture, 0);
+    gl.uniform1f(proc.alpha, @intToFloat(f32, alpha)/255.0);
+    gl.uniform2fv(proc.transform, &e.view_transform.m);
 
-      const ist = Transform.identity().scale(
-        1.0 / @intToFloat(f32, mask.width), -1.0 / @intToFloat(f32, mask.height)
-      ).compose(src_transform).translate(-0.5, -0.5);
-      gl.uniform2fv(e.blend_proc.texTrans, &ist.m);
+    gl.drawArrays(gl.PrimitiveType.triangles, 0, e.shape_vertices.items.len / 4);
+  }
+};
 
-      const idt = toInternalCoords(e, dst_transform, false);
-      gl.uniform2fv(e.blend_proc.posTrans, &idt.m);
+pub const CEngineInterface = EngineImpl(Engine, CRectangle, CImage);
 
-      setUniformColor(e.blend_proc.primary, color1);
-      setUniformColor(e.blend_proc.secondary, color2);
+//////////////////////////////////////////////////////////////////////////////
+// Effects
 
-      gl.drawArrays(gl.PrimitiveType.triangle_fan, 0, 4);
-    }
+const KawaseProc = struct {
+  p: gl.Program,
+  src_transform: u32,
+  dst_transform: u32,
+  position: u32,
+  texture: u32,
+  halfpixel: u32,
+  offset: u32,
 
-    /// blendRect fills the given rectangle a blend of the given colors according
-    /// to the semantics of blendUnit, with src_rect being source area of the mask,
-    /// which may be larger than the mask and will then cause to repeat it.
-    pub fn blendRect(e: *Self, mask: ImgImpl, dst_rect: RectImpl, src_rect: RectImpl, color1: [4]u8, color2: [4]u8) void {
-      blendUnit(e, mask, dst_rect.transformation(), src_rect.transformation(), color1, color2);
-    }
+  fn init(vs_src: []const u8, fs_src: []const u8) !KawaseProc {
+    const p = try linkProgram(vs_src, fs_src);
+    errdefer gl.deleteProgram(p);
+    return KawaseProc{
+      .p = p,
+      .src_transform = try getUniformLocation(p, "u_src_transform"),
+      .dst_transform = try getUniformLocation(p, "u_dst_transform"),
+      .position = try getAttribLocation(p, "a_position"),
+      .texture = try getUniformLocation(p, "s_texture"),
+      .halfpixel = try getUniformLocation(p, "u_halfpixel"),
+      .offset = try getUniformLocation(p, "u_offset"),
+    };
+  }
 
-    /// loadImage loads the image file at the given path into a texture.
-    /// on failure, the returned image will be empty.
-    pub fn loadImage(e: *Self, path: [:0]const u8) ImgImpl {
-      var x: c_int = undefined;
-      var y: c_int = undefined;
-      var n: c_int = undefined;
-      const pixels = c.stbi_load(path, &x, &y, &n, 0);
-      defer c.stbi_image_free(pixels);
-      return genTexture(e, @intCast(usize, x), @intCast(usize, y), @intCast(u8, n), false, pixels);
+  /// pass renders src, mapped by tex_transform from the unit square, into the
+  /// whole of dst.
+  fn pass(proc: *const KawaseProc, e: *Engine, src: Image, tex_transform: Transform, dst: RenderTarget, offset: f32) !void {
+    var canvas = try Canvas.createOn(e, dst.framebuffer, dst.image);
+    defer _ = canvas.finish() catch unreachable;
+
+    gl.bindBuffer(e.vbo, .array_buffer);
+    if (e.vao != .invalid) {
+      gl.bindVertexArray(e.vao);
     }
+    gl.useProgram(proc.p);
+    gl.vertexAttribPointer(proc.position, 2, gl.Type.float, false, 2*@sizeOf(f32), 0);
+    gl.enableVertexAttribArray(proc.position);
 
-    /// drawImage is the low-level version of Image.draw. The src_transform
-    /// transforms the unit square around (0,0) into the rectangle you want
-    /// to draw from (give i.area() to draw the whole image).
-    /// The dst_transform transforms the unit square around (0,0) into the
-    /// rectangle you want to draw into.
-    /// The given alpha value will applied on top of an existing alpha value if
-    /// the image has an alpha channel.
-    pub fn drawImage(e: *Self, i: ImgImpl, dst_transform: Transform, src_transform: Transform, alpha: u8) void {
-      if (alpha != 255 or i.has_alpha) {
-        gl.enable(gl.Capabilities.blend);
-        gl.blendFuncSeparate(gl.BlendFactor.src_alpha, gl.BlendFactor.one_minus_src_alpha, gl.BlendFactor.one_minus_dst_alpha, gl.BlendFactor.one);
-      }
+    gl.activeTexture(gl.TextureUnit.texture_0);
+    gl.bindTexture(src.id, gl.TextureTarget.@"2d");
+    // sampling outside of the source must not wrap around.
+    gl.texParameter(.@"2d", .wrap_s, .clamp_to_edge);
+    gl.texParameter(.@"2d", .wrap_t, .clamp_to_edge);
+    gl.uniform1i(proc.texture, 0);
+    gl.uniform2f(proc.halfpixel, 0.5 / @intToFloat(f32, dst.image.width),
+        0.5 / @intToFloat(f32, dst.image.height));
+    gl.uniform1f(proc.offset, offset);
+    gl.uniform2fv(proc.src_transform, &tex_transform.m);
+    const ndc = Transform.identity().translate(-1.0, -1.0).scale(2.0, 2.0);
+    gl.uniform2fv(proc.dst_transform, &ndc.m);
 
-      gl.bindBuffer(e.vbo, .array_buffer);
-      if (e.vao != .invalid) {
-        gl.bindVertexArray(e.vao);
-      }
-      gl.useProgram(e.img_proc.p);
+    gl.drawArrays(gl.PrimitiveType.triangle_fan, 0, 4);
 
-      gl.vertexAttribPointer(e.rect_proc.position, 2, gl.Type.float, false, 2*@sizeOf(f32), 0);
-      gl.enableVertexAttribArray(e.rect_proc.position);
+    gl.texParameter(.@"2d", .wrap_s, .repeat);
+    gl.texParameter(.@"2d", .wrap_t, .repeat);
+  }
+};
 
-      gl.activeTexture(gl.TextureUnit.texture_0);
-      gl.bindTexture(i.id, gl.TextureTarget.@"2d");
-      gl.uniform1i(e.img_proc.texture, 0);
-      gl.uniform1f(e.img_proc.alpha, @intToFloat(f32, alpha)/255.0);
+/// max_blur_iterations is the maximum number of downsampling steps of blur.
+pub const max_blur_iterations = 8;
 
-      const ist = Transform.identity().scale(
-        1.0 / @intToFloat(f32, i.width), -1.0 / @intToFloat(f32, i.height)
-      ).compose(src_transform).translate(-0.5, -0.5);
-      gl.uniform2fv(e.img_proc.src_transform, &ist.m);
+//////////////////////////////////////////////////////////////////////////////
+// Frame graph
 
-      const idt = toInternalCoords(e, dst_transform, false);
-      gl.uniform2fv(e.img_proc.dst_transform, &idt.m);
+/// FrameGraph organizes multi-pass effects as passes that declare which images
+/// they read and which render target they write.
+/// On execute, passes not contributing to the requested output are culled,
+/// and transient render targets whose lifetimes don't overlap share the same
+/// pooled render target, keeping the GPU memory needed for effect chains low.
+///
+/// Each transient render target must be written by exactly one pass, and a
+/// pass may only read images that are imported or written by an earlier pass.
+/// A FrameGraph can be executed multiple times.
+pub const FrameGraph = struct {
+  /// Handle identifies an image in the frame graph.
+  pub const Handle = enum(u32) {_};
 
-      gl.drawArrays(gl.PrimitiveType.triangle_fan, 0, 4);
+  pub const Error = error {
+    AlreadyWritten,
+    NotWritten,
+    NotTransient,
+  };
+
+  const Resource = struct {
+    width: u31,
+    height: u31,
+    with_alpha: bool,
+    /// set for images imported into the graph, which are never aliased.
+    imported: ?Image,
+    /// index of the pass writing this resource.
+    writer: ?usize,
+    /// index of the last pass reading this resource.
+    last_use: usize,
+    /// render target assigned during execution.
+    physical: ?RenderTarget,
+  };
+
+  const Pass = struct {
+    inputs: []Handle,
+    output: Handle,
+    context: *anyopaque,
+    run: fn (context: *anyopaque, e: *Engine, inputs: []const Image) void,
+    alive: bool,
+  };
+
+  e: *Engine,
+  resources: std.ArrayListUnmanaged(Resource),
+  passes: std.ArrayListUnmanaged(Pass),
 
-      if (alpha != 255 or i.has_alpha) {
-        gl.disable(gl.Capabilities.blend);
+  pub fn init(e: *Engine) FrameGraph {
+    return .{.e = e, .resources = .{}, .passes = .{}};
+  }
+
+  pub fn deinit(fg: *FrameGraph) void {
+    for (fg.passes.items) |p| fg.e.allocator.free(p.inputs);
+    fg.passes.deinit(fg.e.allocator);
+    fg.resources.deinit(fg.e.allocator);
+  }
+
+  /// importImage makes an existing image available as input for passes.
+  pub fn importImage(fg: *FrameGraph, image: Image) !Handle {
+    try fg.resources.append(fg.e.allocator, .{
+      .width = image.width, .height = image.height, .with_alpha = image.has_alpha,
+      .imported = image, .writer = null, .last_use = 0, .physical = null,
+    });
+    return @intToEnum(Handle, @intCast(u32, fg.resources.items.len - 1));
+  }
+
+  /// createTarget declares a transient render target which will be backed by
+  /// a pooled render target during execution.
+  pub fn createTarget(fg: *FrameGraph, width: u31, height: u31, with_alpha: bool) !Handle {
+    try fg.resources.append(fg.e.allocator, .{
+      .width = width, .height = height, .with_alpha = with_alpha,
+      .imported = null, .writer = null, .last_use = 0, .physical = null,
+    });
+    return @intToEnum(Handle, @intCast(u32, fg.resources.items.len - 1));
+  }
+
+  fn resource(fg: *FrameGraph, h: Handle) *Resource {
+    return &fg.resources.items[@enumToInt(h)];
+  }
+
+  /// addPass adds a pass reading the images given as inputs and writing
+  /// output, which must be a transient render target.
+  /// When executed, render is called with context while a canvas on output is
+  /// active, which has been cleared to transparent black. inputs are the
+  /// images of the given input handles, in order.
+  /// context must be a non-const pointer that stays valid while the graph is
+  /// in use.
+  pub fn addPass(fg: *FrameGraph, inputs: []const Handle, output: Handle, context: anytype,
+                 comptime render: fn (@TypeOf(context), *Engine, []const Image) void) !void {
+    const Ctx = @TypeOf(context);
+    const wrapper = struct {
+      fn run(ctx: *anyopaque, e: *Engine, images: []const Image) void {
+        render(@ptrCast(Ctx, @alignCast(@alignOf(std.meta.Child(Ctx)), ctx)), e, images);
       }
+    };
+    const out = fg.resource(output);
+    if (out.imported != null) return Error.NotTransient;
+    if (out.writer != null) return Error.AlreadyWritten;
+    for (inputs) |h| {
+      const r = fg.resource(h);
+      if (r.imported == null and r.writer == null) return Error.NotWritten;
     }
+    const owned = try fg.e.allocator.dupe(Handle, inputs);
+    errdefer fg.e.allocator.free(owned);
+    try fg.passes.append(fg.e.allocator, .{
+      .inputs = owned, .output = output, .context = @ptrCast(*anyopaque, context),
+      .run = wrapper.run, .alive = false,
+    });
+    out.writer = fg.passes.items.len - 1;
+  }
 
-    fn toInternalCoords(e: *Self, t: Transform, flip: bool) Transform {
-      var r = e.view_transform.compose(t);
-      if (flip) {
-        r = r.scale(1.0, -1.0);
+  /// execute runs all passes needed to produce output and returns the render
+  /// target holding it, which must be given back with Engine.releaseTarget.
+  pub fn execute(fg: *FrameGraph, output: Handle) !RenderTarget {
+    const e = fg.e;
+    const final = fg.resource(output);
+    if (final.writer == null) return Error.NotWritten;
+
+    // cull passes not contributing to output. Since passes only read
+    // resources of earlier passes, a single backwards sweep suffices.
+    for (fg.passes.items) |*p| p.alive = false;
+    for (fg.resources.items) |*r| {
+      r.last_use = 0;
+      r.physical = null;
+    }
+    fg.passes.items[final.writer.?].alive = true;
+    var index = fg.passes.items.len;
+    while (index > 0) {
+      index -= 1;
+      const p = &fg.passes.items[index];
+      if (!p.alive) continue;
+      for (p.inputs) |h| {
+        const r = fg.resource(h);
+        if (r.writer) |w| fg.passes.items[w].alive = true;
+        // the sweep visits later readers first.
+        r.last_use = std.math.max(r.last_use, index);
       }
-      return r.translate(-0.5, -0.5);
     }
+    // the output stays alive beyond the last pass.
+    final.last_use = fg.passes.items.len;
 
-    fn genTexture(e: *Self, width: usize, height: usize, num_colors: u8, flipped: bool, pixels: ?[*]const u8) ImgImpl {
-      const ret = gl.genTexture();
-      gl.bindTexture(ret, .@"2d");
-      gl.texParameter(.@"2d", .mag_filter, .linear);
-      gl.texParameter(.@"2d", .min_filter, .linear);
-      gl.texParameter(.@"2d", .wrap_s, .repeat);
-      gl.texParameter(.@"2d", .wrap_t, .repeat);
-      gl.pixelStore(.unpack_alignment, @intCast(usize, num_colors));
-      const gl_format = switch (num_colors) {
-        1    => e.single_value_color,
-        2, 3 => .rgb,
-        4    => .rgba,
-        else => unreachable
-      };
-      gl.textureImage2D(.@"2d", 0, gl_format, width, height, gl_format, gl.PixelType.unsigned_byte, pixels);
-      return ImgImpl{
-        .id = ret,
-        .width = @intCast(len_type, width),
-        .height = @intCast(len_type, height),
-        .flipped = flipped,
-        .has_alpha = num_colors == 4,
-      };
+    var free_targets = std.ArrayListUnmanaged(RenderTarget){};
+    defer {
+      for (free_targets.items) |t| e.releaseTarget(t);
+      free_targets.deinit(e.allocator);
     }
-  };
-}
+    errdefer {
+      for (fg.resources.items) |*r| {
+        if (r.physical) |t| e.releaseTarget(t);
+        r.physical = null;
+      }
+    }
+    var images = std.ArrayListUnmanaged(Image){};
+    defer images.deinit(e.allocator);
 
-/// The Engine is the core of the API.
-/// You need to initialize an Engine with init() before doing any drawing.
-///
-/// Giving debug=true will enable debug output, you should have created a
-/// debugging context for that. Non-debugging contexts are allowed not to
-/// provide any debugging output.
-pub const Engine = struct {
-  backend: Backend,
-  rect_proc: struct {
-    p: gl.Program,
-    transform: u32,
-    position: u32,
-    color: u32,
-  },
-  img_proc: struct {
-    p: gl.Program,
-    src_transform: u32,
-    dst_transform: u32,
-    position: u32,
-    texture: u32,
-    alpha: u32,
-  },
-  blend_proc: struct {
-    p: gl.Program,
-    posTrans: u32,
-    texTrans: u32,
-    position: u32,
-    texture: u32,
-    primary: u32,
-    secondary: u32,
+    for (fg.passes.items) |p, pi| {
+      if (!p.alive) continue;
+      const out = fg.resource(p.output);
+      // reuse a target no longer needed by earlier passes if possible.
+      out.physical = for (free_targets.items) |t, ti| {
+        if (t.image.width == out.width and t.image.height == out.height and t.image.has_alpha == out.with_alpha) {
+          break free_targets.swapRemove(ti);
+        }
+      } else try e.acquireTarget(out.width, out.height, out.with_alpha);
+
+      images.clearRetainingCapacity();
+      for (p.inputs) |h| {
+        const r = fg.resource(h);
+        try images.append(e.allocator, r.imported orelse r.physical.?.image);
+      }
+      {
+        const target = out.physical.?;
+        var canvas = try Canvas.createOn(e, target.framebuffer, target.image);
+        defer _ = canvas.finish() catch unreachable;
+        e.clear([_]u8{0, 0, 0, 0});
+        p.run(p.context, e, images.items);
+      }
+
+      // targets of transient resources read for the last time are free now.
+      for (p.inputs) |h| {
+        const r = fg.resource(h);
+        if (r.imported == null and r.last_use == pi) {
+          if (r.physical) |t| {
+            try free_targets.append(e.allocator, t);
+            r.physical = null;
+          }
+        }
+      }
+    }
+    const ret = final.physical.?;
+    final.physical = null;
+    return ret;
+  }
+};
+
+//////////////////////////////////////////////////////////////////////////////
+// Draw lists
+
+/// DrawCommand is a recorded call to one of the engine's drawing functions.
+pub const DrawCommand = union(enum) {
+  fill_unit: struct {
+    t: Transform, color: [4]u8, copy_alpha: bool,
   },
-  window: struct {
-    width: u32, height: u32,
+  blend_unit: struct {
+    mask: Image, dst_transform: Transform, src_transform: Transform,
+    color1: [4]u8, color2: [4]u8,
   },
-  target_framebuffer: struct {
-    width: u32, height: u32,
+  draw_image: struct {
+    image: Image, dst_transform: Transform, src_transform: Transform, alpha: u8,
   },
-  view_transform: Transform,
-  vao: gl.VertexArray,
-  vbo: gl.Buffer,
-  canvas_count: u8,
-  max_tex_size: i32,
-  single_value_color: gl.PixelFormat,
-  freetype_memory: ft.FT_MemoryRec_,
-  freetype_lib: ft.FT_Library,
-  allocator: std.mem.Allocator,
 
-  const Impl = EngineImpl(@This(), Rectangle, Image);
+  /// execute issues the recorded call to the given engine.
+  pub fn execute(cmd: DrawCommand, e: *Engine) void {
+    switch (cmd) {
+      .fill_unit => |v| e.fillUnit(v.t, v.color, v.copy_alpha),
+      .blend_unit => |v| e.blendUnit(v.mask, v.dst_transform, v.src_transform, v.color1, v.color2),
+      .draw_image => |v| e.drawImage(v.image, v.dst_transform, v.src_transform, v.alpha),
+    }
+  }
 
-  usingnamespace Impl;
+  /// bounds returns the bounding box of the area the command draws into.
+  pub fn bounds(cmd: DrawCommand) Rectangle {
+    const t = switch (cmd) {
+      .fill_unit => |v| v.t,
+      .blend_unit => |v| v.dst_transform,
+      .draw_image => |v| v.dst_transform,
+    };
+    const hx = 0.5 * (@fabs(t.m[0][0]) + @fabs(t.m[1][0]));
+    const hy = 0.5 * (@fabs(t.m[0][1]) + @fabs(t.m[1][1]));
+    const x1 = @floor(t.m[2][0] - hx);
+    const y1 = @floor(t.m[2][1] - hy);
+    return Rectangle{
+      .x = @floatToInt(i32, x1), .y = @floatToInt(i32, y1),
+      .width = @floatToInt(u31, @ceil(t.m[2][0] + hx) - x1),
+      .height = @floatToInt(u31, @ceil(t.m[2][1] + hy) - y1),
+    };
+  }
+};
 
-  pub const createCanvas = Canvas.create;
+/// TiledCanvas records drawing commands for an image that may be larger than
+/// the maximum texture size supported by the GPU, e.g. for print output.
+/// The recorded commands are replayed once per tile, and each rendered tile is
+/// handed to a sink, so memory usage is bounded by the tile size.
+///
+/// Images used in recorded commands must stay valid until rendering is done.
+pub const TiledCanvas = struct {
+  e: *Engine,
+  width: u31,
+  height: u31,
+  commands: std.ArrayListUnmanaged(DrawCommand),
+
+  pub fn init(e: *Engine, width: u31, height: u31) TiledCanvas {
+    return .{.e = e, .width = width, .height = height, .commands = .{}};
+  }
+
+  pub fn deinit(tc: *TiledCanvas) void {
+    tc.commands.deinit(tc.e.allocator);
+  }
+
+  pub fn area(tc: *const TiledCanvas) Rectangle {
+    return Rectangle{.x = 0, .y = 0, .width = tc.width, .height = tc.height};
+  }
+
+  /// record adds a command to the draw list.
+  pub fn record(tc: *TiledCanvas, cmd: DrawCommand) !void {
+    try tc.commands.append(tc.e.allocator, cmd);
+  }
+
+  /// records Engine.fillUnit.
+  pub fn fillUnit(tc: *TiledCanvas, t: Transform, color: [4]u8, copy_alpha: bool) !void {
+    try tc.record(.{.fill_unit = .{.t = t, .color = color, .copy_alpha = copy_alpha}});
+  }
+
+  /// records Engine.fillRect.
+  pub fn fillRect(tc: *TiledCanvas, r: Rectangle, color: [4]u8, copy_alpha: bool) !void {
+    try tc.fillUnit(r.transformation(), color, copy_alpha);
+  }
+
+  /// records Engine.blendUnit.
+  pub fn blendUnit(tc: *TiledCanvas, mask: Image, dst_transform: Transform, src_transform: Transform, color1: [4]u8, color2: [4]u8) !void {
+    try tc.record(.{.blend_unit = .{.mask = mask, .dst_transform = dst_transform,
+        .src_transform = src_transform, .color1 = color1, .color2 = color2}});
+  }
+
+  /// records Engine.drawImage.
+  pub fn drawImage(tc: *TiledCanvas, i: Image, dst_transform: Transform, src_transform: Transform, alpha: u8) !void {
+    try tc.record(.{.draw_image = .{.image = i, .dst_transform = dst_transform,
+        .src_transform = src_transform, .alpha = alpha}});
+  }
+
+  /// render renders the recorded commands tile by tile, with tiles of at most
+  /// tile_size*tile_size pixels (limited by the maximum texture size).
+  /// Every tile is passed to sink together with its area in canvas coordinates
+  /// and its RGBA pixels, ordered bottom-up. pixels are only valid during
+  /// the call to sink.
+  pub fn render(tc: *TiledCanvas, tile_size: u31, with_alpha: bool, context: anytype,
+                comptime sink: fn (@TypeOf(context), Rectangle, []const u8) anyerror!void) !void {
+    const e = tc.e;
+    const size = std.math.min(tile_size, @intCast(u31, e.max_tex_size));
+    const pixels = try e.allocator.alloc(u8, 4 * @as(usize, size) * @as(usize, size));
+    defer e.allocator.free(pixels);
+    const target = try e.acquireTarget(size, size, with_alpha);
+    defer e.releaseTarget(target);
+
+    var y: u31 = 0;
+    while (y < tc.height) : (y += size) {
+      var x: u31 = 0;
+      while (x < tc.width) : (x += size) {
+        const tile = Rectangle{.x = x, .y = y,
+          .width = std.math.min(size, tc.width - x),
+          .height = std.math.min(size, tc.height - y)};
+        var canvas = try Canvas.createOn(e, target.framebuffer, target.image);
+        Engine.Impl.setTarget(e, tile.x, tile.y, size, size);
+        e.clear([_]u8{0, 0, 0, 0});
+        for (tc.commands.items) |cmd| {
+          if (cmd.bounds().intersect(tile) != null) cmd.execute(e);
+        }
+        const tile_pixels = pixels[0..4 * @as(usize, tile.width) * @as(usize, tile.height)];
+        e.readPixels(tile, tile_pixels);
+        _ = try canvas.finish();
+        try sink(context, tile, tile_pixels);
+      }
+    }
+  }
+
+  /// writePam renders the canvas into a PAM (portable arbitrary map) image
+  /// file at the given path, writing each tile directly into the file.
+  pub fn writePam(tc: *TiledCanvas, path: []const u8, tile_size: u31) !void {
+    var file = try std.fs.cwd().createFile(path, .{});
+    defer file.close();
+    var header_buf: [128]u8 = undefined;
+    const header = try std.fmt.bufPrint(&header_buf,
+        "P7\nWIDTH {}\nHEIGHT {}\nDEPTH 4\nMAXVAL 255\nTUPLTYPE RGB_ALPHA\nENDHDR\n",
+        .{tc.width, tc.height});
+    try file.writeAll(header);
+    const writer = struct {
+      tc: *TiledCanvas,
+      file: std.fs.File,
+      offset: usize,
+
+      fn write(w: *const @This(), tile: Rectangle, pixels: []const u8) anyerror!void {
+        const row_len = 4 * @as(usize, tile.width);
+        var row: usize = 0;
+        while (row < tile.height) : (row += 1) {
+          // PAM stores rows top-down.
+          const file_row = @as(usize, w.tc.height) - 1 - (@intCast(usize, tile.y) + row);
+          const pos = w.offset + 4 * (file_row * w.tc.width + @intCast(usize, tile.x));
+          try w.file.pwriteAll(pixels[row * row_len..(row + 1) * row_len], pos);
+        }
+      }
+    }{.tc = tc, .file = file, .offset = header.len};
+    try tc.render(tile_size, true, &writer, @TypeOf(writer).write);
+  }
 };
 
-pub const CEngineInterface = EngineImpl(Engine, CRectangle, CImage);
\ No newline at end of file
+//////////////////////////////////////////////////////////////////////////////
+// Headless rendering
+
+/// see headless.zig. Using this requires linking against libEGL.
+pub const HeadlessContext = @import("headless.zig").HeadlessContext;
+
+/// parallel offscreen rendering, see render_pool.zig.
+/// Using this requires linking against libEGL.
+pub const render_pool = @import("render_pool.zig");
+pub const RenderPool = render_pool.RenderPool;
\ No newline at end of file
@@ -0,0 +1,748 @@
+//! readback renders small scenes with a HeadlessContext and checks the
+//! resulting pixels. Build with -Dheadless=true and run with
+//! `zig build readback`. The backend can be given as argument, e.g.
+//! `readback ogles_20`; the default is ogl_32. Text tests need a font file
+//! given as second argument and are skipped otherwise.
+
+const std = @import("std");
+
+const zargo = @import("zargo");
+
+const size = 64;
+
+const black = [_]u8{0, 0, 0, 255};
+const red = [_]u8{255, 0, 0, 255};
+const green = [_]u8{0, 255, 0, 255};
+const blue = [_]u8{0, 0, 255, 255};
+
+const TestError = error {
+  PixelMismatch,
+  LineMismatch,
+  MissingJobs,
+  /// the test needs a font, but none has been given.
+  NoFont,
+};
+
+/// path of the font used by text tests.
+var font_path: ?[:0]const u8 = null;
+
+/// pixel returns the color at (x, y) of the current framebuffer.
+fn pixel(e: *zargo.Engine, x: i32, y: i32) [4]u8 {
+  var ret: [4]u8 = undefined;
+  e.readPixels(.{.x = x, .y = y, .width = 1, .height = 1}, &ret);
+  return ret;
+}
+
+/// expectPixel checks that the color at (x, y) differs from expected by at
+/// most tolerance in each channel.
+fn expectPixel(e: *zargo.Engine, x: i32, y: i32, expected: [4]u8, tolerance: u8) !void {
+  const actual = pixel(e, x, y);
+  for (actual) |v, i| {
+    const diff = if (v > expected[i]) v - expected[i] else expected[i] - v;
+    if (diff > tolerance) {
+      std.debug.print("  pixel ({}, {}): expected {any}, got {any}\n", .{x, y, expected, actual});
+      return TestError.PixelMismatch;
+    }
+  }
+}
+
+fn testFillRect(e: *zargo.Engine) !void {
+  e.fillRect(.{.x = 0, .y = 0, .width = 32, .height = 64}, red, true);
+  try expectPixel(e, 16, 32, red, 0);
+  try expectPixel(e, 48, 32, black, 0);
+}
+
+fn testClearedRects(e: *zargo.Engine) !void {
+  // opaque pixel-aligned rectangles are filled by a scissored clear.
+  e.fillRect(.{.x = 16, .y = 16, .width = 32, .height = 32}, red, false);
+  try expectPixel(e, 16, 32, red, 0);
+  try expectPixel(e, 47, 32, red, 0);
+  try expectPixel(e, 15, 32, black, 0);
+  try expectPixel(e, 48, 32, black, 0);
+  try expectPixel(e, 32, 15, black, 0);
+  try expectPixel(e, 32, 48, black, 0);
+  // the clear is restricted to the clip.
+  e.setClip(.{.x = 0, .y = 0, .width = 32, .height = size});
+  e.fillRect(e.area(), blue, false);
+  e.setClip(null);
+  try expectPixel(e, 16, 8, blue, 0);
+  try expectPixel(e, 31, 32, blue, 0);
+  try expectPixel(e, 40, 32, red, 0);
+  try expectPixel(e, 48, 8, black, 0);
+  // translucent colors are still blended.
+  e.fillRect(e.area(), .{0, 255, 0, 128}, false);
+  try expectPixel(e, 16, 8, .{0, 128, 127, 255}, 2);
+  try expectPixel(e, 40, 32, .{127, 128, 0, 255}, 2);
+  try expectPixel(e, 48, 8, .{0, 128, 0, 255}, 2);
+}
+
+/// Fill is a frame graph pass filling its target with color.
+const Fill = struct {
+  color: [4]u8,
+
+  fn render(f: *Fill, e: *zargo.Engine, inputs: []const zargo.Image) void {
+    _ = inputs;
+    e.fillRect(e.area(), f.color, true);
+  }
+};
+
+/// Stripes is a frame graph pass drawing each input into a vertical stripe
+/// of its target.
+const Stripes = struct {
+  alpha: u8,
+
+  fn render(s: *Stripes, e: *zargo.Engine, inputs: []const zargo.Image) void {
+    const w = @intCast(u31, size / inputs.len);
+    for (inputs) |image, i| {
+      image.drawAll(e, .{.x = @intCast(i32, i * w), .y = 0, .width = w, .height = size}, s.alpha);
+    }
+  }
+};
+
+fn testFrameGraphSharedInput(e: *zargo.Engine) !void {
+  var fg = zargo.FrameGraph.init(e);
+  defer fg.deinit();
+  var fill = Fill{.color = red};
+  var stripes = Stripes{.alpha = 255};
+  // a is read by two passes; its target must not be reused before the
+  // second one has run.
+  const a = try fg.createTarget(size, size, false);
+  const b = try fg.createTarget(size, size, false);
+  const c = try fg.createTarget(size, size, false);
+  const d = try fg.createTarget(size, size, false);
+  try fg.addPass(&[_]zargo.FrameGraph.Handle{}, a, &fill, Fill.render);
+  try fg.addPass(&[_]zargo.FrameGraph.Handle{a}, b, &stripes, Stripes.render);
+  try fg.addPass(&[_]zargo.FrameGraph.Handle{a}, c, &stripes, Stripes.render);
+  try fg.addPass(&[_]zargo.FrameGraph.Handle{b, c}, d, &stripes, Stripes.render);
+  const result = try fg.execute(d);
+  defer e.releaseTarget(result);
+  result.image.drawAll(e, e.area(), 255);
+  try expectPixel(e, 16, 32, red, 0);
+  try expectPixel(e, 48, 32, red, 0);
+}
+
+fn testOpacityGroupAroundCanvas(e: *zargo.Engine) !void {
+  const left = zargo.Rectangle{.x = 0, .y = 0, .width = 32, .height = size};
+  const right = zargo.Rectangle{.x = 32, .y = 0, .width = 32, .height = size};
+  try e.pushOpacityGroup(128, e.area());
+  e.fillRect(left, green, true);
+  // the canvas starts outside of the group; only drawing its image belongs
+  // to the group.
+  var canvas = try zargo.Canvas.create(e, 32, size, false);
+  e.fillRect(e.area(), red, true);
+  var image = try canvas.finish();
+  defer image.free();
+  image.drawAll(e, left, 255);
+  e.fillRect(right, blue, true);
+  e.popOpacityGroup();
+  try expectPixel(e, 16, 32, .{128, 0, 0, 255}, 2);
+  try expectPixel(e, 48, 32, .{0, 0, 128, 255}, 2);
+}
+
+/// halves returns the RGB pixels of an image whose upper half is red and
+/// whose lower half is blue, with rows ordered top-down as in image files.
+fn halves(comptime width: usize, comptime height: usize) [3 * width * height]u8 {
+  @setEvalBranchQuota(10 * width * height);
+  var ret: [3 * width * height]u8 = undefined;
+  var i: usize = 0;
+  while (i < width * height) : (i += 1) {
+    const color = if (i < width * height / 2) red else blue;
+    std.mem.copy(u8, ret[3 * i..3 * i + 3], color[0..3]);
+  }
+  return ret;
+}
+
+fn testBlurLoadedImage(e: *zargo.Engine) !void {
+  const pixels = comptime halves(32, 32);
+  var image = e.uploadImage(.{.width = 32, .height = 32, .num_colors = 3, .pixels = &pixels});
+  defer image.free();
+  const blurred = try e.blur(image, image.area(), 1, 1.0);
+  defer e.releaseTarget(blurred);
+  blurred.image.drawAll(e, e.area(), 255);
+  // away from the edge between the halves, the blurred image must keep the
+  // orientation and colors of the source.
+  try expectPixel(e, 32, 56, red, 16);
+  try expectPixel(e, 32, 8, blue, 16);
+}
+
+/// expectSameOrientation draws the image, whose upper half is red and whose
+/// lower half is blue, once unscaled and opaque, which may copy it, and once
+/// with the img program.
+fn expectSameOrientation(e: *zargo.Engine, image: zargo.Image) !void {
+  image.drawAll(e, .{.x = 0, .y = 0, .width = 32, .height = 32}, 255);
+  image.drawAll(e, .{.x = 32, .y = 0, .width = 32, .height = 32}, 254);
+  try expectPixel(e, 16, 24, red, 0);
+  try expectPixel(e, 16, 8, blue, 0);
+  try expectPixel(e, 48, 24, red, 1);
+  try expectPixel(e, 48, 8, blue, 1);
+}
+
+fn testCopyOrientation(e: *zargo.Engine) !void {
+  // uploaded images store rows top-down.
+  const pixels = comptime halves(32, 32);
+  var uploaded = e.uploadImage(.{.width = 32, .height = 32, .num_colors = 3, .pixels = &pixels});
+  defer uploaded.free();
+  try expectSameOrientation(e, uploaded);
+
+  // images drawn by the engine store rows bottom-up.
+  e.clear(black);
+  const target = try e.acquireTarget(32, 32, false);
+  defer e.releaseTarget(target);
+  var canvas = try zargo.Canvas.createOn(e, target.framebuffer, target.image);
+  e.fillRect(.{.x = 0, .y = 0, .width = 32, .height = 16}, blue, true);
+  e.fillRect(.{.x = 0, .y = 16, .width = 32, .height = 16}, red, true);
+  _ = try canvas.finish();
+  try expectSameOrientation(e, target.image);
+}
+
+fn testEvenOddFillOnCanvas(e: *zargo.Engine) !void {
+  var path = zargo.Path.init(e.allocator);
+  defer path.deinit();
+  // two squares with the same orientation; with even-odd, the inner one is
+  // a hole.
+  for ([_][2]f32{.{8, 48}, .{24, 16}}) |square| {
+    try path.moveTo(square[0], square[0]);
+    try path.lineTo(square[0] + square[1], square[0]);
+    try path.lineTo(square[0] + square[1], square[0] + square[1]);
+    try path.lineTo(square[0], square[0] + square[1]);
+    try path.close();
+  }
+  // canvases have their own stencil buffer.
+  var canvas = try zargo.Canvas.create(e, size, size, false);
+  e.clear(black);
+  e.fillPath(&path, zargo.Transform.identity(), .even_odd, red);
+  var image = try canvas.finish();
+  defer image.free();
+  image.drawAll(e, e.area(), 255);
+  try expectPixel(e, 16, 32, red, 0);
+  try expectPixel(e, 32, 32, black, 0);
+  try expectPixel(e, 4, 4, black, 0);
+}
+
+/// expectLines checks that text is broken into the expected lines.
+fn expectLines(font: *zargo.Font, text: []const u8, max_width: f32, expected: []const []const u8) !void {
+  const allocator = font.e.allocator;
+  const lines = try font.breakLines(allocator, text, 16, max_width);
+  defer allocator.free(lines);
+  var ok = lines.len == expected.len;
+  if (ok) {
+    for (lines) |l, i| {
+      if (!std.mem.eql(u8, text[l.start..l.end], expected[i]) or l.advance > max_width) ok = false;
+    }
+  }
+  if (!ok) {
+    std.debug.print("  breaking \"{s}\" at {d}, expected:", .{text, max_width});
+    for (expected) |line| std.debug.print(" \"{s}\"", .{line});
+    std.debug.print(", got:", .{});
+    for (lines) |l| std.debug.print(" \"{s}\"", .{text[l.start..l.end]});
+    std.debug.print("\n", .{});
+    return TestError.LineMismatch;
+  }
+}
+
+fn testBreakLines(e: *zargo.Engine) !void {
+  var font = try e.loadFont(font_path orelse return TestError.NoFont);
+  defer font.free();
+  // half a pixel of slack for rounding, less than any glyph is wide.
+  const two_words = (try font.measure("aaa aaa", 16)).advance + 0.5;
+  try expectLines(&font, "aaa aaa aaa", two_words, &[_][]const u8{"aaa aaa", "aaa"});
+  try expectLines(&font, "aaa  aaa", two_words, &[_][]const u8{"aaa", "aaa"});
+  try expectLines(&font, "aaa\naaa aaa", two_words, &[_][]const u8{"aaa", "aaa aaa"});
+  // a word wider than max_width is broken between glyphs.
+  const two_glyphs = (try font.measure("aa", 16)).advance + 0.5;
+  try expectLines(&font, "aaaa", two_glyphs, &[_][]const u8{"aa", "aa"});
+}
+
+/// readArea returns the RGBA pixels of the given area of the current
+/// framebuffer.
+fn readArea(e: *zargo.Engine, r: zargo.Rectangle) ![]u8 {
+  const ret = try e.allocator.alloc(u8, 4 * @as(usize, r.width) * r.height);
+  e.readPixels(r, ret);
+  return ret;
+}
+
+/// expectSamePixels checks that the pixels in actual differ from those in
+/// expected by at most tolerance in each channel.
+fn expectSamePixels(expected: []const u8, actual: []const u8, tolerance: u8) !void {
+  for (actual) |v, i| {
+    const diff = if (v > expected[i]) v - expected[i] else expected[i] - v;
+    if (diff > tolerance) {
+      std.debug.print("  pixel {}: expected {any}, got {any}\n", .{i / 4,
+          expected[i - i % 4..][0..4], actual[i - i % 4..][0..4]});
+      return TestError.PixelMismatch;
+    }
+  }
+}
+
+fn testManyVariantsInOneBatch(e: *zargo.Engine) !void {
+  var font = try e.loadFont(font_path orelse return TestError.NoFont);
+  defer font.free();
+  // many distinct glyphs at varying subpixel positions, so that with a font
+  // covering Latin, Greek and Cyrillic, drawing them evicts variants that
+  // are already batched.
+  var text = std.ArrayList(u8).init(e.allocator);
+  defer text.deinit();
+  var pass: usize = 0;
+  while (pass < 8) : (pass += 1) {
+    var cp: u21 = 0x21;
+    while (cp < 0x530) : (cp += 1) {
+      if (cp >= 0x7f and cp <= 0xa0) continue;
+      var buf: [4]u8 = undefined;
+      const len = std.unicode.utf8Encode(cp, &buf) catch unreachable;
+      try text.appendSlice(buf[0..len]);
+    }
+  }
+  const prefix = "!\"#$%&'()";
+  const visible = zargo.Rectangle{.x = 0, .y = 0,
+    .width = @floatToInt(u31, std.math.min(size, (try font.measure(prefix, 12)).advance - 2)), .height = size};
+
+  e.drawText(&font, text.items, 0.25, 32, 12, red);
+  const batched = try readArea(e, visible);
+  defer e.allocator.free(batched);
+  e.clear(black);
+  e.drawText(&font, prefix, 0.25, 32, 12, red);
+  const alone = try readArea(e, visible);
+  defer e.allocator.free(alone);
+  try expectSamePixels(alone, batched, 2);
+}
+
+/// drawAscii draws the printable ASCII characters at sizes 8 to 40, only the
+/// line at size 16 being visible.
+fn drawAscii(e: *zargo.Engine, font: *zargo.Font) void {
+  var chars: [0x7f - 0x21]u8 = undefined;
+  for (chars) |*ch, i| ch.* = @intCast(u8, 0x21 + i);
+  var glyph_size: u16 = 8;
+  while (glyph_size <= 40) : (glyph_size += 1) {
+    e.drawText(font, &chars, 0, if (glyph_size == 16) 32 else -100, glyph_size, red);
+  }
+}
+
+fn testGlyphWorkersReserve(e: *zargo.Engine) !void {
+  const path = font_path orelse return TestError.NoFont;
+  // glyphs of many heights, so that workers open shelves concurrently.
+  try e.startGlyphWorkers(4);
+  var parallel = try e.loadFont(path);
+  defer parallel.free();
+  drawAscii(e, &parallel);
+  e.stopGlyphWorkers();
+  const expected = try readArea(e, e.area());
+  defer e.allocator.free(expected);
+
+  // a second font has its own glyphs, which are now rasterized serially.
+  e.clear(black);
+  var serial = try e.loadFont(path);
+  defer serial.free();
+  drawAscii(e, &serial);
+  const actual = try readArea(e, e.area());
+  defer e.allocator.free(actual);
+  try expectSamePixels(expected, actual, 2);
+}
+
+fn testAtlasRepack(e: *zargo.Engine) !void {
+  var font = try e.loadFont(font_path orelse return TestError.NoFont);
+  defer font.free();
+  const live = "Hamburgefonts";
+  e.drawText(&font, live, 0, 32, 16, red);
+  const expected = try readArea(e, e.area());
+  defer e.allocator.free(expected);
+
+  var chars: [0x7f - 0x21]u8 = undefined;
+  for (chars) |*ch, i| ch.* = @intCast(u8, 0x21 + i);
+  // large glyphs of a new size each frame fill all pages after a few frames,
+  // after which pages are repacked and cleared. The live text, drawn every
+  // frame, must survive this.
+  var frame: u16 = 0;
+  while (frame < 80) : (frame += 1) {
+    e.clear(black);
+    e.drawText(&font, &chars, 0, -1000, 100 + frame, red);
+    e.drawText(&font, live, 0, 32, 16, red);
+    const actual = try readArea(e, e.area());
+    defer e.allocator.free(actual);
+    expectSamePixels(expected, actual, 2) catch |err| {
+      std.debug.print("  in frame {}\n", .{frame});
+      return err;
+    };
+    e.endFrame();
+  }
+}
+
+fn testBakedAtlas(e: *zargo.Engine) !void {
+  const path = font_path orelse return TestError.NoFont;
+  const baked_path = "readback-baked.atlas";
+  {
+    const file = try std.fs.cwd().createFile(baked_path, .{});
+    defer file.close();
+    var buffered = std.io.bufferedWriter(file.writer());
+    try zargo.BakedAtlas.bake(e.allocator, path, &[_]u16{16},
+        &[_]zargo.BakedAtlas.Range{.{.first = 0x20, .last = 0x7e}},
+        zargo.BakedAtlas.default_page_size, buffered.writer());
+    try buffered.flush();
+  }
+  defer std.fs.cwd().deleteFile(baked_path) catch {};
+
+  // glyphs taken from the baked page must be placed like rasterized ones.
+  var rasterized = try e.loadFont(path);
+  defer rasterized.free();
+  e.drawText(&rasterized, "Hamburgefonts", 0.25, 32, 16, red);
+  const expected = try readArea(e, e.area());
+  defer e.allocator.free(expected);
+
+  e.clear(black);
+  var baked = try e.loadFont(path);
+  defer baked.free();
+  try baked.loadBakedAtlas(baked_path);
+  e.drawText(&baked, "Hamburgefonts", 0.25, 32, 16, red);
+  const actual = try readArea(e, e.area());
+  defer e.allocator.free(actual);
+  try expectSamePixels(expected, actual, 2);
+}
+
+/// CountingJob is a render job filling its pixel red, counting the jobs that
+/// finished with the expected result.
+const CountingJob = struct {
+  job: zargo.render_pool.Job,
+  count: *std.atomic.Atomic(u32),
+
+  fn render(job: *zargo.render_pool.Job, w: *zargo.render_pool.Worker) void {
+    _ = job;
+    w.e.fillRect(.{.x = 0, .y = 0, .width = 1, .height = 1}, red, true);
+  }
+
+  fn finished(job: *zargo.render_pool.Job, pixels: []const u8) void {
+    const self = @fieldParentPtr(CountingJob, "job", job);
+    if (std.mem.eql(u8, pixels, &red)) _ = self.count.fetchAdd(1, .Monotonic);
+  }
+};
+
+fn testRenderPoolFullQueue(e: *zargo.Engine) !void {
+  var count = std.atomic.Atomic(u32).init(0);
+  // more jobs than the queue holds, so that submit has to wait for free
+  // slots.
+  const jobs = try e.allocator.alloc(CountingJob, 1000);
+  defer e.allocator.free(jobs);
+  for (jobs) |*j| j.* = .{
+    .job = .{.width = 1, .height = 1, .render = CountingJob.render, .finished = CountingJob.finished},
+    .count = &count,
+  };
+  var pool: zargo.RenderPool = undefined;
+  try pool.init(e.allocator, e.backend, 2, null);
+  for (jobs) |*j| pool.submit(&j.job);
+  pool.wait();
+  pool.deinit();
+  if (count.load(.Monotonic) != jobs.len) {
+    std.debug.print("  {} of {} jobs finished\n", .{count.load(.Monotonic), jobs.len});
+    return TestError.MissingJobs;
+  }
+}
+
+fn testOpacityGroupPaths(e: *zargo.Engine) !void {
+  const half_red = [_]u8{255, 0, 0, 128};
+  const left = zargo.Rectangle{.x = 0, .y = 0, .width = 32, .height = size};
+  const right = zargo.Rectangle{.x = 32, .y = 0, .width = 32, .height = size};
+  // a single draw is done directly with modulated alpha.
+  try e.pushOpacityGroup(128, left);
+  e.fillRect(left, half_red, false);
+  e.popOpacityGroup();
+  // a second draw makes the group go offscreen.
+  try e.pushOpacityGroup(128, right);
+  e.fillRect(right, half_red, false);
+  e.fillRect(.{.x = 63, .y = 63, .width = 1, .height = 1}, blue, false);
+  e.popOpacityGroup();
+  const expected = pixel(e, 16, 32);
+  try expectPixel(e, 16, 32, .{64, 0, 0, 255}, 2);
+  try expectPixel(e, 48, 32, expected, 2);
+}
+
+fn testFillConvexPolygon(e: *zargo.Engine) !void {
+  e.fillPolygon(&[_][2]f32{.{8, 8}, .{56, 8}, .{56, 56}, .{8, 56}}, red);
+  try expectPixel(e, 32, 32, red, 0);
+  try expectPixel(e, 60, 32, black, 0);
+}
+
+fn testFillConcavePolygon(e: *zargo.Engine) !void {
+  // a U whose notch must stay empty.
+  e.fillPolygon(&[_][2]f32{
+    .{8, 8}, .{56, 8}, .{56, 56}, .{40, 56}, .{40, 24}, .{24, 24}, .{24, 56}, .{8, 56},
+  }, red);
+  try expectPixel(e, 16, 48, red, 0);
+  try expectPixel(e, 48, 48, red, 0);
+  try expectPixel(e, 32, 16, red, 0);
+  try expectPixel(e, 32, 40, black, 0);
+}
+
+fn testFillSelfIntersectingPolygon(e: *zargo.Engine) !void {
+  // a pentagram; with the non-zero rule, its center is filled.
+  var points: [5][2]f32 = undefined;
+  for (points) |*p, i| {
+    const angle = std.math.pi / 2.0 + @intToFloat(f32, i) * 4.0 * std.math.pi / 5.0;
+    p.* = .{32 + 28 * @cos(angle), 32 + 28 * @sin(angle)};
+  }
+  e.fillPolygon(&points, red);
+  try expectPixel(e, 32, 32, red, 0);
+  // inside a tip.
+  try expectPixel(e, 32, 52, red, 0);
+  // between two tips.
+  const between = std.math.pi / 2.0 + std.math.pi / 5.0;
+  try expectPixel(e, @floatToInt(i32, 32 + 24 * @cos(between)), @floatToInt(i32, 32 + 24 * @sin(between)), black, 0);
+}
+
+fn testLayerUpdates(e: *zargo.Engine) !void {
+  const left = zargo.Rectangle{.x = 0, .y = 0, .width = 32, .height = size};
+  var layer = try zargo.Layer.create(e, size, size, false);
+  defer layer.free();
+  if (!layer.isDirty()) return TestError.PixelMismatch;
+  if (try layer.beginUpdate()) |region| {
+    defer layer.endUpdate();
+    if (!std.meta.eql(region, layer.area())) return TestError.PixelMismatch;
+    e.fillRect(e.area(), red, true);
+  } else return TestError.PixelMismatch;
+  if (layer.isDirty()) return TestError.PixelMismatch;
+  if ((try layer.beginUpdate()) != null) return TestError.PixelMismatch;
+
+  // only the invalidated region is cleared and re-rendered.
+  layer.invalidate(left);
+  if (try layer.beginUpdate()) |region| {
+    defer layer.endUpdate();
+    if (!std.meta.eql(region, left)) return TestError.PixelMismatch;
+    e.fillRect(e.area(), green, true);
+  } else return TestError.PixelMismatch;
+  layer.draw(e.area(), 255);
+  try expectPixel(e, 16, 32, green, 0);
+  try expectPixel(e, 48, 32, red, 0);
+}
+
+fn testClipAroundCanvas(e: *zargo.Engine) !void {
+  const clip = zargo.Rectangle{.x = 16, .y = 16, .width = 32, .height = 32};
+  e.setClip(clip);
+  defer e.setClip(null);
+  // a canvas starts without clip, and finishing it restores the outer clip.
+  var canvas = try zargo.Canvas.create(e, size, size, false);
+  if (e.clip != null) return TestError.PixelMismatch;
+  e.fillRect(e.area(), red, true);
+  try expectPixel(e, 4, 4, red, 0);
+  var image = try canvas.finish();
+  image.free();
+  const restored = e.clip orelse return TestError.PixelMismatch;
+  if (!std.meta.eql(restored, clip)) return TestError.PixelMismatch;
+  e.fillRect(e.area(), blue, true);
+  try expectPixel(e, 32, 32, blue, 0);
+  try expectPixel(e, 4, 4, black, 0);
+}
+
+fn testRenderTargetPool(e: *zargo.Engine) !void {
+  const first = try e.acquireTarget(16, 16, true);
+  e.releaseTarget(first);
+  // a target of another size must not be taken from the pool.
+  const other = try e.acquireTarget(32, 16, true);
+  defer e.releaseTarget(other);
+  if (other.framebuffer == first.framebuffer) return TestError.PixelMismatch;
+  const second = try e.acquireTarget(16, 16, true);
+  defer e.releaseTarget(second);
+  if (second.framebuffer != first.framebuffer) return TestError.PixelMismatch;
+}
+
+fn testNinePatch(e: *zargo.Engine) !void {
+  // a 16x16 image with a blue border of 4 pixels around a red center.
+  var canvas = try zargo.Canvas.create(e, 16, 16, false);
+  e.fillRect(e.area(), blue, true);
+  e.fillRect(.{.x = 4, .y = 4, .width = 8, .height = 8}, red, true);
+  var image = try canvas.finish();
+  defer image.free();
+  const patch = zargo.NinePatch{
+    .image = image, .area = image.area(), .left = 4, .bottom = 4, .right = 4, .top = 4,
+  };
+  patch.draw(e, e.area(), 255);
+  // corners and edges keep their size, the center is stretched.
+  for ([_][2]i32{.{2, 2}, .{61, 2}, .{2, 61}, .{61, 61}, .{2, 32}, .{61, 32}, .{32, 2}, .{32, 61}}) |p| {
+    try expectPixel(e, p[0], p[1], blue, 0);
+  }
+  for ([_][2]i32{.{8, 32}, .{55, 32}, .{32, 8}, .{32, 55}, .{32, 32}}) |p| {
+    try expectPixel(e, p[0], p[1], red, 0);
+  }
+}
+
+fn testPolylineJoinsAndCaps(e: *zargo.Engine) !void {
+  e.strokePolyline(&[_][2]f32{.{8, 8}, .{40, 8}, .{40, 56}}, 8, red);
+  try expectPixel(e, 24, 8, red, 0);
+  try expectPixel(e, 24, 14, black, 0);
+  // the miter join fills the outer corner, which a round join would not.
+  try expectPixel(e, 42, 4, red, 0);
+  try expectPixel(e, 45, 3, black, 0);
+  // butt caps end the line at its end points.
+  try expectPixel(e, 9, 8, red, 0);
+  try expectPixel(e, 6, 8, black, 0);
+  try expectPixel(e, 40, 54, red, 0);
+  try expectPixel(e, 40, 58, black, 0);
+}
+
+fn testCircles(e: *zargo.Engine) !void {
+  e.fillCircle(.{32, 32}, 16, red);
+  try expectPixel(e, 32, 32, red, 0);
+  try expectPixel(e, 32, 46, red, 0);
+  try expectPixel(e, 32, 50, black, 0);
+  try expectPixel(e, 44, 44, black, 0);
+  e.clear(black);
+  // the outline lies inside the circle.
+  e.strokeCircle(.{32, 32}, 16, 4, red);
+  try expectPixel(e, 32, 46, red, 0);
+  try expectPixel(e, 32, 42, black, 0);
+  try expectPixel(e, 32, 32, black, 0);
+  try expectPixel(e, 32, 50, black, 0);
+}
+
+fn testRoundedRects(e: *zargo.Engine) !void {
+  const r = zargo.Rectangle{.x = 8, .y = 8, .width = 48, .height = 48};
+  e.fillRoundedRect(r, 12, red);
+  try expectPixel(e, 32, 32, red, 0);
+  try expectPixel(e, 32, 9, red, 0);
+  try expectPixel(e, 12, 32, red, 0);
+  // outside of the rounded corner, inside of the rectangle's corner.
+  try expectPixel(e, 9, 9, black, 0);
+  try expectPixel(e, 54, 54, black, 0);
+  e.clear(black);
+  e.strokeRoundedRect(r, 12, 4, red);
+  try expectPixel(e, 32, 10, red, 0);
+  try expectPixel(e, 10, 32, red, 0);
+  try expectPixel(e, 32, 14, black, 0);
+  try expectPixel(e, 32, 32, black, 0);
+  try expectPixel(e, 9, 9, black, 0);
+}
+
+/// TileChecker checks the tiles of a TiledCanvas whose pixel at (x, y) has
+/// the color tileColor(x, y).
+const TileChecker = struct {
+  width: usize,
+  /// set for every pixel of the canvas that has been in a tile.
+  seen: []bool,
+  mismatch: bool = false,
+
+  fn check(c: *TileChecker, tile: zargo.Rectangle, pixels: []const u8) anyerror!void {
+    var y: usize = 0;
+    while (y < tile.height) : (y += 1) {
+      var x: usize = 0;
+      while (x < tile.width) : (x += 1) {
+        const cx = @intCast(usize, tile.x) + x;
+        const cy = @intCast(usize, tile.y) + y;
+        const actual = pixels[4 * (y * tile.width + x)..][0..4];
+        const expected = tileColor(cx, cy);
+        if (c.seen[cy * c.width + cx] or !std.mem.eql(u8, actual, &expected)) {
+          if (!c.mismatch) std.debug.print("  pixel ({}, {}): expected {any}, got {any}\n", .{cx, cy, expected, actual});
+          c.mismatch = true;
+        }
+        c.seen[cy * c.width + cx] = true;
+      }
+    }
+  }
+};
+
+fn tileColor(x: usize, y: usize) [4]u8 {
+  return .{@intCast(u8, 2 * x), @intCast(u8, 3 * y), 0, 255};
+}
+
+fn testTiledCanvasSeams(e: *zargo.Engine) !void {
+  // neither side is a multiple of the tile size.
+  const width = 100;
+  const height = 70;
+  var tc = zargo.TiledCanvas.init(e, width, height);
+  defer tc.deinit();
+  var y: u31 = 0;
+  while (y < height) : (y += 1) {
+    var x: u31 = 0;
+    while (x < width) : (x += 1) {
+      try tc.fillRect(.{.x = x, .y = y, .width = 1, .height = 1}, tileColor(x, y), true);
+    }
+  }
+  var seen = [_]bool{false} ** (width * height);
+  var checker = TileChecker{.width = width, .seen = &seen};
+  try tc.render(32, true, &checker, TileChecker.check);
+  if (checker.mismatch or std.mem.indexOfScalar(bool, &seen, false) != null) return TestError.PixelMismatch;
+}
+
+fn testGradientStops(e: *zargo.Engine) !void {
+  const linear_stops = [_]zargo.GradientStop{.{.offset = 0.25, .color = red}, .{.offset = 0.75, .color = blue}};
+  e.fillGradientRect(e.area(), .{.kind = .linear, .start = .{0, 0}, .end = .{size, 0},
+      .stops = &linear_stops, .stop_count = linear_stops.len});
+  // before the first and after the last stop, their colors are used.
+  try expectPixel(e, 8, 32, red, 0);
+  try expectPixel(e, 32, 32, .{128, 0, 127, 255}, 8);
+  try expectPixel(e, 56, 32, blue, 0);
+
+  const radial_stops = [_]zargo.GradientStop{
+    .{.offset = 0, .color = red}, .{.offset = 0.5, .color = green}, .{.offset = 1, .color = blue},
+  };
+  e.fillGradientRect(e.area(), .{.kind = .radial, .start = .{32, 32}, .end = .{32, size},
+      .stops = &radial_stops, .stop_count = radial_stops.len});
+  try expectPixel(e, 32, 32, red, 16);
+  try expectPixel(e, 48, 32, green, 16);
+  try expectPixel(e, 32, 16, green, 16);
+  try expectPixel(e, 1, 1, blue, 0);
+}
+
+const tests = .{
+  .{"fillRect", testFillRect},
+  .{"fillRect by a scissored clear", testClearedRects},
+  .{"FrameGraph with a resource read twice", testFrameGraphSharedInput},
+  .{"opacity group around a canvas", testOpacityGroupAroundCanvas},
+  .{"opacity group drawn directly and offscreen", testOpacityGroupPaths},
+  .{"blur of a loaded image", testBlurLoadedImage},
+  .{"copied and drawn images have the same orientation", testCopyOrientation},
+  .{"even-odd fillPath on a canvas", testEvenOddFillOnCanvas},
+  .{"breakLines", testBreakLines},
+  .{"more subpixel variants than fit in one batch", testManyVariantsInOneBatch},
+  .{"glyph workers reserving atlas space concurrently", testGlyphWorkersReserve},
+  .{"glyph atlas repacking with live text", testAtlasRepack},
+  .{"text drawn from a baked atlas", testBakedAtlas},
+  .{"RenderPool with more jobs than queue slots", testRenderPoolFullQueue},
+  .{"fillPolygon with a convex polygon", testFillConvexPolygon},
+  .{"fillPolygon with a concave polygon", testFillConcavePolygon},
+  .{"fillPolygon with a self-intersecting polygon", testFillSelfIntersectingPolygon},
+  .{"Layer dirty and clean tracking", testLayerUpdates},
+  .{"clip around a canvas", testClipAroundCanvas},
+  .{"render target pool reuse", testRenderTargetPool},
+  .{"TiledCanvas without seams between tiles", testTiledCanvasSeams},
+  .{"nine-patch", testNinePatch},
+  .{"polyline joins and caps", testPolylineJoinsAndCaps},
+  .{"filled and stroked circles", testCircles},
+  .{"filled and stroked rounded rectangles", testRoundedRects},
+  .{"linear and radial gradient stops", testGradientStops},
+};
+
+pub fn main() !u8 {
+  var gpa = std.heap.GeneralPurposeAllocator(.{}){};
+  defer _ = gpa.deinit();
+  const allocator = gpa.allocator();
+
+  const args = try std.process.argsAlloc(allocator);
+  defer std.process.argsFree(allocator, args);
+  const backend = if (args.len > 1)
+    std.meta.stringToEnum(zargo.Backend, args[1]) orelse {
+      std.debug.print("unknown backend: {s}\n", .{args[1]});
+      return 1;
+    }
+  else zargo.Backend.ogl_32;
+  if (args.len > 2) font_path = args[2];
+
+  var ctx = zargo.HeadlessContext.create(backend, size, size) catch |err| {
+    std.debug.print("unable to create headless context: {s}\n", .{@errorName(err)});
+    return 1;
+  };
+  defer ctx.destroy();
+  var e: zargo.Engine = undefined;
+  try e.init(allocator, backend, size, size, false);
+  defer e.close();
+
+  var failed: usize = 0;
+  inline for (tests) |t| {
+    e.clear(black);
+    if (t[1](&e)) {
+      std.debug.print("ok   {s}\n", .{t[0]});
+    } else |err| if (err == TestError.NoFont) {
+      std.debug.print("skip {s}: no font given\n", .{t[0]});
+    } else {
+      std.debug.print("FAIL {s}: {s}\n", .{t[0], @errorName(err)});
+      failed += 1;
+    }
+  }
+  std.debug.print("{} of {} tests failed\n", .{failed, tests.len});
+  return if (failed == 0) 0 else 1;
+}